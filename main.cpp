@@ -3,6 +3,12 @@
 #include "ThreadPool.h"
 #include "TimerScheduler.h"
 #include "DeviceManager.h"
+#include "ConfigWatcher.h"
+#include "HttpServer.h"
+#include "ChangeLog.h"
+#include "ShmTagTable.h"
+#include "TagHistory.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -10,13 +16,15 @@
 int main(const int argc, char* argv[]) {
 
     try {
-        // 1. 读取配置文件路径
+        // 1. 读取配置文件路径；可选第二个参数为二进制配置快照路径
         std::string configPath = "config/iot_config.json";
         if (argc > 1) configPath = argv[1];
+        std::string configCachePath;
+        if (argc > 2) configCachePath = argv[2];
         // 2. 解析配置
         GlobalConfig globalConfig;
         try {
-            globalConfig = JsonConfig::load(configPath);
+            globalConfig = JsonConfig::load(configPath, configCachePath);
         } catch (const std::exception& ex) {
             std::cerr << "Failed to parse config: " << ex.what() << std::endl;
             return 1;
@@ -34,14 +42,53 @@ int main(const int argc, char* argv[]) {
         size_t poolSize = std::max(1, globalConfig.system.thread_pool_size);
         auto threadPool = std::make_shared<ThreadPool>(poolSize);
         const auto timerScheduler = std::make_shared<TimerScheduler>(threadPool);
+        TimerConfig timerConfig;
+        timerConfig.backend = globalConfig.system.timer_backend;
+        timerConfig.spinUs = static_cast<uint32_t>(std::max(0, globalConfig.system.timer_spin_us));
+        timerConfig.cpu = globalConfig.system.timer_cpu;
+        timerScheduler->configure(timerConfig);
+        // 变化日志须在加载变量（产生首批变化）之前配置
+        ChangeLog::Config changeLogConfig;
+        changeLogConfig.capacity = static_cast<uint32_t>(std::max(1024, globalConfig.system.changelog_capacity));
+        changeLogConfig.spillPath = globalConfig.system.changelog_spill_path;
+        changeLogConfig.spillMaxBytes = static_cast<uint64_t>(std::max(1, globalConfig.system.changelog_spill_max_mb)) << 20;
+        ChangeLog::instance().configure(changeLogConfig);
+        TagHistory::Config historyConfig;
+        historyConfig.retentionSec = static_cast<uint32_t>(std::max(0, globalConfig.system.history_retention_s));
+        historyConfig.maxBytes = static_cast<uint64_t>(std::max(1, globalConfig.system.history_max_mb)) << 20;
+        TagHistory::instance().configure(historyConfig);
+        // 共享内存标签表须在注册首个标签之前创建
+        ShmTagTable::Config shmConfig;
+        shmConfig.name = globalConfig.system.shm_name;
+        shmConfig.capacity = static_cast<uint32_t>(std::max(1, globalConfig.system.shm_max_tags));
+        ShmTagTable::instance().configure(shmConfig);
         // 5. 初始化设备管理器，加载所有设备/分组/变量
         const auto deviceManager = DeviceManager::create(threadPool, timerScheduler, globalConfig);
-        // // 6. 注册所有采集分组任务
-        deviceManager->registerAllGroupTasks();
-        // // 7. 启动调度器
+        // // 6. 启动调度器
         timerScheduler->start();
+        // // 7. 后台并行连接设备，每台设备就绪后立即注册其采集分组任务
+        deviceManager->startAll(static_cast<size_t>(std::max(1, globalConfig.system.connect_concurrency)));
+        // // 8. 配置热加载（文件变更 / SIGHUP）
+        std::unique_ptr<ConfigWatcher> configWatcher;
+        if (globalConfig.system.config_watch_interval_ms > 0) {
+            configWatcher = std::make_unique<ConfigWatcher>(
+                configPath, configCachePath, deviceManager, static_cast<uint32_t>(globalConfig.system.config_watch_interval_ms));
+            configWatcher->start();
+        }
+        // // 9. HTTP 查询接口
+        std::unique_ptr<HttpServer> httpServer;
+        if (globalConfig.system.http_port > 0) {
+            HttpServer::Config httpConfig;
+            httpConfig.bind = globalConfig.system.http_bind;
+            httpConfig.port = globalConfig.system.http_port;
+            httpConfig.workers = globalConfig.system.http_workers;
+            httpConfig.ws.intervalMs = static_cast<uint32_t>(std::max(0, globalConfig.system.ws_interval_ms));
+            httpConfig.ws.maxClients = globalConfig.system.ws_max_clients;
+            httpServer = std::make_unique<HttpServer>(deviceManager, httpConfig);
+            httpServer->start();
+        }
         GLOG_INFO("IoT Gateway Started. Press Ctrl+C to exit.");
-        // // 8. 阻塞主线程（可按需用信号优雅退出）
+        // // 10. 阻塞主线程（可按需用信号优雅退出）
         while (true) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
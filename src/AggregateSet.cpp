@@ -0,0 +1,149 @@
+#include "AggregateSet.h"
+#include <algorithm>
+#include <cmath>
+#include "FastClock.h"
+#include "TagRegistry.h"
+
+namespace {
+
+int64_t toMs(const std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+}
+
+int64_t alignDown(const int64_t t, const int64_t step) {
+    const int64_t r = t % step;
+    return t - (r < 0 ? r + step : r);
+}
+
+} // namespace
+
+void AggregateSet::Acc::add(const double v) {
+    if (count == 0) {
+        min = max = v;
+    } else {
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+    }
+    const double y = v - comp;
+    const double t = sum + y;
+    comp = (t - sum) - y;
+    sum = t;
+    last = v;
+    ++count;
+}
+
+void AggregateSet::Acc::merge(const Acc& o) {
+    if (o.count == 0) return;
+    if (count == 0) {
+        *this = o;
+        return;
+    }
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    // 对方的和与补偿项分别按 Kahan 累加
+    for (const double x : {o.sum, -o.comp}) {
+        const double y = x - comp;
+        const double t = sum + y;
+        comp = (t - sum) - y;
+        sum = t;
+    }
+    last = o.last;
+    count += o.count;
+}
+
+std::string AggregateSet::windowLabel(const int64_t ms) {
+    if (ms % 86400000 == 0) return std::to_string(ms / 86400000) + "d";
+    if (ms % 3600000 == 0) return std::to_string(ms / 3600000) + "h";
+    if (ms % 60000 == 0) return std::to_string(ms / 60000) + "m";
+    if (ms % 1000 == 0) return std::to_string(ms / 1000) + "s";
+    return std::to_string(ms) + "ms";
+}
+
+void AggregateSet::add(const TagHandle h, const AggregateConfig& cfg) {
+    auto& reg = TagRegistry::instance();
+    const int64_t window = std::max(1, cfg.window_ms);
+    const int64_t step = cfg.step_ms > 0 ? std::min<int64_t>(cfg.step_ms, window) : window;
+    Series s;
+    s.source = h;
+    s.stepMs = step;
+    s.buckets = static_cast<uint32_t>(std::max<int64_t>(1, window / step));
+    s.base = static_cast<uint32_t>(acc_.size());
+    acc_.resize(acc_.size() + s.buckets);
+
+    const std::string label = windowLabel(window) + (cfg.step_ms > 0 ? "_" + windowLabel(step) : "");
+    const std::string id(reg.id(h));
+    const std::string name(reg.name(h));
+    static const char* const kNames[kOutputs] = {"avg", "min", "max", "last", "count"};
+    for (int k = 0; k < kOutputs; ++k) {
+        s.out[k] = std::make_shared<Variable>(id + "." + kNames[k] + "_" + label, name + " " + kNames[k] + " " + label,
+                                              L"aggregate", k == kCount ? VarType::UINT64 : VarType::DOUBLE,
+                                              VarAccess::RO);
+    }
+    series_.push_back(std::move(s));
+}
+
+void AggregateSet::update() {
+    const auto& reg = TagRegistry::instance();
+    const int64_t now = toMs(FastClock::now());
+    for (auto& s : series_) {
+        if (!s.started) {
+            s.started = true;
+            s.bucketStart = alignDown(now, s.stepMs);
+        }
+        double v;
+        VarQuality q;
+        std::chrono::system_clock::time_point ts;
+        if (reg.loadNumeric(s.source, v, q, &ts) && q != VarQuality::BAD && std::isfinite(v)) {
+            const int64_t tsMs = toMs(ts);
+            if (tsMs != s.lastSampleTs) {
+                s.lastSampleTs = tsMs;
+                // 样本按自身采集时间归桶；早于当前桶的样本（如时钟回拨）计入当前桶
+                advance(s, tsMs);
+                acc_[s.base + s.head].add(v);
+            }
+        }
+        advance(s, now);
+    }
+}
+
+void AggregateSet::advance(Series& s, const int64_t tMs) {
+    if (tMs < s.bucketStart + s.stepMs) return;
+    int64_t steps = (tMs - s.bucketStart) / s.stepMs;
+    // 每跨过一个桶边界发布一次窗口；超过一个窗口长度的空档只需清空全部桶
+    const int64_t rolls = std::min<int64_t>(steps, s.buckets);
+    for (int64_t k = 0; k < rolls; ++k) {
+        publish(s, s.bucketStart + s.stepMs);
+        s.head = (s.head + 1) % s.buckets;
+        acc_[s.base + s.head].reset();
+        s.bucketStart += s.stepMs;
+        if (s.closed < s.buckets) ++s.closed;
+    }
+    steps -= rolls;
+    if (steps > 0) {
+        s.bucketStart += steps * s.stepMs;
+        // 此时全部桶为空，发布一次空窗口标记数据中断
+        publish(s, s.bucketStart);
+    }
+}
+
+void AggregateSet::publish(const Series& s, const int64_t endMs) {
+    Acc total;
+    for (uint32_t j = 1; j <= s.buckets; ++j) total.merge(acc_[s.base + (s.head + j) % s.buckets]);
+    const auto ts = std::chrono::system_clock::time_point(std::chrono::milliseconds(endMs));
+    s.out[kCount]->setValue(total.count, VarQuality::GOOD, ts);
+    if (total.count == 0) {
+        for (const int k : {kAvg, kMin, kMax, kLast}) s.out[k]->setQuality(VarQuality::BAD, ts);
+        return;
+    }
+    const VarQuality q = s.closed < s.buckets ? VarQuality::UNCERTAIN : VarQuality::GOOD;
+    s.out[kAvg]->setValue((total.sum - total.comp) / static_cast<double>(total.count), q, ts);
+    s.out[kMin]->setValue(total.min, q, ts);
+    s.out[kMax]->setValue(total.max, q, ts);
+    s.out[kLast]->setValue(total.last, q, ts);
+}
+
+void AggregateSet::collectTagHandles(std::vector<TagHandle>& out) const {
+    for (const auto& s : series_) {
+        for (const auto& v : s.out) out.push_back(v->getHandle());
+    }
+}
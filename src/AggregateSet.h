@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Variable.h"
+
+// 聚合窗口配置：step_ms 为 0 表示翻滚窗口（每 window_ms 发布一次），
+// 否则为滑动窗口，每 step_ms 发布一次最近 window_ms 的统计；window_ms 须为 step_ms 的整数倍
+struct AggregateConfig {
+    int window_ms = 60000;
+    int step_ms = 0;
+
+    bool operator==(const AggregateConfig& o) const { return window_ms == o.window_ms && step_ms == o.step_ms; }
+    bool operator!=(const AggregateConfig& o) const { return !(*this == o); }
+};
+
+// 一个分组的聚合统计。每个（源标签, 窗口）把窗口切成 window/step 个桶，桶内只保存
+// Kahan 补偿和、最小、最大、最后值与计数，新样本 O(1) 累加，不保留原始样本。
+// 桶按墙钟对齐，跨过桶边界时合并窗口内的桶，发布为派生标签：
+//   <源 id>.avg_<窗口> / .min_ / .max_ / .last_ / .count_，滑动窗口为 <窗口>_<步长>（如 avg_15m_1m）
+// 窗口内没有样本时品质为 BAD，启动后第一个不完整的窗口品质为 UNCERTAIN。
+// 品质为 BAD、非数值或时间戳未变化的读数不计为新样本。由所属分组在采集线程内独占使用
+class AggregateSet {
+public:
+    void add(TagHandle h, const AggregateConfig& cfg);
+    [[nodiscard]] bool empty() const { return series_.empty(); }
+    // 每轮采集后调用：累加新样本并关闭到期的桶
+    void update();
+    void collectTagHandles(std::vector<TagHandle>& out) const;
+    // 窗口标签，如 500ms / 10s / 1m / 15m / 1h
+    static std::string windowLabel(int64_t ms);
+
+private:
+    struct Acc {
+        double sum = 0;
+        double comp = 0;                    // Kahan 补偿项，真实和约为 sum - comp
+        double min = 0;
+        double max = 0;
+        double last = 0;
+        uint64_t count = 0;
+
+        void add(double v);
+        void merge(const Acc& o);
+        void reset() { *this = Acc{}; }
+    };
+    enum Output { kAvg, kMin, kMax, kLast, kCount, kOutputs };
+    struct Series {
+        TagHandle source = kInvalidTag;
+        int64_t stepMs = 0;
+        uint32_t buckets = 1;
+        uint32_t base = 0;                  // 在 acc_ 中的起始下标
+        uint32_t head = 0;                  // 当前桶
+        uint32_t closed = 0;                // 已关闭的桶数，达到 buckets 前窗口不完整
+        int64_t bucketStart = 0;            // 当前桶起点，毫秒
+        int64_t lastSampleTs = 0;
+        bool started = false;
+        std::array<std::shared_ptr<Variable>, kOutputs> out;
+    };
+
+    void advance(Series& s, int64_t tMs);
+    void publish(const Series& s, int64_t endMs);
+
+    std::vector<Series> series_;
+    std::vector<Acc> acc_;
+};
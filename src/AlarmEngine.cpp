@@ -0,0 +1,180 @@
+#include "AlarmEngine.h"
+#include <algorithm>
+#include <string>
+#include "FastClock.h"
+#include "Logger.h"
+#include "TagRegistry.h"
+
+namespace {
+
+constexpr uint8_t kNormal = static_cast<uint8_t>(AlarmEngine::Level::Normal);
+constexpr uint8_t kLo = static_cast<uint8_t>(AlarmEngine::Level::Lo);
+constexpr uint8_t kLoLo = static_cast<uint8_t>(AlarmEngine::Level::LoLo);
+constexpr uint8_t kHi = static_cast<uint8_t>(AlarmEngine::Level::Hi);
+constexpr uint8_t kHiHi = static_cast<uint8_t>(AlarmEngine::Level::HiHi);
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+AlarmEngine& AlarmEngine::instance() {
+    static AlarmEngine engine;
+    return engine;
+}
+
+AlarmEngine::Level AlarmEngine::attach(const TagHandle h) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& e = entries_[h];
+    ++e.refs;
+    return e.level;
+}
+
+void AlarmEngine::detach(const TagHandle h) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const auto it = entries_.find(h);
+    if (it == entries_.end() || --it->second.refs > 0) return;
+    // 标签不再配置报警：直接移出当前报警表，不产生恢复事件
+    if (it->second.level != Level::Normal) --activeCount_;
+    entries_.erase(it);
+}
+
+void AlarmEngine::transition(const TagHandle h, const Level from, const Level to, const double value,
+                             const std::chrono::system_clock::time_point ts) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto& e = entries_[h];
+        if (e.level == Level::Normal && to != Level::Normal) ++activeCount_;
+        else if (e.level != Level::Normal && to == Level::Normal) --activeCount_;
+        e.level = to;
+        e.value = value;
+        e.since = ts;
+        events_.push_back({nextSeq_++, h, from, to, value, ts});
+        if (events_.size() > kMaxEvents) events_.pop_front();
+    }
+    const std::string msg = "报警[" + std::string(TagRegistry::instance().id(h)) + "] " + levelName(from) +
+                            " -> " + levelName(to) + "，值=" + std::to_string(value);
+    if (severity(to) > severity(from)) GLOG_WARN(msg);
+    else GLOG_INFO(msg);
+}
+
+uint64_t AlarmEngine::events(const uint64_t since, const size_t limit, std::vector<Event>& out,
+                             uint64_t* oldest) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const uint64_t head = nextSeq_ - 1;
+    const uint64_t first = events_.empty() ? nextSeq_ : events_.front().seq;
+    if (oldest) *oldest = first;
+    // 事件序号连续，按偏移直接定位
+    const uint64_t from = std::max(since + 1, first);
+    for (uint64_t s = from; s <= head && out.size() < limit; ++s) out.push_back(events_[s - first]);
+    return head;
+}
+
+void AlarmEngine::active(std::vector<Active>& out) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    out.reserve(out.size() + activeCount_);
+    for (const auto& [h, e] : entries_) {
+        if (e.level != Level::Normal) out.push_back({h, e.level, e.value, e.since});
+    }
+}
+
+AlarmEngine::Stats AlarmEngine::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return {entries_.size(), activeCount_, nextSeq_ - 1};
+}
+
+const char* AlarmEngine::levelName(const Level level) {
+    switch (level) {
+        case Level::Lo:   return "LO";
+        case Level::LoLo: return "LOLO";
+        case Level::Hi:   return "HI";
+        case Level::HiHi: return "HIHI";
+        default:          return "NORMAL";
+    }
+}
+
+int AlarmEngine::severity(const Level level) {
+    switch (level) {
+        case Level::Lo: case Level::Hi:     return 1;
+        case Level::LoLo: case Level::HiHi: return 2;
+        default:                            return 0;
+    }
+}
+
+AlarmSet::~AlarmSet() {
+    auto& engine = AlarmEngine::instance();
+    for (const TagHandle h : handles_) engine.detach(h);
+}
+
+void AlarmSet::add(const TagHandle h, const AlarmLimits& limits) {
+    const auto level = static_cast<uint8_t>(AlarmEngine::instance().attach(h));
+    handles_.push_back(h);
+    hihi_.push_back(limits.hihi);
+    hi_.push_back(limits.hi);
+    lo_.push_back(limits.lo);
+    lolo_.push_back(limits.lolo);
+    deadband_.push_back(std::max(0.0, limits.deadband));
+    onDelay_.push_back(std::max(0, limits.on_delay_ms));
+    offDelay_.push_back(std::max(0, limits.off_delay_ms));
+    value_.push_back(0);
+    valid_.push_back(0);
+    state_.push_back(level);
+    target_.push_back(level);
+    pending_.push_back(level);
+    pendingSince_.push_back(0);
+}
+
+void AlarmSet::evaluate() {
+    const size_t n = handles_.size();
+    const auto& reg = TagRegistry::instance();
+    for (size_t i = 0; i < n; ++i) {
+        VarQuality q;
+        valid_[i] = reg.loadNumeric(handles_[i], value_[i], q) && q != VarQuality::BAD;
+    }
+
+    // 级别判定：连续数组上的无分支循环，编译器可向量化。
+    // 已处于某级别（或更高级别）时，该级别的退出阈值向内让出死区
+    const double* v = value_.data();
+    const double* db = deadband_.data();
+    const uint8_t* s = state_.data();
+    const uint8_t* ok = valid_.data();
+    uint8_t* t = target_.data();
+    size_t changed = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double hh = hihi_[i] - (s[i] == kHiHi ? db[i] : 0.0);
+        const double h = hi_[i] - (s[i] >= kHi ? db[i] : 0.0);
+        const double ll = lolo_[i] + (s[i] == kLoLo ? db[i] : 0.0);
+        const double l = lo_[i] + (s[i] == kLo || s[i] == kLoLo ? db[i] : 0.0);
+        uint8_t level = v[i] <= l ? kLo : kNormal;
+        level = v[i] <= ll ? kLoLo : level;
+        level = v[i] >= h ? kHi : level;
+        level = v[i] >= hh ? kHiHi : level;
+        // NaN 的比较全为假，与无效值一样保持原级别
+        const bool use = ok[i] && v[i] == v[i];
+        t[i] = use ? level : s[i];
+        changed += t[i] != s[i] || pending_[i] != s[i];
+    }
+    if (changed == 0) return;
+
+    const int64_t now = steadyMs();
+    const auto ts = FastClock::now();
+    for (size_t i = 0; i < n; ++i) {
+        if (t[i] == state_[i]) {
+            pending_[i] = state_[i];
+            continue;
+        }
+        if (pending_[i] != t[i]) {
+            pending_[i] = t[i];
+            pendingSince_[i] = now;
+        }
+        const auto from = static_cast<AlarmEngine::Level>(state_[i]);
+        const auto to = static_cast<AlarmEngine::Level>(t[i]);
+        // 升级或同级换向（HI <-> LO）按报警延时，降级与恢复按解除延时
+        const int64_t delay = AlarmEngine::severity(to) >= AlarmEngine::severity(from) ? onDelay_[i] : offDelay_[i];
+        if (now - pendingSince_[i] < delay) continue;
+        state_[i] = t[i];
+        AlarmEngine::instance().transition(handles_[i], from, to, v[i], ts);
+    }
+}
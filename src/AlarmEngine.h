@@ -0,0 +1,116 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Variable.h"
+
+// 限值报警配置：未配置的限值为 ±inf。进入报警按 value >= hi / value <= lo 判断，
+// 退出时需回到限值以内 deadband；onDelayMs / offDelayMs 为升级 / 降级需持续的时间
+struct AlarmLimits {
+    double hihi = std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    double lo = -std::numeric_limits<double>::infinity();
+    double lolo = -std::numeric_limits<double>::infinity();
+    double deadband = 0.0;
+    int on_delay_ms = 0;
+    int off_delay_ms = 0;
+
+    [[nodiscard]] bool isEnabled() const {
+        return hihi != std::numeric_limits<double>::infinity() || hi != std::numeric_limits<double>::infinity() ||
+               lo != -std::numeric_limits<double>::infinity() || lolo != -std::numeric_limits<double>::infinity();
+    }
+    bool operator==(const AlarmLimits& o) const {
+        return hihi == o.hihi && hi == o.hi && lo == o.lo && lolo == o.lolo && deadband == o.deadband &&
+               on_delay_ms == o.on_delay_ms && off_delay_ms == o.off_delay_ms;
+    }
+};
+
+// 全局报警表：当前处于报警的标签与最近的状态变化事件。事件序号单调递增，
+// 客户端按 since 增量读取；事件队列定长，滚出的事件不再可取
+class AlarmEngine {
+public:
+    enum class Level : uint8_t { Normal, Lo, LoLo, Hi, HiHi };
+    struct Event {
+        uint64_t seq = 0;
+        TagHandle handle = kInvalidTag;
+        Level from = Level::Normal;
+        Level to = Level::Normal;
+        double value = 0;
+        std::chrono::system_clock::time_point timestamp;
+    };
+    struct Active {
+        TagHandle handle = kInvalidTag;
+        Level level = Level::Normal;
+        double value = 0;                    // 进入当前级别时的值
+        std::chrono::system_clock::time_point since;
+    };
+    struct Stats {
+        size_t tags = 0;                     // 配置了报警的标签数
+        size_t active = 0;
+        uint64_t events = 0;
+    };
+    static constexpr size_t kMaxEvents = 10000;
+
+    static AlarmEngine& instance();
+    AlarmEngine(const AlarmEngine&) = delete;
+    AlarmEngine& operator=(const AlarmEngine&) = delete;
+
+    // 分组登记 / 注销报警标签；同一标签可被新旧分组同时持有（热加载），返回当前级别以便延续状态
+    Level attach(TagHandle h);
+    void detach(TagHandle h);
+    void transition(TagHandle h, Level from, Level to, double value, std::chrono::system_clock::time_point ts);
+
+    // 取 seq > since 的事件，最多 limit 条；返回当前最大事件序号，oldest 为仍可取的最旧序号
+    uint64_t events(uint64_t since, size_t limit, std::vector<Event>& out, uint64_t* oldest = nullptr) const;
+    void active(std::vector<Active>& out) const;
+    [[nodiscard]] Stats getStats() const;
+    static const char* levelName(Level level);
+    // 严重程度：Lo/Hi 为 1，LoLo/HiHi 为 2
+    static int severity(Level level);
+
+private:
+    AlarmEngine() = default;
+
+    struct Entry {
+        uint32_t refs = 0;
+        Level level = Level::Normal;
+        double value = 0;
+        std::chrono::system_clock::time_point since;
+    };
+
+    mutable std::mutex mtx_;
+    std::unordered_map<TagHandle, Entry> entries_;
+    std::deque<Event> events_;
+    uint64_t nextSeq_ = 1;
+    size_t activeCount_ = 0;
+};
+
+// 一个分组的报警限值，按列存放，与每轮采集得到的值数组平行。
+// 每轮采集后对整组做一次无分支的级别判定，只有级别发生变化（且满足延时）的标签才上报事件。
+// 由所属分组在采集线程内独占使用
+class AlarmSet {
+public:
+    AlarmSet() = default;
+    ~AlarmSet();
+    AlarmSet(const AlarmSet&) = delete;
+    AlarmSet& operator=(const AlarmSet&) = delete;
+
+    void add(TagHandle h, const AlarmLimits& limits);
+    [[nodiscard]] bool empty() const { return handles_.empty(); }
+    [[nodiscard]] size_t size() const { return handles_.size(); }
+    // 无值、非数值或品质为 BAD 的标签保持原级别
+    void evaluate();
+
+private:
+    std::vector<TagHandle> handles_;
+    std::vector<double> hihi_, hi_, lo_, lolo_, deadband_;
+    std::vector<int64_t> onDelay_, offDelay_;
+    std::vector<double> value_;
+    std::vector<uint8_t> valid_;
+    std::vector<uint8_t> state_, target_, pending_;
+    std::vector<int64_t> pendingSince_;  // 毫秒，steady_clock
+};
@@ -0,0 +1,560 @@
+#include "CalcEngine.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include "DataBuffer.h"
+#include "FastClock.h"
+#include "Logger.h"
+#include "TagRegistry.h"
+
+namespace {
+constexpr uint32_t kMaxStack = 64;
+constexpr auto kResolveEvery = std::chrono::seconds(5);   // 输入标签随设备热加载增删，定期重新查找句柄
+
+using Op = CalcEngine::Op;
+
+struct FuncDef {
+    const char* name;
+    Op op;
+    int arity;
+};
+constexpr FuncDef kFuncs[] = {
+    {"abs", Op::Abs, 1}, {"sqrt", Op::Sqrt, 1}, {"floor", Op::Floor, 1}, {"ceil", Op::Ceil, 1},
+    {"round", Op::Round, 1}, {"exp", Op::Exp, 1}, {"ln", Op::Ln, 1}, {"log10", Op::Log10, 1},
+    {"min", Op::Min, 2}, {"max", Op::Max, 2}, {"pow", Op::Pow, 2}, {"bit", Op::Bit, 2},
+    {"if", Op::Select, 3},
+};
+
+struct BinaryDef {
+    const char* token;
+    Op op;
+    int prec;
+};
+// 按长度优先匹配
+constexpr BinaryDef kBinary[] = {
+    {"||", Op::Or, 1}, {"&&", Op::And, 2}, {"==", Op::Eq, 6}, {"!=", Op::Ne, 6},
+    {"<=", Op::Le, 7}, {">=", Op::Ge, 7}, {"<<", Op::Shl, 8}, {">>", Op::Shr, 8},
+    {"|", Op::BitOr, 3}, {"^", Op::BitXor, 4}, {"&", Op::BitAnd, 5}, {"<", Op::Lt, 7}, {">", Op::Gt, 7},
+    {"+", Op::Add, 9}, {"-", Op::Sub, 9}, {"*", Op::Mul, 10}, {"/", Op::Div, 10}, {"%", Op::Mod, 10},
+};
+
+bool identStart(const char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+bool identChar(const char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.'; }
+
+// 递归下降编译为后缀字节码，同时跟踪栈深度
+class Compiler {
+public:
+    Compiler(const std::string_view src, CalcEngine::Program& prog, std::vector<std::string>& refs)
+        : s_(src), prog_(prog), refs_(refs) {}
+
+    bool run(std::string& error) {
+        try {
+            ternary();
+            skipWs();
+            if (pos_ != s_.size()) fail("unexpected '" + std::string(1, s_[pos_]) + "'");
+            prog_.maxStack = maxDepth_;
+            return true;
+        } catch (const std::runtime_error& e) {
+            error = std::string(e.what()) + " at " + std::to_string(pos_);
+            return false;
+        }
+    }
+
+private:
+    [[noreturn]] static void fail(const std::string& msg) { throw std::runtime_error(msg); }
+
+    void skipWs() {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_;
+    }
+    bool accept(const char c) {
+        skipWs();
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+    void expect(const char c) {
+        if (!accept(c)) fail(std::string("expected '") + c + "'");
+    }
+    void emit(const Op op, const uint32_t arg, const int pops, const int pushes) {
+        prog_.code.push_back({op, arg});
+        depth_ += pushes - pops;
+        if (depth_ > static_cast<int>(kMaxStack)) fail("expression too deep");
+        maxDepth_ = std::max(maxDepth_, static_cast<uint32_t>(depth_));
+    }
+
+    void ternary() {
+        binary(1);
+        if (accept('?')) {
+            ternary();
+            expect(':');
+            ternary();
+            emit(Op::Select, 0, 3, 1);
+        }
+    }
+
+    const BinaryDef* peekBinary() {
+        skipWs();
+        for (const auto& def : kBinary) {
+            const std::string_view tok(def.token);
+            if (s_.compare(pos_, tok.size(), tok) != 0) continue;
+            // 单字符 & | 不能是 && || 的前半
+            if (tok.size() == 1 && pos_ + 1 < s_.size() && (tok[0] == '&' || tok[0] == '|') && s_[pos_ + 1] == tok[0])
+                continue;
+            return &def;
+        }
+        return nullptr;
+    }
+
+    void binary(const int minPrec) {
+        unary();
+        while (const BinaryDef* def = peekBinary()) {
+            if (def->prec < minPrec) break;
+            pos_ += std::string_view(def->token).size();
+            binary(def->prec + 1);
+            emit(def->op, 0, 2, 1);
+        }
+    }
+
+    void unary() {
+        if (accept('-')) { unary(); emit(Op::Neg, 0, 1, 1); return; }
+        if (accept('+')) { unary(); return; }
+        if (accept('~')) { unary(); emit(Op::BitNot, 0, 1, 1); return; }
+        skipWs();
+        if (pos_ < s_.size() && s_[pos_] == '!' && !(pos_ + 1 < s_.size() && s_[pos_ + 1] == '=')) {
+            ++pos_;
+            unary();
+            emit(Op::Not, 0, 1, 1);
+            return;
+        }
+        primary();
+    }
+
+    void primary() {
+        skipWs();
+        if (pos_ >= s_.size()) fail("unexpected end");
+        const char c = s_[pos_];
+        if (c == '(') {
+            ++pos_;
+            ternary();
+            expect(')');
+            return;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            number();
+            return;
+        }
+        if (c == '{') {
+            const auto end = s_.find('}', pos_ + 1);
+            if (end == std::string_view::npos || end == pos_ + 1) fail("bad tag reference");
+            ref(s_.substr(pos_ + 1, end - pos_ - 1));
+            pos_ = end + 1;
+            return;
+        }
+        if (!identStart(c)) fail("unexpected '" + std::string(1, c) + "'");
+        const size_t start = pos_;
+        while (pos_ < s_.size() && identChar(s_[pos_])) ++pos_;
+        const auto name = s_.substr(start, pos_ - start);
+        if (accept('(')) {
+            const auto fn = std::find_if(std::begin(kFuncs), std::end(kFuncs),
+                                         [&name](const FuncDef& f) { return name == f.name; });
+            if (fn == std::end(kFuncs)) fail("unknown function " + std::string(name));
+            for (int i = 0; i < fn->arity; ++i) {
+                if (i) expect(',');
+                ternary();
+            }
+            expect(')');
+            emit(fn->op, 0, fn->arity, 1);
+            return;
+        }
+        ref(name);
+    }
+
+    void number() {
+        const char* begin = s_.data() + pos_;
+        char* end = nullptr;
+        double v;
+        if (s_.size() - pos_ > 2 && s_[pos_] == '0' && (s_[pos_ + 1] == 'x' || s_[pos_ + 1] == 'X')) {
+            v = static_cast<double>(std::strtoull(begin + 2, &end, 16));
+        } else {
+            v = std::strtod(begin, &end);
+        }
+        // strtod 会越过表达式结尾读取，只接受 s_ 范围内的部分
+        if (end == begin || end > s_.data() + s_.size()) fail("bad number");
+        pos_ = static_cast<size_t>(end - s_.data());
+        prog_.consts.push_back(v);
+        emit(Op::Const, static_cast<uint32_t>(prog_.consts.size() - 1), 0, 1);
+    }
+
+    void ref(const std::string_view id) {
+        auto it = std::find(refs_.begin(), refs_.end(), id);
+        if (it == refs_.end()) it = refs_.insert(refs_.end(), std::string(id));
+        emit(Op::Load, static_cast<uint32_t>(it - refs_.begin()), 0, 1);
+    }
+
+    std::string_view s_;
+    size_t pos_ = 0;
+    CalcEngine::Program& prog_;
+    std::vector<std::string>& refs_;
+    int depth_ = 0;
+    uint32_t maxDepth_ = 0;
+};
+
+int64_t toInt(const double v) {
+    return std::fabs(v) < 9.2e18 ? static_cast<int64_t>(v) : 0;
+}
+
+// BAD 最差，其次 UNCERTAIN
+int qualityRank(const VarQuality q) {
+    switch (q) {
+        case VarQuality::GOOD: return 0;
+        case VarQuality::UNCERTAIN: return 1;
+        default: return 2;
+    }
+}
+
+bool toDouble(const Variable::ValueType& value, double& out) {
+    return std::visit([&out](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+            return false;
+        } else {
+            out = static_cast<double>(v);
+            return true;
+        }
+    }, value);
+}
+
+template<class T>
+T clampTo(const double v) {
+    if (v <= static_cast<double>(std::numeric_limits<T>::min())) return std::numeric_limits<T>::min();
+    if (v >= static_cast<double>(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+    return static_cast<T>(std::round(v));
+}
+}
+
+double CalcEngine::Program::run(const double* inputs) const {
+    double st[kMaxStack];
+    int sp = 0;
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case Op::Const:  st[sp++] = consts[in.arg]; break;
+            case Op::Load:   st[sp++] = inputs[in.arg]; break;
+            case Op::Neg:    st[sp - 1] = -st[sp - 1]; break;
+            case Op::Not:    st[sp - 1] = st[sp - 1] == 0 ? 1 : 0; break;
+            case Op::BitNot: st[sp - 1] = static_cast<double>(~toInt(st[sp - 1])); break;
+            case Op::Abs:    st[sp - 1] = std::fabs(st[sp - 1]); break;
+            case Op::Sqrt:   st[sp - 1] = std::sqrt(st[sp - 1]); break;
+            case Op::Floor:  st[sp - 1] = std::floor(st[sp - 1]); break;
+            case Op::Ceil:   st[sp - 1] = std::ceil(st[sp - 1]); break;
+            case Op::Round:  st[sp - 1] = std::round(st[sp - 1]); break;
+            case Op::Exp:    st[sp - 1] = std::exp(st[sp - 1]); break;
+            case Op::Ln:     st[sp - 1] = std::log(st[sp - 1]); break;
+            case Op::Log10:  st[sp - 1] = std::log10(st[sp - 1]); break;
+            case Op::Select:
+                sp -= 2;
+                st[sp - 1] = st[sp - 1] != 0 ? st[sp] : st[sp + 1];
+                break;
+            default: {
+                const double b = st[--sp];
+                double& a = st[sp - 1];
+                switch (in.op) {
+                    case Op::Add:    a = a + b; break;
+                    case Op::Sub:    a = a - b; break;
+                    case Op::Mul:    a = a * b; break;
+                    case Op::Div:    a = a / b; break;
+                    case Op::Mod:    a = std::fmod(a, b); break;
+                    case Op::Lt:     a = a < b; break;
+                    case Op::Le:     a = a <= b; break;
+                    case Op::Gt:     a = a > b; break;
+                    case Op::Ge:     a = a >= b; break;
+                    case Op::Eq:     a = a == b; break;
+                    case Op::Ne:     a = a != b; break;
+                    case Op::And:    a = a != 0 && b != 0; break;
+                    case Op::Or:     a = a != 0 || b != 0; break;
+                    case Op::BitAnd: a = static_cast<double>(toInt(a) & toInt(b)); break;
+                    case Op::BitOr:  a = static_cast<double>(toInt(a) | toInt(b)); break;
+                    case Op::BitXor: a = static_cast<double>(toInt(a) ^ toInt(b)); break;
+                    case Op::Shl:    a = static_cast<double>(static_cast<int64_t>(static_cast<uint64_t>(toInt(a)) << (toInt(b) & 63))); break;
+                    case Op::Shr:    a = static_cast<double>(toInt(a) >> (toInt(b) & 63)); break;
+                    case Op::Min:    a = std::min(a, b); break;
+                    case Op::Max:    a = std::max(a, b); break;
+                    case Op::Pow:    a = std::pow(a, b); break;
+                    case Op::Bit:    a = static_cast<double>((toInt(a) >> (toInt(b) & 63)) & 1); break;
+                    default: break;
+                }
+            }
+        }
+    }
+    return sp == 1 ? st[0] : std::numeric_limits<double>::quiet_NaN();
+}
+
+bool CalcEngine::compile(const std::string_view expr, Program& prog, std::vector<std::string>& refs, std::string& error) {
+    prog = Program{};
+    refs.clear();
+    return Compiler(expr, prog, refs).run(error);
+}
+
+CalcEngine::CalcEngine(std::shared_ptr<TimerScheduler> scheduler, const uint32_t intervalMs)
+    : scheduler_(std::move(scheduler)), intervalMs_(std::max<uint32_t>(10, intervalMs)) {}
+
+CalcEngine::~CalcEngine() {
+    if (timer_) scheduler_->cancel(timer_);
+}
+
+void CalcEngine::start() {
+    if (timer_) return;
+    std::weak_ptr<CalcEngine> weakSelf = shared_from_this();
+    timer_ = scheduler_->scheduleEvery(intervalMs_, [weakSelf]() {
+        if (const auto self = weakSelf.lock()) self->cycle();
+    }, intervalMs_, TaskPriority::HIGH);
+}
+
+void CalcEngine::load(const std::vector<CalcTagConfig>& configs) {
+    auto& reg = TagRegistry::instance();
+    struct Candidate {
+        const CalcTagConfig* cfg;
+        Program prog;
+        std::vector<std::string> refs;
+    };
+    std::vector<Candidate> cands;
+    std::unordered_map<std::string, size_t> byId;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& c : configs) {
+        Candidate cand{&c, {}, {}};
+        std::string error;
+        if (!compile(c.expr, cand.prog, cand.refs, error)) {
+            GLOG_ERROR("计算标签 " + c.id + " 表达式错误: " + error);
+            continue;
+        }
+        if (byId.count(c.id)) {
+            GLOG_ERROR("计算标签 id 重复: " + c.id);
+            continue;
+        }
+        // 不能覆盖设备变量
+        if (!vars_.count(c.id) && reg.find(c.id) != kInvalidTag) {
+            GLOG_ERROR("计算标签 " + c.id + " 与已有变量同名");
+            continue;
+        }
+        byId.emplace(c.id, cands.size());
+        cands.push_back(std::move(cand));
+    }
+
+    // Kahn 拓扑排序；剩余的公式处于环中
+    std::vector<int> indegree(cands.size(), 0);
+    std::vector<std::vector<size_t>> downstream(cands.size());
+    for (size_t i = 0; i < cands.size(); ++i) {
+        for (const auto& r : cands[i].refs) {
+            if (const auto it = byId.find(r); it != byId.end()) {
+                downstream[it->second].push_back(i);
+                ++indegree[i];
+            }
+        }
+    }
+    std::vector<size_t> order;
+    for (size_t i = 0; i < cands.size(); ++i) {
+        if (indegree[i] == 0) order.push_back(i);
+    }
+    for (size_t k = 0; k < order.size(); ++k) {
+        for (const size_t d : downstream[order[k]]) {
+            if (--indegree[d] == 0) order.push_back(d);
+        }
+    }
+    std::vector<bool> inCycle(cands.size(), true);
+    for (const size_t i : order) inCycle[i] = false;
+    for (size_t i = 0; i < cands.size(); ++i) {
+        if (inCycle[i]) GLOG_ERROR("计算标签 " + cands[i].cfg->id + " 存在循环依赖，已忽略");
+    }
+
+    // 按拓扑序建立公式与输入槽位；先放开旧公式持有的变量，类型变化的计算标签才能重新注册
+    formulas_.clear();
+    std::vector<Formula> formulas;
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, uint32_t> slotOf;
+    std::unordered_map<std::string, int> formulaOf;
+    std::unordered_map<std::string, std::shared_ptr<Variable>> vars;
+    for (const size_t ci : order) {
+        auto& cand = cands[ci];
+        const auto& cfg = *cand.cfg;
+        Formula f;
+        f.id = cfg.id;
+        f.type = cfg.varType;
+        f.prog = std::move(cand.prog);
+        for (const auto& r : cand.refs) {
+            auto [it, added] = slotOf.emplace(r, static_cast<uint32_t>(slots.size()));
+            if (added) {
+                Slot s;
+                s.id = r;
+                if (const auto fit = formulaOf.find(r); fit != formulaOf.end()) {
+                    s.producer = fit->second;
+                    formulas[fit->second].outSlot = it->second;
+                }
+                slots.push_back(std::move(s));
+            }
+            f.prog.slots.push_back(it->second);
+        }
+        // 保留同 id、同类型的现有变量，热加载不丢当前值
+        if (const auto vit = vars_.find(cfg.id); vit != vars_.end() && vit->second->getType() == cfg.varType) {
+            f.var = vit->second;
+        } else {
+            if (vit != vars_.end()) vars_.erase(vit);
+            f.var = std::make_shared<Variable>(cfg.id, cfg.name, L"calc", cfg.varType, VarAccess::RO);
+        }
+        vars.emplace(cfg.id, f.var);
+        formulaOf.emplace(cfg.id, static_cast<int>(formulas.size()));
+        formulas.push_back(std::move(f));
+    }
+
+    // 槽位 -> 消费公式（CSR）
+    std::vector<std::vector<uint32_t>> users(slots.size());
+    for (size_t fi = 0; fi < formulas.size(); ++fi) {
+        for (const uint32_t s : formulas[fi].prog.slots) users[s].push_back(static_cast<uint32_t>(fi));
+    }
+    consumerStart_.assign(1, 0);
+    consumers_.clear();
+    for (const auto& u : users) {
+        consumers_.insert(consumers_.end(), u.begin(), u.end());
+        consumerStart_.push_back(static_cast<uint32_t>(consumers_.size()));
+    }
+
+    formulas_ = std::move(formulas);
+    slots_ = std::move(slots);
+    values_.assign(slots_.size(), 0.0);
+    externals_.clear();
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].producer < 0) externals_.push_back(i);
+    }
+    dirty_.assign(formulas_.size(), 1);
+    vars_ = std::move(vars);     // 被移除的计算标签随变量析构释放
+    stats_.formulas = formulas_.size();
+    stats_.inputs = externals_.size();
+    lastSeq_ = reg.changeSeq();
+    resolveInputs();
+    nextResolve_ = std::chrono::steady_clock::now() + kResolveEvery;
+    GLOG_INFO("计算标签已加载: " + std::to_string(formulas_.size()) + " 条公式，" +
+              std::to_string(externals_.size()) + " 个输入标签");
+}
+
+void CalcEngine::resolveInputs() {
+    auto& reg = TagRegistry::instance();
+    for (const uint32_t i : externals_) {
+        auto& s = slots_[i];
+        const TagHandle h = reg.find(s.id);
+        if (h == s.handle && s.valid) continue;
+        s.handle = h;
+        s.valid = false;
+        if (h != kInvalidTag) {
+            const auto sample = reg.loadPublished(h);
+            s.valid = sample.hasValue && toDouble(sample.value, values_[i]);
+            s.quality = sample.quality;
+        }
+        markConsumers(i);
+    }
+}
+
+void CalcEngine::markConsumers(const uint32_t slot) {
+    for (uint32_t k = consumerStart_[slot]; k < consumerStart_[slot + 1]; ++k) dirty_[consumers_[k]] = 1;
+}
+
+void CalcEngine::cycle() {
+    std::unique_lock<std::mutex> lock(mtx_, std::try_to_lock);
+    if (!lock.owns_lock()) return;     // 上一周期尚未结束
+    auto& reg = TagRegistry::instance();
+    const auto t0 = std::chrono::steady_clock::now();
+    if (t0 >= nextResolve_) {
+        resolveInputs();
+        nextResolve_ = t0 + kResolveEvery;
+    }
+    // 全局序号未变时无需逐个检查输入。changeSeq 为已提交水位：先取水位再扫描，
+    // 不大于水位的变化都已写入 changedAt，以水位作为下次起点不会漏掉仍在写入中的变化
+    if (const uint64_t seq = reg.changeSeq(); seq > lastSeq_) {
+        for (const uint32_t i : externals_) {
+            auto& s = slots_[i];
+            if (s.handle == kInvalidTag || reg.changedAt(s.handle) <= lastSeq_) continue;
+            const auto sample = reg.loadPublished(s.handle);
+            s.valid = sample.hasValue && toDouble(sample.value, values_[i]);
+            s.quality = sample.quality;
+            markConsumers(i);
+        }
+        lastSeq_ = seq;
+    }
+
+    bool evaluated = false;
+    std::chrono::system_clock::time_point ts{};
+    for (size_t fi = 0; fi < formulas_.size(); ++fi) {
+        if (!dirty_[fi]) continue;
+        dirty_[fi] = 0;
+        if (!evaluated) {
+            ts = FastClock::now();
+            evaluated = true;
+        }
+        auto& f = formulas_[fi];
+        frame_.resize(f.prog.slots.size());
+        bool ok = true;
+        int rank = 0;
+        for (size_t k = 0; k < f.prog.slots.size(); ++k) {
+            const auto& s = slots_[f.prog.slots[k]];
+            ok = ok && s.valid;
+            rank = std::max(rank, qualityRank(s.quality));
+            frame_[k] = values_[f.prog.slots[k]];
+        }
+        const double v = ok ? f.prog.run(frame_.data()) : std::numeric_limits<double>::quiet_NaN();
+        const bool finite = std::isfinite(v);
+        const VarQuality q = !finite ? VarQuality::BAD
+                           : rank == 0 ? VarQuality::GOOD : rank == 1 ? VarQuality::UNCERTAIN : VarQuality::BAD;
+        ++stats_.evaluations;
+        if (f.published && q == f.lastQuality && (!finite || v == f.lastValue)) continue;
+        if (finite) {
+            f.var->setValue(toValue(v, f.type), q, ts);
+            f.lastValue = v;
+        } else {
+            f.var->setQuality(VarQuality::BAD, ts);
+        }
+        f.published = true;
+        f.lastQuality = q;
+        if (f.outSlot < slots_.size()) {
+            values_[f.outSlot] = f.lastValue;
+            slots_[f.outSlot].valid = finite;
+            slots_[f.outSlot].quality = q;
+            markConsumers(f.outSlot);
+        }
+    }
+    if (evaluated) {
+        const auto us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count());
+        ++stats_.cycles;
+        stats_.lastCycleUs = us;
+        stats_.maxCycleUs = std::max(stats_.maxCycleUs, us);
+    }
+}
+
+Variable::ValueType CalcEngine::toValue(const double v, const VarType type) {
+    switch (type) {
+        case VarType::BOOL:   return v != 0;
+        case VarType::INT16:  return clampTo<int16_t>(v);
+        case VarType::UINT16: return clampTo<uint16_t>(v);
+        case VarType::INT32:  return clampTo<int32_t>(v);
+        case VarType::UINT32: return clampTo<uint32_t>(v);
+        case VarType::INT64:  return clampTo<int64_t>(v);
+        case VarType::UINT64: return clampTo<uint64_t>(v);
+        case VarType::FLOAT:  return static_cast<float>(v);
+        default:              return v;
+    }
+}
+
+CalcEngine::Stats CalcEngine::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+void CalcEngine::collectTagHandles(std::vector<TagHandle>& out) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& f : formulas_) out.push_back(f.var->getHandle());
+}
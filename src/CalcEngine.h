@@ -0,0 +1,112 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "JsonConfig.h"
+#include "TimerScheduler.h"
+#include "Variable.h"
+
+// 计算标签：配置中的表达式在加载时编译为栈式字节码，按依赖关系拓扑排序。
+// 每个周期只检查输入标签的变化序号，仅对输入发生变化的公式（及其下游公式）求值，
+// 结果像普通变量一样写入 DataBuffer。
+// 表达式语法：
+//   数值 12 / 1.5e3 / 0x1F，标签引用 dev1.flow_a 或 {任意 id}（可引用其他计算标签）
+//   运算符 ?: || && | ^ & == != < <= > >= << >> + - * / % 及一元 - ! ~
+//   函数 abs sqrt floor ceil round exp ln log10 min max pow bit(x,n) if(c,a,b)
+// 全部按 double 计算，位运算先取整为 int64；分支两侧都会求值（无副作用）。
+// 结果品质取所有输入中最差者；输入缺失、非数值或结果非有限数时品质为 BAD
+class CalcEngine : public std::enable_shared_from_this<CalcEngine> {
+public:
+    struct Stats {
+        size_t formulas = 0;
+        size_t inputs = 0;              // 外部输入标签数
+        uint64_t cycles = 0;            // 有变化需要求值的周期数
+        uint64_t evaluations = 0;
+        uint64_t lastCycleUs = 0;
+        uint64_t maxCycleUs = 0;
+    };
+
+    CalcEngine(std::shared_ptr<TimerScheduler> scheduler, uint32_t intervalMs);
+    ~CalcEngine();
+
+    void start();
+    // 编译并替换全部公式；同 id 的计算标签保留其变量与当前值。编译失败或成环的公式记录错误后跳过
+    void load(const std::vector<CalcTagConfig>& configs);
+    [[nodiscard]] Stats getStats() const;
+    void collectTagHandles(std::vector<TagHandle>& out) const;
+
+    // 编译单个表达式；引用的标签 id 按出现顺序去重写入 refs，失败时返回 false 并给出 error
+    struct Program;
+    static bool compile(std::string_view expr, Program& prog, std::vector<std::string>& refs, std::string& error);
+
+    enum class Op : uint8_t {
+        Const, Load,
+        Neg, Not, BitNot,
+        Add, Sub, Mul, Div, Mod,
+        Lt, Le, Gt, Ge, Eq, Ne, And, Or,
+        BitAnd, BitOr, BitXor, Shl, Shr,
+        Abs, Sqrt, Floor, Ceil, Round, Exp, Ln, Log10,
+        Min, Max, Pow, Bit, Select,
+    };
+    struct Instr {
+        Op op;
+        uint32_t arg;                    // Const: 常量下标；Load: 引用下标
+    };
+    struct Program {
+        std::vector<Instr> code;
+        std::vector<double> consts;
+        uint32_t maxStack = 0;
+        // refs[i] 对应的输入槽位，load 时填写
+        std::vector<uint32_t> slots;
+        [[nodiscard]] double run(const double* inputs) const;
+    };
+
+private:
+    // 输入槽位：外部标签（从 TagRegistry 读取）或另一条公式的结果
+    struct Slot {
+        std::string id;
+        TagHandle handle = kInvalidTag;
+        int producer = -1;               // 产生该值的公式下标，-1 表示外部标签
+        bool valid = false;
+        VarQuality quality = VarQuality::BAD;
+    };
+    struct Formula {
+        std::string id;
+        VarType type = VarType::DOUBLE;
+        Program prog;
+        std::shared_ptr<Variable> var;
+        uint32_t outSlot = 0xFFFFFFFF;   // 被其他公式引用时的槽位
+        bool published = false;
+        double lastValue = 0;
+        VarQuality lastQuality = VarQuality::BAD;
+    };
+
+    void cycle();
+    void resolveInputs();
+    void markConsumers(uint32_t slot);
+    static Variable::ValueType toValue(double v, VarType type);
+
+    std::shared_ptr<TimerScheduler> scheduler_;
+    uint32_t intervalMs_;
+    TimerScheduler::TimerHandle timer_ = 0;
+
+    mutable std::mutex mtx_;            // 周期求值与重新加载互斥
+    std::vector<Formula> formulas_;     // 拓扑序
+    std::vector<Slot> slots_;
+    std::vector<double> values_;        // 与 slots_ 对应
+    std::vector<uint32_t> externals_;   // 外部输入槽位
+    // 槽位 -> 引用它的公式（CSR）
+    std::vector<uint32_t> consumerStart_;
+    std::vector<uint32_t> consumers_;
+    std::vector<uint8_t> dirty_;
+    std::vector<double> frame_;         // 单条公式的输入值，按其 refs 顺序
+    std::unordered_map<std::string, std::shared_ptr<Variable>> vars_;
+    uint64_t lastSeq_ = 0;              // 上次扫描时的已提交变化序号水位
+    std::chrono::steady_clock::time_point nextResolve_;
+    Stats stats_;
+};
@@ -0,0 +1,285 @@
+#include "ChangeLog.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "Logger.h"
+
+namespace {
+constexpr char kSegMagic[4] = {'G', 'W', 'C', 'L'};
+constexpr uint32_t kSegVersion = 1;
+constexpr std::streamoff kSegHeaderBytes = 16;      // 魔数 + 版本 + 段首序号
+constexpr auto kSpillInterval = std::chrono::milliseconds(200);
+
+uint64_t roundUpPow2(uint64_t v) {
+    uint64_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+}
+
+ChangeLog& ChangeLog::instance() {
+    static ChangeLog log;
+    return log;
+}
+
+ChangeLog::ChangeLog() {
+    mask_ = roundUpPow2(cfg_.capacity) - 1;
+    ring_ = std::make_unique<Record[]>(mask_ + 1);
+}
+
+ChangeLog::~ChangeLog() {
+    stop();
+}
+
+void ChangeLog::configure(const Config& cfg) {
+    if (started_.load() || running_.load()) {
+        GLOG_WARN("ChangeLog 已有记录写入，忽略重新配置");
+        return;
+    }
+    cfg_ = cfg;
+    cfg_.capacity = std::max<uint32_t>(cfg_.capacity, 1024);
+    mask_ = roundUpPow2(cfg_.capacity) - 1;
+    ring_ = std::make_unique<Record[]>(mask_ + 1);
+    if (!cfg_.spillPath.empty()) {
+        // 变化序号随进程重启从头计数，上次运行留下的磁盘尾部不再有效
+        std::error_code ec;
+        std::filesystem::remove(segmentPath(0), ec);
+        std::filesystem::remove(segmentPath(1), ec);
+        running_ = true;
+        spillWakeAt_ = (mask_ + 1) / 2;
+        spillThread_ = std::thread(&ChangeLog::spillLoop, this);
+    }
+    GLOG_INFO("ChangeLog 容量 " + std::to_string(mask_ + 1) + " 条" +
+              (cfg_.spillPath.empty() ? std::string{} : "，落盘到 " + cfg_.spillPath));
+}
+
+void ChangeLog::stop() {
+    if (!running_.exchange(false)) return;
+    spillCv_.notify_all();
+    if (spillThread_.joinable()) spillThread_.join();
+    std::lock_guard<std::mutex> lock(diskMtx_);
+    segOut_.close();
+}
+
+void ChangeLog::append(const uint64_t seq, const TagHandle h, const uint8_t kind, const uint8_t quality,
+                       const uint64_t bits, const int64_t ts) {
+    if (!started_.load(std::memory_order_relaxed)) started_.store(true, std::memory_order_relaxed);
+    Record& r = ring_[seq & mask_];
+    uint64_t cur = r.stamp.load(std::memory_order_relaxed);
+    for (;;) {
+        // 槽位已被更新的序号占用：本条记录已滚出环，直接丢弃
+        if (cur != kWriting && cur > seq) return;
+        if (cur == kWriting) {
+            std::this_thread::yield();
+            cur = r.stamp.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (r.stamp.compare_exchange_weak(cur, kWriting, std::memory_order_acquire, std::memory_order_relaxed)) break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    r.bits.store(bits, std::memory_order_relaxed);
+    r.ts.store(ts, std::memory_order_relaxed);
+    r.handle.store(h, std::memory_order_relaxed);
+    r.kind.store(kind, std::memory_order_relaxed);
+    r.quality.store(quality, std::memory_order_relaxed);
+    r.stamp.store(seq, std::memory_order_release);
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    while (head < seq && !head_.compare_exchange_weak(head, seq, std::memory_order_release, std::memory_order_relaxed)) {}
+    if (seq >= spillWakeAt_.load(std::memory_order_relaxed)) {
+        spillWakeAt_.store(kWriting, std::memory_order_relaxed);
+        spillKick_.store(true, std::memory_order_release);
+        spillCv_.notify_one();
+    }
+}
+
+ChangeLog::Slot ChangeLog::readRecord(const uint64_t seq, RawRecord& rec) const {
+    const Record& r = ring_[seq & mask_];
+    const uint64_t s1 = r.stamp.load(std::memory_order_acquire);
+    if (s1 == kWriting || s1 < seq) return Slot::Pending;
+    if (s1 > seq) return Slot::Gone;
+    rec.seq = seq;
+    rec.bits = r.bits.load(std::memory_order_relaxed);
+    rec.ts = r.ts.load(std::memory_order_relaxed);
+    rec.handle = r.handle.load(std::memory_order_relaxed);
+    rec.kind = r.kind.load(std::memory_order_relaxed);
+    rec.quality = r.quality.load(std::memory_order_relaxed);
+    rec.pad[0] = rec.pad[1] = 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // 读取期间被更新的序号覆盖
+    return r.stamp.load(std::memory_order_relaxed) == s1 ? Slot::Ok : Slot::Gone;
+}
+
+void ChangeLog::toChange(const RawRecord& rec, std::vector<Change>& out) {
+    Change c;
+    c.handle = rec.handle;
+    auto& s = c.sample;
+    s.changeSeq = rec.seq;
+    s.quality = static_cast<VarQuality>(rec.quality);
+    s.timestamp = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(rec.ts));
+    s.hasValue = rec.kind != TagRegistry::kNoValue;
+    if (rec.kind == 0) s.value = TagRegistry::instance().load(rec.handle).value;
+    else if (s.hasValue) s.value = TagRegistry::decode(rec.kind, rec.bits);
+    out.push_back(std::move(c));
+}
+
+ChangeLog::ReadResult ChangeLog::read(const uint64_t since, const size_t limit, std::vector<Change>& out) const {
+    ReadResult res;
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t ringOldest = head > mask_ ? head - mask_ : 1;
+    res.head = head;
+    res.oldest = ringOldest;
+    {
+        std::lock_guard<std::mutex> lock(diskMtx_);
+        const uint64_t diskOldest = segFirst_[1] ? segFirst_[1] : segFirst_[0];
+        // 磁盘尾部与环衔接时才能跨越两者连续读取
+        if (diskOldest && diskOldest < ringOldest && spilled_ + 1 >= ringOldest) res.oldest = diskOldest;
+    }
+    res.next = since;
+    // since 超过当前序号说明网关已重启，序号重新计数
+    if (since + 1 < res.oldest || since > TagRegistry::instance().changeSeq()) {
+        res.status = ReadStatus::ResyncRequired;
+        return res;
+    }
+    uint64_t next = since;
+    size_t records = 0;
+    while (records < limit && next < head) {
+        const uint64_t seq = next + 1;
+        RawRecord rec;
+        const Slot slot = readRecord(seq, rec);
+        if (slot == Slot::Ok) {
+            toChange(rec, out);
+            next = seq;
+            ++records;
+            continue;
+        }
+        // 序号已分配但记录尚未写完：停在这里，保证返回的增量连续
+        if (slot == Slot::Pending) break;
+        const size_t n = readDisk(seq, limit - records, out);
+        if (n == 0) {
+            if (records == 0) res.status = ReadStatus::ResyncRequired;
+            break;
+        }
+        next += n;
+        records += n;
+    }
+    res.next = next;
+    return res;
+}
+
+size_t ChangeLog::readDisk(uint64_t from, const size_t limit, std::vector<Change>& out) const {
+    std::lock_guard<std::mutex> lock(diskMtx_);
+    size_t total = 0;
+    std::vector<RawRecord> buf;
+    // 先旧段后新段
+    for (const int idx : {1, 0}) {
+        const uint64_t first = segFirst_[idx];
+        const uint64_t count = segCount_[idx];
+        if (total >= limit || first == 0 || from < first || from >= first + count) continue;
+        std::ifstream in(segmentPath(idx), std::ios::binary);
+        if (!in) break;
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(limit - total, first + count - from));
+        buf.resize(n);
+        in.seekg(kSegHeaderBytes + static_cast<std::streamoff>((from - first) * sizeof(RawRecord)));
+        if (!in.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(n * sizeof(RawRecord)))) break;
+        for (const auto& rec : buf) toChange(rec, out);
+        from += n;
+        total += n;
+    }
+    return total;
+}
+
+ChangeLog::Stats ChangeLog::getStats() const {
+    Stats st;
+    st.head = head_.load(std::memory_order_acquire);
+    st.ringOldest = st.head > mask_ ? st.head - mask_ : 1;
+    st.spillGaps = spillGaps_;
+    std::lock_guard<std::mutex> lock(diskMtx_);
+    st.diskOldest = segFirst_[1] ? segFirst_[1] : segFirst_[0];
+    st.spilled = spilled_;
+    return st;
+}
+
+std::string ChangeLog::segmentPath(const int index) const {
+    return cfg_.spillPath + "." + std::to_string(index);
+}
+
+void ChangeLog::openSegment(const uint64_t firstSeq) {
+    segOut_.open(segmentPath(0), std::ios::binary | std::ios::trunc);
+    segOut_.write(kSegMagic, sizeof(kSegMagic));
+    segOut_.write(reinterpret_cast<const char*>(&kSegVersion), sizeof(kSegVersion));
+    segOut_.write(reinterpret_cast<const char*>(&firstSeq), sizeof(firstSeq));
+    segFirst_[0] = firstSeq;
+    segCount_[0] = 0;
+    if (!segOut_) GLOG_ERROR("ChangeLog 无法写入 " + segmentPath(0));
+}
+
+void ChangeLog::rotateSegments(const uint64_t firstSeq, const bool dropAll) {
+    segOut_.close();
+    std::error_code ec;
+    std::filesystem::remove(segmentPath(1), ec);
+    if (dropAll || segFirst_[0] == 0) {
+        std::filesystem::remove(segmentPath(0), ec);
+        segFirst_[1] = segCount_[1] = 0;
+    } else {
+        std::filesystem::rename(segmentPath(0), segmentPath(1), ec);
+        segFirst_[1] = ec ? 0 : segFirst_[0];
+        segCount_[1] = ec ? 0 : segCount_[0];
+    }
+    openSegment(firstSeq);
+}
+
+void ChangeLog::spillLoop() {
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(spillWaitMtx_);
+            spillCv_.wait_for(lock, kSpillInterval, [this] { return !running_ || spillKick_.load(); });
+        }
+        spillKick_ = false;
+        spillPending();
+    }
+}
+
+void ChangeLog::spillPending() {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t ringOldest = head > mask_ ? head - mask_ : 1;
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(diskMtx_);
+        if (spilled_ >= head) return;
+        seq = spilled_ + 1;
+        // 落盘跟不上写入速度，中间的记录已被覆盖：丢弃磁盘尾部，从环中最旧记录重新开始
+        if (seq < ringOldest) {
+            ++spillGaps_;
+            GLOG_WARN("ChangeLog 落盘落后，序号 " + std::to_string(seq) + " 至 " +
+                      std::to_string(ringOldest - 1) + " 已丢失，磁盘尾部重置");
+            rotateSegments(ringOldest, true);
+            spilled_ = ringOldest - 1;
+            seq = ringOldest;
+        }
+    }
+    std::vector<RawRecord> batch;
+    batch.reserve(static_cast<size_t>(std::min<uint64_t>(head - seq + 1, mask_ + 1)));
+    for (; seq <= head; ++seq) {
+        RawRecord rec;
+        if (readRecord(seq, rec) != Slot::Ok) break;    // 未写完或已被覆盖，下一轮再处理
+        batch.push_back(rec);
+    }
+    if (batch.empty()) return;
+
+    std::lock_guard<std::mutex> lock(diskMtx_);
+    if (!segOut_.is_open()) openSegment(batch.front().seq);
+    segOut_.write(reinterpret_cast<const char*>(batch.data()),
+                  static_cast<std::streamsize>(batch.size() * sizeof(RawRecord)));
+    segOut_.flush();
+    if (!segOut_) {
+        GLOG_ERROR("ChangeLog 写入 " + segmentPath(0) + " 失败");
+        rotateSegments(batch.back().seq + 1, true);
+    } else {
+        segCount_[0] += batch.size();
+    }
+    spilled_ = batch.back().seq;
+    spillWakeAt_.store(spilled_ + (mask_ + 1) / 2, std::memory_order_relaxed);
+    // 两段合计不超过上限：当前段写满一半即轮转
+    if (segCount_[0] * sizeof(RawRecord) >= cfg_.spillMaxBytes / 2) rotateSegments(spilled_ + 1, false);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TagRegistry.h"
+
+// 全局变化日志：TagRegistry 每分配一个变化序号就在定长环形缓冲区里记一条（句柄、值、品质、时间戳）。
+// 客户端断线重连后按 since 序号取精确增量，代价只与错过的变化数成正比；
+// since 早于环中最旧记录（且磁盘尾部也没有）时返回需要全量重同步。
+// 可选把滚出环的记录追加到磁盘文件，延长可追溯的窗口。
+// 字符串值不进日志，读取时取该标签的当前值。标签删除时先记一条清空记录；句柄之后被复用时，
+// 更早的记录按句柄当前的 id 输出
+class ChangeLog {
+public:
+    struct Config {
+        uint32_t capacity = 65536;          // 环形缓冲区条数，向上取 2 的幂
+        std::string spillPath;              // 为空表示不落盘
+        uint64_t spillMaxBytes = 64ull << 20;
+    };
+    struct Change {
+        TagHandle handle = kInvalidTag;
+        TagRegistry::Sample sample;          // sample.changeSeq 即本条记录的序号
+    };
+    enum class ReadStatus { Ok, ResyncRequired };
+    struct ReadResult {
+        ReadStatus status = ReadStatus::Ok;
+        uint64_t next = 0;                   // 下次请求的 since；本次未取完时小于 head
+        uint64_t head = 0;                   // 读取时已分配的最大序号
+        uint64_t oldest = 0;                 // 仍可取的最旧序号（含磁盘）
+    };
+    struct Stats {
+        uint64_t head = 0;
+        uint64_t ringOldest = 0;
+        uint64_t diskOldest = 0;            // 0 表示磁盘尾部为空
+        uint64_t spilled = 0;
+        uint64_t spillGaps = 0;              // 落盘线程跟不上、记录在写盘前被覆盖的次数
+    };
+
+    static ChangeLog& instance();
+    ~ChangeLog();
+    ChangeLog(const ChangeLog&) = delete;
+    ChangeLog& operator=(const ChangeLog&) = delete;
+
+    // 须在首条变化写入前调用（启动时加载设备之前），之后调用会被忽略
+    void configure(const Config& cfg);
+    void stop();
+
+    // 由 TagRegistry 在分配变化序号后调用；kind 为 Variable::ValueType 下标，kNoValue 表示清空
+    void append(uint64_t seq, TagHandle h, uint8_t kind, uint8_t quality, uint64_t bits, int64_t ts);
+
+    // 取 since 之后（不含）的变化，按序号升序最多 limit 条
+    ReadResult read(uint64_t since, size_t limit, std::vector<Change>& out) const;
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Record {
+        std::atomic<uint64_t> stamp{0};     // 记录的序号；写入过程中为 kWriting
+        std::atomic<uint64_t> bits{0};
+        std::atomic<int64_t> ts{0};
+        std::atomic<uint32_t> handle{kInvalidTag};
+        std::atomic<uint8_t> kind{0};
+        std::atomic<uint8_t> quality{0};
+    };
+    enum class Slot { Ok, Pending, Gone };
+    // 环中记录的快照，也是磁盘记录格式：定长 32 字节，按序号连续存放，可直接定位
+    struct RawRecord {
+        uint64_t seq;
+        uint64_t bits;
+        int64_t ts;
+        uint32_t handle;
+        uint8_t kind;
+        uint8_t quality;
+        uint8_t pad[2];
+    };
+    static_assert(sizeof(RawRecord) == 32, "RawRecord layout");
+
+    ChangeLog();
+    Slot readRecord(uint64_t seq, RawRecord& rec) const;
+    // 从磁盘段读取 from 起连续的记录，返回读到的条数（from 不在磁盘上时为 0）
+    size_t readDisk(uint64_t from, size_t limit, std::vector<Change>& out) const;
+    static void toChange(const RawRecord& rec, std::vector<Change>& out);
+    void spillLoop();
+    void spillPending();
+    void openSegment(uint64_t firstSeq);
+    void rotateSegments(uint64_t firstSeq, bool dropAll);
+    [[nodiscard]] std::string segmentPath(int index) const;
+
+    static constexpr uint64_t kWriting = ~uint64_t{0};
+
+    std::unique_ptr<Record[]> ring_;
+    uint64_t mask_ = 0;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<bool> started_{false};     // 已有记录写入，不允许再改容量
+
+    Config cfg_;
+    std::thread spillThread_;
+    std::atomic<bool> running_{false};
+    std::mutex spillWaitMtx_;
+    std::condition_variable spillCv_;
+    // 写入序号到达此值时唤醒落盘线程（环已写过半），避免只靠定时落盘而被覆盖
+    std::atomic<uint64_t> spillWakeAt_{kWriting};
+    std::atomic<bool> spillKick_{false};
+    // 磁盘段：[0] 为当前写入段，[1] 为上一段；段首记录序号为 0 表示不存在
+    mutable std::mutex diskMtx_;
+    std::ofstream segOut_;
+    uint64_t segFirst_[2] = {0, 0};
+    uint64_t segCount_[2] = {0, 0};
+    uint64_t spilled_ = 0;                  // 已落盘的最大序号
+    std::atomic<uint64_t> spillGaps_{0};
+};
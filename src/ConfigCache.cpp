@@ -0,0 +1,313 @@
+#include "ConfigCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'O', 'T', 'C', 'F', 'G', 'C', 0};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t wcharSize;
+    uint64_t contentHash;
+    uint64_t payloadSize;
+};
+
+// 只读内存映射，析构时解除映射
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER sz{};
+        if (!GetFileSizeEx(file_, &sz) || sz.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_) size_ = static_cast<size_t>(sz.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return;
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0 || st.st_size == 0) return;
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) return;
+        data_ = static_cast<const char*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+    }
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    [[nodiscard]] const char* data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class Writer {
+public:
+    template<class T>
+    void pod(const T& v) { buf_.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    void str(const std::string& s) {
+        pod(static_cast<uint32_t>(s.size()));
+        buf_.append(s);
+    }
+    void wstr(const std::wstring& s) {
+        pod(static_cast<uint32_t>(s.size()));
+        buf_.append(reinterpret_cast<const char*>(s.data()), s.size() * sizeof(wchar_t));
+    }
+    [[nodiscard]] const std::string& buffer() const { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+class Reader {
+public:
+    Reader(const char* p, const size_t n) : p_(p), end_(p + n) {}
+    template<class T>
+    T pod() {
+        need(sizeof(T));
+        T v;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+    std::string str() {
+        const auto n = pod<uint32_t>();
+        need(n);
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+    std::wstring wstr() {
+        const auto n = pod<uint32_t>();
+        need(static_cast<size_t>(n) * sizeof(wchar_t));
+        std::wstring s(n, L'\0');
+        std::memcpy(s.data(), p_, n * sizeof(wchar_t));
+        p_ += n * sizeof(wchar_t);
+        return s;
+    }
+    [[nodiscard]] bool atEnd() const { return p_ == end_; }
+
+private:
+    void need(const size_t n) const {
+        if (static_cast<size_t>(end_ - p_) < n) throw std::runtime_error("truncated config cache");
+    }
+    const char* p_;
+    const char* end_;
+};
+
+void writeConfig(Writer& w, const GlobalConfig& cfg) {
+    const auto& sys = cfg.system;
+    w.pod(sys.thread_pool_size);
+    w.str(sys.log_level);
+    w.str(sys.log_file);
+    w.pod(sys.config_watch_interval_ms);
+    w.pod(sys.connect_concurrency);
+    w.pod(sys.connect_timeout_ms);
+    w.pod(sys.write_coalesce_ms);
+    w.pod(sys.read_share_window_ms);
+    w.pod(sys.shed_lag_ms); w.pod(sys.shed_recover_lag_ms); w.pod(sys.shed_queue_per_thread);
+    w.pod(sys.shed_max_level); w.pod(sys.shed_check_interval_ms);
+    w.str(sys.timer_backend); w.pod(sys.timer_spin_us); w.pod(sys.timer_cpu);
+    w.str(sys.http_bind); w.pod(sys.http_port); w.pod(sys.http_workers);
+    w.pod(sys.ws_interval_ms); w.pod(sys.ws_max_clients);
+    w.pod(sys.changelog_capacity); w.str(sys.changelog_spill_path); w.pod(sys.changelog_spill_max_mb);
+    w.pod(sys.calc_interval_ms);
+    w.pod(sys.history_retention_s); w.pod(sys.history_max_mb);
+    w.str(sys.shm_name); w.pod(sys.shm_max_tags);
+
+    const auto& st = cfg.storage;
+    w.str(st.type); w.str(st.host); w.pod(st.port); w.str(st.user); w.str(st.password);
+    w.str(st.database); w.str(st.table); w.pod(st.write_on_change); w.pod(st.write_on_interval_ms);
+    w.pod(static_cast<uint32_t>(st.fields.size()));
+    for (const auto& f : st.fields) w.str(f);
+
+    w.pod(static_cast<uint32_t>(cfg.devices.size()));
+    for (const auto& d : cfg.devices) {
+        w.str(d.id); w.str(d.name); w.str(d.type); w.str(d.protocol); w.str(d.ip);
+        w.pod(d.port); w.pod(d.slave_id); w.str(d.endianness); w.pod(d.byte_swap);
+        w.pod(d.max_requests_per_sec); w.pod(d.request_burst);
+        w.str(d.host); w.str(d.servername);
+        w.str(d.endpoint); w.str(d.username); w.str(d.password);
+        w.pod(static_cast<uint32_t>(d.groups.size()));
+        for (const auto& g : d.groups) {
+            w.str(g.id); w.str(g.name); w.pod(g.interval_ms); w.pod(g.persist_on_change); w.str(g.mode);
+            w.str(g.priority); w.pod(g.taskPriority);
+            w.pod(g.adaptive); w.pod(g.min_interval_ms); w.pod(g.max_interval_ms);
+            w.pod(g.trigger_address); w.pod(g.trigger_max_stale_ms);
+            w.pod(static_cast<uint32_t>(g.aggregates.size()));
+            for (const auto& a : g.aggregates) w.pod(a);
+            w.pod(static_cast<uint32_t>(g.variables.size()));
+            for (const auto& v : g.variables) {
+                w.str(v.id); w.str(v.name); w.str(v.type); w.wstr(v.address);
+                w.pod(v.length); w.pod(v.persist_on_change); w.str(v.access);
+                w.pod(v.varType); w.pod(v.varAccess); w.pod(v.interval_ms); w.pod(v.scaling); w.pod(v.alarm);
+                w.pod(v.compression);
+                w.pod(static_cast<uint32_t>(v.aggregates.size()));
+                for (const auto& a : v.aggregates) w.pod(a);
+            }
+        }
+    }
+
+    w.pod(static_cast<uint32_t>(cfg.calculations.size()));
+    for (const auto& c : cfg.calculations) {
+        w.str(c.id); w.str(c.name); w.str(c.type); w.str(c.expr); w.pod(c.varType);
+    }
+}
+
+GlobalConfig readConfig(Reader& r) {
+    GlobalConfig cfg;
+    auto& sys = cfg.system;
+    sys.thread_pool_size = r.pod<int>();
+    sys.log_level = r.str();
+    sys.log_file = r.str();
+    sys.config_watch_interval_ms = r.pod<int>();
+    sys.connect_concurrency = r.pod<int>();
+    sys.connect_timeout_ms = r.pod<int>();
+    sys.write_coalesce_ms = r.pod<int>();
+    sys.read_share_window_ms = r.pod<int>();
+    sys.shed_lag_ms = r.pod<int>(); sys.shed_recover_lag_ms = r.pod<int>(); sys.shed_queue_per_thread = r.pod<int>();
+    sys.shed_max_level = r.pod<int>(); sys.shed_check_interval_ms = r.pod<int>();
+    sys.timer_backend = r.str(); sys.timer_spin_us = r.pod<int>(); sys.timer_cpu = r.pod<int>();
+    sys.http_bind = r.str(); sys.http_port = r.pod<int>(); sys.http_workers = r.pod<int>();
+    sys.ws_interval_ms = r.pod<int>(); sys.ws_max_clients = r.pod<int>();
+    sys.changelog_capacity = r.pod<int>(); sys.changelog_spill_path = r.str(); sys.changelog_spill_max_mb = r.pod<int>();
+    sys.calc_interval_ms = r.pod<int>();
+    sys.history_retention_s = r.pod<int>(); sys.history_max_mb = r.pod<int>();
+    sys.shm_name = r.str(); sys.shm_max_tags = r.pod<int>();
+
+    auto& st = cfg.storage;
+    st.type = r.str(); st.host = r.str(); st.port = r.pod<int>(); st.user = r.str(); st.password = r.str();
+    st.database = r.str(); st.table = r.str(); st.write_on_change = r.pod<bool>(); st.write_on_interval_ms = r.pod<int>();
+    st.fields.resize(r.pod<uint32_t>());
+    for (auto& f : st.fields) f = r.str();
+
+    cfg.devices.resize(r.pod<uint32_t>());
+    for (auto& d : cfg.devices) {
+        d.id = r.str(); d.name = r.str(); d.type = r.str(); d.protocol = r.str(); d.ip = r.str();
+        d.port = r.pod<int>(); d.slave_id = r.pod<int>(); d.endianness = r.str(); d.byte_swap = r.pod<bool>();
+        d.max_requests_per_sec = r.pod<int>(); d.request_burst = r.pod<int>();
+        d.host = r.str(); d.servername = r.str();
+        d.endpoint = r.str(); d.username = r.str(); d.password = r.str();
+        d.groups.resize(r.pod<uint32_t>());
+        for (auto& g : d.groups) {
+            g.id = r.str(); g.name = r.str(); g.interval_ms = r.pod<int>(); g.persist_on_change = r.pod<bool>(); g.mode = r.str();
+            g.priority = r.str(); g.taskPriority = r.pod<TaskPriority>();
+            g.adaptive = r.pod<bool>(); g.min_interval_ms = r.pod<int>(); g.max_interval_ms = r.pod<int>();
+            g.trigger_address = r.pod<int>(); g.trigger_max_stale_ms = r.pod<int>();
+            g.aggregates.resize(r.pod<uint32_t>());
+            for (auto& a : g.aggregates) a = r.pod<AggregateConfig>();
+            g.variables.resize(r.pod<uint32_t>());
+            for (auto& v : g.variables) {
+                v.id = r.str(); v.name = r.str(); v.type = r.str(); v.address = r.wstr();
+                v.length = r.pod<int>(); v.persist_on_change = r.pod<bool>(); v.access = r.str();
+                v.varType = r.pod<VarType>(); v.varAccess = r.pod<VarAccess>(); v.interval_ms = r.pod<int>();
+                v.scaling = r.pod<ScaleParams>(); v.alarm = r.pod<AlarmLimits>();
+                v.compression = r.pod<CompressionParams>();
+                v.aggregates.resize(r.pod<uint32_t>());
+                for (auto& a : v.aggregates) a = r.pod<AggregateConfig>();
+            }
+        }
+    }
+
+    cfg.calculations.resize(r.pod<uint32_t>());
+    for (auto& c : cfg.calculations) {
+        c.id = r.str(); c.name = r.str(); c.type = r.str(); c.expr = r.str(); c.varType = r.pod<VarType>();
+    }
+    return cfg;
+}
+
+} // namespace
+
+uint64_t ConfigCache::contentHash(const std::string_view content) {
+    // FNV-1a 64
+    uint64_t h = 1469598103934665603ULL;
+    for (const char c : content) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::optional<GlobalConfig> ConfigCache::load(const std::string& cachePath, const uint64_t hash) {
+    const MappedFile file(cachePath);
+    if (!file.data() || file.size() < sizeof(Header)) return std::nullopt;
+    Header hdr{};
+    std::memcpy(&hdr, file.data(), sizeof(Header));
+    if (std::memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0 || hdr.version != kVersion ||
+        hdr.wcharSize != sizeof(wchar_t) || hdr.contentHash != hash ||
+        hdr.payloadSize != file.size() - sizeof(Header)) {
+        return std::nullopt;
+    }
+    try {
+        Reader r(file.data() + sizeof(Header), hdr.payloadSize);
+        GlobalConfig cfg = readConfig(r);
+        if (!r.atEnd()) return std::nullopt;
+        return cfg;
+    } catch (const std::exception& ex) {
+        std::cerr << "[ConfigCache] Invalid cache " << cachePath << ": " << ex.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+void ConfigCache::save(const std::string& cachePath, const uint64_t hash, const GlobalConfig& cfg) {
+    Writer w;
+    writeConfig(w, cfg);
+    Header hdr{};
+    std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+    hdr.version = kVersion;
+    hdr.wcharSize = sizeof(wchar_t);
+    hdr.contentHash = hash;
+    hdr.payloadSize = w.buffer().size();
+
+    const std::string tmp = cachePath + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            std::cerr << "[ConfigCache] Cannot write " << tmp << std::endl;
+            return;
+        }
+        ofs.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        ofs.write(w.buffer().data(), static_cast<std::streamsize>(w.buffer().size()));
+        if (!ofs) {
+            std::cerr << "[ConfigCache] Cannot write " << tmp << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, cachePath, ec);
+    if (ec) std::cerr << "[ConfigCache] Cannot replace " << cachePath << ": " << ec.message() << std::endl;
+}
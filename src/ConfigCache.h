@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "JsonConfig.h"
+
+// 已解析配置的二进制快照。文件头记录源 JSON 的内容哈希，哈希一致时直接内存映射读取，跳过 JSON 解析
+class ConfigCache {
+public:
+    static uint64_t contentHash(std::string_view content);
+    // 快照不存在、格式版本不符或哈希不一致时返回 std::nullopt
+    static std::optional<GlobalConfig> load(const std::string& cachePath, uint64_t hash);
+    // 先写临时文件再改名，失败只记录日志不影响启动
+    static void save(const std::string& cachePath, uint64_t hash, const GlobalConfig& cfg);
+
+private:
+    // 配置结构体字段增减时需同步递增
+    static constexpr uint32_t kVersion = 20;
+};
@@ -0,0 +1,85 @@
+#include "ConfigWatcher.h"
+#include <chrono>
+#include <csignal>
+#include <utility>
+#include "DeviceManager.h"
+#include "JsonConfig.h"
+#include "Logger.h"
+
+namespace {
+volatile std::sig_atomic_t g_sighup = 0;
+#ifndef _WIN32
+void onSighup(int) { g_sighup = 1; }
+#endif
+}
+
+ConfigWatcher::ConfigWatcher(std::string path, std::string cachePath, std::shared_ptr<DeviceManager> mgr,
+                             const uint32_t intervalMs)
+    : path_(std::move(path)), cachePath_(std::move(cachePath)), mgr_(std::move(mgr)), intervalMs_(intervalMs) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+void ConfigWatcher::start() {
+    if (running_) return;
+    std::error_code ec;
+    lastWrite_ = std::filesystem::last_write_time(path_, ec);
+#ifndef _WIN32
+    std::signal(SIGHUP, onSighup);
+#endif
+    running_ = true;
+    thread_ = std::thread(&ConfigWatcher::run, this);
+    GLOG_INFO("配置热加载已启用: " + path_ + " 检测周期=" + std::to_string(intervalMs_) + "ms");
+}
+
+void ConfigWatcher::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+}
+
+void ConfigWatcher::requestReload() {
+    reloadRequested_ = true;
+}
+
+void ConfigWatcher::run() {
+    auto nextCheck = std::chrono::steady_clock::now();
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (g_sighup) {
+            g_sighup = 0;
+            reloadRequested_ = true;
+        }
+        if (const auto now = std::chrono::steady_clock::now(); now >= nextCheck) {
+            nextCheck = now + std::chrono::milliseconds(intervalMs_);
+            std::error_code ec;
+            if (const auto mtime = std::filesystem::last_write_time(path_, ec); !ec && mtime != lastWrite_) {
+                lastWrite_ = mtime;
+                reloadRequested_ = true;
+            }
+        }
+        if (reloadRequested_.exchange(false)) reload();
+    }
+}
+
+void ConfigWatcher::reload() {
+    const auto begin = std::chrono::steady_clock::now();
+    GlobalConfig cfg;
+    try {
+        cfg = JsonConfig::load(path_, cachePath_);
+    } catch (const std::exception& ex) {
+        // 解析失败时保持当前运行配置不变
+        GLOG_ERROR("热加载: 配置解析失败，保持当前配置: " + std::string(ex.what()));
+        return;
+    }
+    const auto stats = mgr_->applyConfig(cfg);
+    const auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    GLOG_INFO("热加载完成: 设备 +" + std::to_string(stats.devicesAdded) +
+              " -" + std::to_string(stats.devicesRemoved) +
+              " ~" + std::to_string(stats.devicesRebuilt) +
+              " 分组 +" + std::to_string(stats.groupsAdded) +
+              " -" + std::to_string(stats.groupsRemoved) +
+              " ~" + std::to_string(stats.groupsRebuilt) +
+              " 耗时=" + std::to_string(costMs) + "ms");
+}
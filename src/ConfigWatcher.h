@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+class DeviceManager;
+
+// 配置热加载：周期检测配置文件修改时间，或收到 SIGHUP（非 Windows）时重新解析，
+// 并交由 DeviceManager::applyConfig 做增量应用
+class ConfigWatcher {
+public:
+    ConfigWatcher(std::string path, std::string cachePath, std::shared_ptr<DeviceManager> mgr, uint32_t intervalMs);
+    ~ConfigWatcher();
+    void start();
+    void stop();
+    // 在下一次检测时立即重新加载
+    void requestReload();
+
+private:
+    void run();
+    void reload();
+
+    std::string path_;
+    std::string cachePath_;
+    std::shared_ptr<DeviceManager> mgr_;
+    uint32_t intervalMs_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> reloadRequested_{false};
+    std::filesystem::file_time_type lastWrite_{};
+    std::thread thread_;
+};
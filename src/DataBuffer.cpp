@@ -1,26 +1,53 @@
 #include "DataBuffer.h"
+#include "TagRegistry.h"
 
 DataBuffer& DataBuffer::instance() {
     static DataBuffer buf;
     return buf;
 }
 
+void DataBuffer::set(const TagHandle handle,
+                     const Variable::ValueType& value,
+                     const std::chrono::system_clock::time_point timestamp,
+                     const VarQuality quality) {
+    if (handle == kInvalidTag) return;
+    TagRegistry::instance().store(handle, value, quality, timestamp);
+}
+
+void DataBuffer::setQuality(const TagHandle handle,
+                            const VarQuality quality,
+                            const std::chrono::system_clock::time_point timestamp) {
+    if (handle == kInvalidTag) return;
+    TagRegistry::instance().storeQuality(handle, quality, timestamp);
+}
+
 void DataBuffer::set(const std::string& varid,
-                     const std::any& value,
+                     const Variable::ValueType& value,
                      const std::chrono::system_clock::time_point timestamp,
                      const VarQuality quality) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    buffer_[varid] = {value, timestamp, quality};
+    set(TagRegistry::instance().find(varid), value, timestamp, quality);
+}
+
+std::optional<Variable::ValueType> DataBuffer::get(const std::string& varid) const {
+    if (auto entry = getEntry(varid)) {
+        return std::move(entry->value);
+    }
+    return std::nullopt;
+}
+
+std::optional<DataBuffer::Entry> DataBuffer::getEntry(const std::string& varid) const {
+    return getEntry(TagRegistry::instance().find(varid));
 }
 
-std::any DataBuffer::get(const std::string& varid) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (const auto it = buffer_.find(varid); it != buffer_.end()) return it->second.value;
-    return {};
+std::optional<DataBuffer::Entry> DataBuffer::getEntry(const TagHandle handle) const {
+    const auto& reg = TagRegistry::instance();
+    if (handle == kInvalidTag || !reg.hasValue(handle)) return std::nullopt;
+    auto sample = reg.load(handle);
+    return Entry(std::move(sample.value), sample.timestamp, sample.quality);
 }
 
-DataBuffer::Entry DataBuffer::getEntry(const std::string& varid) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (const auto it = buffer_.find(varid); it != buffer_.end()) return it->second;
-    return {};
+void DataBuffer::remove(const std::string& varid) {
+    if (const TagHandle h = TagRegistry::instance().find(varid); h != kInvalidTag) {
+        TagRegistry::instance().clear(h);
+    }
 }
@@ -1,35 +1,43 @@
-#include "DataBuffer.h"
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include "Variable.h"
 
-DataBuffer& DataBuffer::instance() {
-    static DataBuffer buf;
-    return buf;
-}
+// 全局最新值缓存：varid -> (值, 时间戳, 品质)
+// 数据实际存放在 TagRegistry 的紧凑数组中，这里是按 varid / 句柄访问的统一入口
+class DataBuffer {
+public:
+    struct Entry {
+        Variable::ValueType value;
+        std::chrono::system_clock::time_point timestamp;
+        VarQuality quality = VarQuality::UNCERTAIN;
 
-void DataBuffer::set(const std::string& varid,
-                     const std::any& value,
-                     const std::chrono::system_clock::time_point timestamp,
-                     const VarQuality quality) {
-    std::unique_lock lock(mtx_);
-    buffer_[varid] = Entry(value, timestamp, quality);
-}
+        Entry() = default;
+        Entry(Variable::ValueType v, const std::chrono::system_clock::time_point ts, const VarQuality q)
+            : value(std::move(v)), timestamp(ts), quality(q) {}
+    };
 
-std::optional<std::any> DataBuffer::get(const std::string& varid) const {
-    std::shared_lock lock(mtx_);
-    if (const auto it = buffer_.find(varid); it != buffer_.end()) {
-        return it->second.value;
-    }
-    return std::nullopt;
-}
+    static DataBuffer& instance();
 
-std::optional<DataBuffer::Entry> DataBuffer::getEntry(const std::string& varid) const {
-    std::shared_lock lock(mtx_);
-    if (const auto it = buffer_.find(varid); it != buffer_.end()) {
-        return it->second;
-    }
-    return std::nullopt;
-}
+    // 采集热路径：按句柄写入，无查找开销
+    void set(TagHandle handle,
+             const Variable::ValueType& value,
+             std::chrono::system_clock::time_point timestamp,
+             VarQuality quality);
+    void setQuality(TagHandle handle,
+                    VarQuality quality,
+                    std::chrono::system_clock::time_point timestamp);
+    // 按 varid 写入；varid 未注册时忽略
+    void set(const std::string& varid,
+             const Variable::ValueType& value,
+             std::chrono::system_clock::time_point timestamp,
+             VarQuality quality);
+    [[nodiscard]] std::optional<Variable::ValueType> get(const std::string& varid) const;
+    [[nodiscard]] std::optional<Entry> getEntry(const std::string& varid) const;
+    [[nodiscard]] std::optional<Entry> getEntry(TagHandle handle) const;
+    void remove(const std::string& varid);
 
-void DataBuffer::remove(const std::string& varid) {
-    std::unique_lock lock(mtx_);
-    buffer_.erase(varid);
-}
+private:
+    DataBuffer() = default;
+};
@@ -1,4 +1,5 @@
 #include "Device.h"
+#include <thread>
 
 #include "DeviceManager.h"
 #include "Logger.h"
@@ -28,10 +29,54 @@ bool Device::tryEnterPoll() {
 void Device::exitPoll() {
     --runningPollCount_;
 }
+void Device::enterPriority(const TaskPriority priority) {
+    ++activeByPriority_[static_cast<size_t>(priority)];
+}
+
+void Device::exitPriority(const TaskPriority priority) {
+    --activeByPriority_[static_cast<size_t>(priority)];
+}
+
+bool Device::higherPriorityActive(const TaskPriority priority) const {
+    for (size_t p = 0; p < static_cast<size_t>(priority); ++p) {
+        if (activeByPriority_[p] > 0) return true;
+    }
+    return false;
+}
+
 void Device::resetErrorCount() {
     errorCount_ = 0;
 }
 
+void Device::markStartup(const std::chrono::steady_clock::time_point t0) {
+    startupTime_ = t0;
+}
+
+void Device::recordSample(const VarQuality quality) {
+    if (quality != VarQuality::GOOD || firstGoodMs_ >= 0) return;
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startupTime_).count();
+    if (int64_t expected = -1; firstGoodMs_.compare_exchange_strong(expected, ms)) {
+        GLOG_INFO("设备[" + id_ + "] 首个有效数据耗时 " + std::to_string(ms) + "ms");
+    }
+}
+
+void Device::writeVariable(const std::shared_ptr<Variable>& var, const Variable::ValueType&,
+                           const WriteCallback& cb) {
+    GLOG_WARN("设备[" + id_ + "] 不支持写入，变量[" + var->getId() + "]");
+    if (cb) cb(false, "设备类型不支持写入");
+}
+
+void Device::retire() {
+    auto self = shared_from_this();
+    std::thread([self]() {
+        while (self->runningPollCount_ > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        self->disconnect();
+    }).detach();
+}
+
 void Device::reportError(const std::string& errMsg) {
     if (const int ec = ++errorCount_; ec < errorRetryThreshold_) {
         std::lock_guard<std::mutex> lk(errMtx_);
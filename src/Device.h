@@ -1,15 +1,21 @@
 #pragma once
 #include <string>
+#include <array>
 #include <vector>
 #include <memory>
 #include <atomic>
 #include <mutex>
+#include <chrono>
+#include <functional>
 #include "Group.h"
 
 class DeviceManager;
 
 class Device : public std::enable_shared_from_this<Device> {
 public:
+    // 写入完成回调，在设备的写线程中调用
+    using WriteCallback = std::function<void(bool ok, const std::string& error)>;
+
     Device(const std::string& id, const std::string& name);
     virtual ~Device();
     virtual bool connect() { return true; }
@@ -17,6 +23,11 @@ public:
     virtual void beforeDisconnect() {}
     bool tryEnterPoll();
     void exitPoll();
+    // 按优先级登记进行中的采集；低优先级分组在逐项读取的间隙检查 higherPriorityActive，
+    // 为真时提前结束本周期、下周期续读，不占着工作线程等待，由线程池的加权调度决定何时继续
+    void enterPriority(TaskPriority priority);
+    void exitPriority(TaskPriority priority);
+    [[nodiscard]] bool higherPriorityActive(TaskPriority priority) const;
     void resetErrorCount();
     void reportError(const std::string& errMsg);
     void setErrorRetryThreshold(int n);
@@ -24,6 +35,16 @@ public:
     std::string getName() const;
     std::vector<std::shared_ptr<Group>>& getGroups();
     void setManager(const std::shared_ptr<DeviceManager>& mgr);
+    // 设备被移出管理器后调用：等待进行中的采集结束后在后台断开连接
+    void retire();
+    // 启动计时起点；首个 GOOD 样本到达时记录并输出耗时
+    void markStartup(std::chrono::steady_clock::time_point t0);
+    void recordSample(VarQuality quality);
+    [[nodiscard]] bool hasFirstGoodSample() const { return firstGoodMs_ >= 0; }
+    [[nodiscard]] int64_t getFirstGoodSampleMs() const { return firstGoodMs_; }
+    // 异步写变量；不支持写入的设备直接回调失败
+    virtual void writeVariable(const std::shared_ptr<Variable>& var, const Variable::ValueType& value,
+                               const WriteCallback& cb);
 
 protected:
     std::string id_;
@@ -31,6 +52,7 @@ protected:
     std::vector<std::shared_ptr<Group>> groups_;
 
     std::atomic<int> runningPollCount_{0};
+    std::array<std::atomic<int>, kTaskPriorityCount> activeByPriority_{};
     std::atomic<int> errorCount_{0};
     int errorRetryThreshold_{3};
 
@@ -39,4 +61,7 @@ protected:
     std::mutex errMtx_;
 
     std::weak_ptr<DeviceManager> mgr_;
+
+    std::chrono::steady_clock::time_point startupTime_{std::chrono::steady_clock::now()};
+    std::atomic<int64_t> firstGoodMs_{-1};
 };
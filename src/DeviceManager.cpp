@@ -5,9 +5,30 @@
 #include "OpcdaDevice.h"
 #include "OpcdaGroup.h"
 #include "OpcdaVariable.h"
+#include "OpcuaDevice.h"
+#include "OpcuaGroup.h"
+#include "OpcuaVariable.h"
+#include "DataBuffer.h"
+#include "TagRegistry.h"
 #include "Logger.h"
+#include <algorithm>
 #include <utility>
 #include <iostream>
+#include <string_view>
+
+namespace {
+bool globMatch(const std::string_view pattern, const std::string_view text) {
+    size_t p = 0, t = 0, star = std::string_view::npos, mark = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) { ++p; ++t; }
+        else if (p < pattern.size() && pattern[p] == '*') { star = p++; mark = t; }
+        else if (star != std::string_view::npos) { p = star + 1; t = ++mark; }
+        else return false;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+}
 
 // 工厂函数，负责托管shared_ptr并完成setManager
 std::shared_ptr<DeviceManager> DeviceManager::create(
@@ -27,84 +48,250 @@ DeviceManager::DeviceManager(std::shared_ptr<ThreadPool> pool,
     : pool_(std::move(pool)), scheduler_(std::move(scheduler))
 {}
 
+DeviceManager::~DeviceManager() {
+    for (auto& th : startupThreads_) {
+        if (!th.joinable()) continue;
+        // 最后一个引用可能在启动线程内释放，此时不能 join 自身
+        if (th.get_id() == std::this_thread::get_id()) th.detach();
+        else th.join();
+    }
+}
+
 // 真正初始化设备
 void DeviceManager::initDevices(const GlobalConfig& cfg)
 {
+    std::unique_lock lock(devicesMtx_);
+    connectTimeoutMs_ = cfg.system.connect_timeout_ms;
+    writeCoalesceMs_ = cfg.system.write_coalesce_ms;
+    readShareWindowMs_ = cfg.system.read_share_window_ms;
+    if (cfg.system.shed_lag_ms > 0) {
+        LoadGovernor::Config gc;
+        gc.lagMs = cfg.system.shed_lag_ms;
+        gc.recoverLagMs = std::min(cfg.system.shed_recover_lag_ms, cfg.system.shed_lag_ms);
+        gc.queuePerThread = std::max(1, cfg.system.shed_queue_per_thread);
+        gc.maxLevel = std::clamp(cfg.system.shed_max_level, 0, 8);
+        gc.checkIntervalMs = std::max(100, cfg.system.shed_check_interval_ms);
+        governor_ = std::make_shared<LoadGovernor>(pool_, scheduler_, gc);
+        governor_->start();
+    }
     for (const auto& devConf : cfg.devices) {
-        std::shared_ptr<Device> dev;
+        if (auto dev = buildDevice(devConf)) {
+            devices_[devConf.id] = dev;
+            deviceConfigs_[devConf.id] = devConf;
+        }
+    }
+    // *** 初始化完所有device后，再setManager ***
+    for (auto& [id, dev] : devices_) {
+        dev->setManager(shared_from_this());
+    }
+    lock.unlock();
+    rebuildWriteIndex();
+    // 计算标签在设备变量之后注册，以便加载时即可解析输入句柄
+    calc_ = std::make_shared<CalcEngine>(scheduler_, static_cast<uint32_t>(std::max(10, cfg.system.calc_interval_ms)));
+    calcConfigs_ = cfg.calculations;
+    calc_->load(calcConfigs_);
+    calc_->start();
+}
+
+std::shared_ptr<Device> DeviceManager::buildDevice(const DeviceConfig& devConf)
+{
+    std::shared_ptr<Device> dev;
+    if (devConf.type == "modbus") {
+        auto modbus = std::make_shared<ModbusDevice>(
+            devConf.id, devConf.name,
+            devConf.ip, devConf.port, devConf.slave_id,
+            devConf.endianness, devConf.byte_swap
+        );
+        modbus->setWriteCoalesceWindow(writeCoalesceMs_);
+        modbus->setReadShareWindow(readShareWindowMs_);
+        if (devConf.max_requests_per_sec > 0)
+            modbus->setRateLimit(devConf.max_requests_per_sec, devConf.request_burst);
+        dev = modbus;
+    } else if (devConf.type == "opcda") {
+        auto opcda = std::make_shared<OpcdaDevice>(
+            devConf.id, devConf.name, devConf.host, devConf.servername
+        );
+        opcda->setConnectTimeout(connectTimeoutMs_);
+        dev = opcda;
+    } else if (devConf.type == "opcua") {
+        dev = std::make_shared<OpcuaDevice>(
+            devConf.id, devConf.name, devConf.endpoint, devConf.username, devConf.password
+        );
+    } else {
+        GLOG_WARN("暂不支持的设备类型: " + devConf.type);
+        return nullptr;
+    }
+    // group/variable
+    for (const auto& grpConf : devConf.groups) {
+        dev->getGroups().push_back(buildGroup(devConf, grpConf));
+    }
+    return dev;
+}
+
+std::shared_ptr<Group> DeviceManager::buildGroup(const DeviceConfig& devConf, const GroupConfig& grpConf)
+{
+    std::shared_ptr<Group> grp;
+    // 自适应分组的定时任务按最小周期触发
+    const auto minMs = static_cast<uint32_t>(grpConf.adaptive && grpConf.min_interval_ms > 0
+                                                 ? grpConf.min_interval_ms : grpConf.interval_ms);
+    if (devConf.type == "modbus") {
+        grp = std::make_shared<ModbusGroup>(
+            this, devConf.id, grpConf.id, grpConf.name, minMs
+        );
+    } else if (devConf.type == "opcda") {
+        grp = std::make_shared<OpcdaGroup>(
+            this, devConf.id, grpConf.id, grpConf.name, minMs
+        );
+    } else if (devConf.type == "opcua") {
+        grp = std::make_shared<OpcuaGroup>(
+            this, devConf.id, grpConf.id, grpConf.name, minMs, grpConf.mode
+        );
+    }
+    for (const auto& varConf : grpConf.variables) {
+        if (devConf.type != "modbus" && !varConf.scaling.isIdentity())
+            GLOG_WARN("变量[" + varConf.id + "] 换算配置仅支持 modbus 设备，已忽略");
         if (devConf.type == "modbus") {
-            dev = std::make_shared<ModbusDevice>(
-                devConf.id, devConf.name,
-                devConf.ip, devConf.port, devConf.slave_id,
-                devConf.endianness, devConf.byte_swap
+            if (varConf.varType == VarType::BOOL && !varConf.scaling.isIdentity())
+                GLOG_WARN("变量[" + varConf.id + "] 为 bool 类型，换算配置已忽略");
+            auto var = std::make_shared<ModbusVariable>(
+                varConf.id, varConf.name, varConf.address, varConf.varType, varConf.varAccess,
+                devConf.endianness, devConf.byte_swap, varConf.scaling
             );
+            grp->addVariable(var, static_cast<uint32_t>(std::max(0, varConf.interval_ms)));
         } else if (devConf.type == "opcda") {
-            dev = std::make_shared<OpcdaDevice>(
-                devConf.id, devConf.name, devConf.host, devConf.servername
+            auto var = std::make_shared<OpcdaVariable>(
+                varConf.id, varConf.name, varConf.address, varConf.varType, varConf.varAccess
             );
-        } else {
-            GLOG_WARN("暂不支持的设备类型: " + devConf.type);
-            continue;
+            grp->addVariable(var, static_cast<uint32_t>(std::max(0, varConf.interval_ms)));
+        } else if (devConf.type == "opcua") {
+            auto var = std::make_shared<OpcuaVariable>(
+                varConf.id, varConf.name, varConf.address, varConf.varType, varConf.varAccess
+            );
+            grp->addVariable(var, static_cast<uint32_t>(std::max(0, varConf.interval_ms)));
         }
-        // group/variable
-        for (const auto& grpConf : devConf.groups) {
-            std::shared_ptr<Group> grp;
-            if (devConf.type == "modbus") {
-                grp = std::make_shared<ModbusGroup>(
-                    this, devConf.id, grpConf.id, grpConf.name, grpConf.interval_ms
-                );
-            } else if (devConf.type == "opcda") {
-                grp = std::make_shared<OpcdaGroup>(
-                    this, devConf.id, grpConf.id, grpConf.name, grpConf.interval_ms
-                );
-            }
-            for (const auto& varConf : grpConf.variables) {
-                if (devConf.type == "modbus") {
-                    VarType type = Variable::parseType(varConf.type);
-                    VarAccess access = Variable::parseAccess(varConf.access);
-                    auto var = std::make_shared<ModbusVariable>(
-                        varConf.id, varConf.name, varConf.address, type, access,
-                        devConf.endianness, devConf.byte_swap
-                    );
-                    grp->addVariable(var);
-                } else if (devConf.type == "opcda") {
-                    VarType type = Variable::parseType(varConf.type);
-                    VarAccess access = Variable::parseAccess(varConf.access);
-                    auto var = std::make_shared<OpcdaVariable>(
-                        varConf.id, varConf.name, varConf.address, type, access
-                    );
-                    grp->addVariable(var);
-                }
-            }
-            dev->getGroups().push_back(grp);
+        if (grp->getVariables().empty()) continue;
+        const TagHandle h = grp->getVariables().back()->getHandle();
+        // 未配置时同样调用，热加载去掉压缩配置后恢复逐值发布
+        TagRegistry::instance().setCompression(h, varConf.compression);
+        if (varConf.alarm.isEnabled()) grp->addAlarm(h, varConf.alarm);
+        for (const auto& agg : grpConf.aggregates) grp->addAggregate(h, agg);
+        for (const auto& agg : varConf.aggregates) {
+            if (std::find(grpConf.aggregates.begin(), grpConf.aggregates.end(), agg) == grpConf.aggregates.end())
+                grp->addAggregate(h, agg);
         }
-        devices_[devConf.id] = dev;
     }
-    // *** 初始化完所有device后，再setManager ***
-    for (auto& [id, dev] : devices_) {
-        dev->setManager(shared_from_this());
+    grp->setPriority(grpConf.taskPriority);
+    if (grpConf.trigger_address >= 0) {
+        if (const auto mbGrp = std::dynamic_pointer_cast<ModbusGroup>(grp)) {
+            mbGrp->setTrigger(grpConf.trigger_address, static_cast<uint32_t>(std::max(0, grpConf.trigger_max_stale_ms)));
+        } else {
+            GLOG_WARN("分组[" + grpConf.id + "] trigger_address 仅支持 modbus 设备，已忽略");
+        }
     }
+    if (grpConf.adaptive) {
+        const auto maxMs = static_cast<uint32_t>(grpConf.max_interval_ms > 0 ? grpConf.max_interval_ms : minMs * 16);
+        grp->setAdaptive(minMs, maxMs);
+    }
+    return grp;
 }
 
 std::shared_ptr<Device> DeviceManager::getDevice(const std::string& id) {
+    std::shared_lock lock(devicesMtx_);
     const auto it = devices_.find(id);
     return it != devices_.end() ? it->second : nullptr;
 }
 
+void DeviceManager::registerGroupTask(const std::string& devId, const std::shared_ptr<Group>& grp,
+                                      const bool immediate) {
+    // 同一分组已有任务（启动连接完成与热加载先后为同一分组登记）时先注销，避免旧任务失去句柄后继续运行
+    unregisterGroupTask(devId, grp->getId());
+    auto pollFunc = [grp]() { grp->pollVariables(); };
+    const auto handle = scheduler_->scheduleEvery(grp->getIntervalMs(), pollFunc,
+                                                  immediate ? 0 : grp->getIntervalMs(), grp->getPriority());
+    groupTaskHandles_[devId][grp->getId()] = handle;
+    if (governor_) governor_->track(handle, devId + "/" + grp->getId(), grp->getIntervalMs(), grp->getPriority());
+}
+
+void DeviceManager::unregisterGroupTask(const std::string& devId, const std::string& grpId) {
+    const auto it = groupTaskHandles_.find(devId);
+    if (it == groupTaskHandles_.end()) return;
+    if (const auto hit = it->second.find(grpId); hit != it->second.end()) {
+        if (governor_) governor_->untrack(hit->second);
+        scheduler_->cancel(hit->second);
+        it->second.erase(hit);
+    }
+}
+
 void DeviceManager::registerAllGroupTasks() {
-    for (const auto& [devId, dev] : devices_) {
-        for (const auto& grp : dev->getGroups()) {
-            auto pollFunc = [grp]() { grp->pollVariables(); };
-            const auto handle = scheduler_->scheduleEvery(grp->getIntervalMs(), pollFunc);
-            groupTaskHandles_[devId][grp->getId()] = handle;
+    std::vector<std::pair<std::string, std::vector<std::shared_ptr<Group>>>> snapshot;
+    {
+        std::shared_lock devLock(devicesMtx_);
+        for (const auto& [devId, dev] : devices_) snapshot.emplace_back(devId, dev->getGroups());
+    }
+    std::lock_guard<std::recursive_mutex> lock(tasksMtx_);
+    for (const auto& [devId, groups] : snapshot) {
+        for (const auto& grp : groups) {
+            registerGroupTask(devId, grp);
             GLOG_INFO("注册分组定时任务: 设备=" + devId + " 分组=" + grp->getId());
         }
     }
 }
 
+void DeviceManager::startAll(const size_t concurrency) {
+    auto queue = std::make_shared<std::vector<std::shared_ptr<Device>>>();
+    {
+        std::shared_lock lock(devicesMtx_);
+        for (const auto& [id, dev] : devices_) queue->push_back(dev);
+    }
+    if (queue->empty()) return;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto& dev : *queue) dev->markStartup(t0);
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    auto remaining = std::make_shared<std::atomic<size_t>>(queue->size());
+    const size_t workers = std::min(std::max<size_t>(1, concurrency), queue->size());
+    GLOG_INFO("并行连接设备: 数量=" + std::to_string(queue->size()) + " 并发=" + std::to_string(workers));
+
+    std::weak_ptr<DeviceManager> weakSelf = shared_from_this();
+    for (size_t w = 0; w < workers; ++w) {
+        startupThreads_.emplace_back([weakSelf, queue, next, remaining, t0]() {
+            for (size_t i = (*next)++; i < queue->size(); i = (*next)++) {
+                const auto& dev = (*queue)[i];
+                const auto begin = std::chrono::steady_clock::now();
+                const bool ok = dev->connect();
+                const auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+                const auto self = weakSelf.lock();
+                if (!self) return;
+                if (ok) {
+                    GLOG_INFO("设备[" + dev->getId() + "] 连接就绪 耗时=" + std::to_string(costMs) + "ms");
+                } else {
+                    // 连接失败也注册采集任务，由采集路径的重连/退避逻辑接管
+                    GLOG_WARN("设备[" + dev->getId() + "] 启动连接失败 耗时=" + std::to_string(costMs) + "ms，交由采集重连");
+                }
+                {
+                    // 与 applyConfig 串行：同一顺序先取热加载锁再取任务锁
+                    std::lock_guard<std::mutex> reloadLock(self->reloadMtx_);
+                    std::lock_guard<std::recursive_mutex> lock(self->tasksMtx_);
+                    // 热加载期间设备可能已被替换或移除
+                    if (self->getDevice(dev->getId()) == dev) {
+                        for (const auto& grp : dev->getGroups()) self->registerGroupTask(dev->getId(), grp, ok);
+                    }
+                }
+                if (--*remaining == 0) {
+                    GLOG_INFO("全部设备启动连接完成 总耗时=" + std::to_string(
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - t0).count()) + "ms");
+                }
+            }
+        });
+    }
+}
+
 void DeviceManager::unregisterGroupTasksByDevice(const std::string& devId) {
+    std::lock_guard<std::recursive_mutex> lock(tasksMtx_);
     if (const auto it = groupTaskHandles_.find(devId); it != groupTaskHandles_.end()) {
         for (const auto& [grpId, handle] : it->second) {
+            if (governor_) governor_->untrack(handle);
             scheduler_->cancel(handle);
             GLOG_INFO("注销分组定时任务: 设备=" + devId + " 分组=" + grpId);
         }
@@ -113,14 +300,259 @@ void DeviceManager::unregisterGroupTasksByDevice(const std::string& devId) {
 }
 
 void DeviceManager::reRegisterDeviceTasks(const std::string& devId) {
+    // 分组列表可能被热加载整体替换，须在 devicesMtx_ 下取快照
+    std::vector<std::shared_ptr<Group>> groups;
+    {
+        std::shared_lock devLock(devicesMtx_);
+        if (const auto it = devices_.find(devId); it != devices_.end()) groups = it->second->getGroups();
+    }
+    std::lock_guard<std::recursive_mutex> lock(tasksMtx_);
     unregisterGroupTasksByDevice(devId);
-    if (const auto it = devices_.find(devId); it != devices_.end()) {
-        const auto& dev = it->second;
+    for (const auto& grp : groups) {
+        registerGroupTask(devId, grp);
+        GLOG_INFO("重新注册分组定时任务: 设备=" + devId + " 分组=" + grp->getId());
+    }
+}
+
+void DeviceManager::removeBufferedValues(const GroupConfig& grpConf) {
+    for (const auto& varConf : grpConf.variables) {
+        DataBuffer::instance().remove(varConf.id);
+    }
+}
+
+DeviceManager::ReloadStats DeviceManager::applyConfig(const GlobalConfig& cfg) {
+    std::lock_guard<std::mutex> reloadLock(reloadMtx_);
+    ReloadStats stats;
+    std::unordered_map<std::string, const DeviceConfig*> incoming;
+    for (const auto& devConf : cfg.devices) incoming[devConf.id] = &devConf;
+
+    std::vector<std::shared_ptr<Device>> retired;
+    std::vector<std::shared_ptr<Group>> retiredGroups;
+    std::lock_guard<std::recursive_mutex> taskLock(tasksMtx_);
+
+    // 1. 删除已不存在的设备
+    for (auto it = deviceConfigs_.begin(); it != deviceConfigs_.end();) {
+        if (incoming.count(it->first)) { ++it; continue; }
+        const std::string devId = it->first;
+        unregisterGroupTasksByDevice(devId);
+        for (const auto& grpConf : it->second.groups) removeBufferedValues(grpConf);
+        {
+            std::unique_lock lock(devicesMtx_);
+            if (const auto dit = devices_.find(devId); dit != devices_.end()) {
+                retired.push_back(dit->second);
+                devices_.erase(dit);
+            }
+        }
+        it = deviceConfigs_.erase(it);
+        ++stats.devicesRemoved;
+        GLOG_INFO("热加载: 移除设备 " + devId);
+    }
+
+    // 2. 新增或变化的设备
+    for (const auto& devConf : cfg.devices) {
+        const auto oldIt = deviceConfigs_.find(devConf.id);
+        const bool isNew = oldIt == deviceConfigs_.end();
+        if (!isNew && oldIt->second.sameConnection(devConf)) {
+            // 连接参数未变，只在分组粒度上做差异
+            const auto dev = getDevice(devConf.id);
+            if (!dev) continue;
+            // 在副本上做差异，最后在 devicesMtx_ 写锁内换入：HTTP/WebSocket 在读锁下遍历设备的分组列表
+            std::vector<std::shared_ptr<Group>> groups;
+            {
+                std::shared_lock lock(devicesMtx_);
+                groups = dev->getGroups();
+            }
+            std::vector<std::shared_ptr<Group>> added;
+            std::unordered_map<std::string, const GroupConfig*> oldGroups;
+            for (const auto& g : oldIt->second.groups) oldGroups[g.id] = &g;
+            std::unordered_map<std::string, const GroupConfig*> newGroups;
+            for (const auto& g : devConf.groups) newGroups[g.id] = &g;
+
+            for (const auto& [grpId, oldGrp] : oldGroups) {
+                if (newGroups.count(grpId)) continue;
+                unregisterGroupTask(devConf.id, grpId);
+                groups.erase(std::remove_if(groups.begin(), groups.end(),
+                    [&retiredGroups, &grpId = grpId](const auto& g) {
+                        if (g->getId() != grpId) return false;
+                        retiredGroups.push_back(g);
+                        return true;
+                    }), groups.end());
+                removeBufferedValues(*oldGrp);
+                ++stats.groupsRemoved;
+                GLOG_INFO("热加载: 移除分组 设备=" + devConf.id + " 分组=" + grpId);
+            }
+            for (const auto& grpConf : devConf.groups) {
+                const auto og = oldGroups.find(grpConf.id);
+                if (og != oldGroups.end() && *og->second == grpConf) continue;
+                auto grp = buildGroup(devConf, grpConf);
+                if (og != oldGroups.end()) {
+                    // 分组内容变化：替换分组对象，仅清理被删掉的变量缓存
+                    unregisterGroupTask(devConf.id, grpConf.id);
+                    for (auto& g : groups) {
+                        if (g->getId() != grpConf.id) continue;
+                        retiredGroups.push_back(g);
+                        g = grp;
+                    }
+                    for (const auto& oldVar : og->second->variables) {
+                        if (std::none_of(grpConf.variables.begin(), grpConf.variables.end(),
+                                         [&oldVar](const auto& v) { return v.id == oldVar.id; }))
+                            DataBuffer::instance().remove(oldVar.id);
+                    }
+                    ++stats.groupsRebuilt;
+                    GLOG_INFO("热加载: 重建分组 设备=" + devConf.id + " 分组=" + grpConf.id);
+                } else {
+                    groups.push_back(grp);
+                    ++stats.groupsAdded;
+                    GLOG_INFO("热加载: 新增分组 设备=" + devConf.id + " 分组=" + grpConf.id);
+                }
+                added.push_back(std::move(grp));
+            }
+            {
+                std::unique_lock lock(devicesMtx_);
+                dev->getGroups().swap(groups);
+            }
+            for (const auto& grp : added) registerGroupTask(devConf.id, grp);
+            oldIt->second = devConf;
+            continue;
+        }
+
+        // 新设备或连接参数变化：整体重建
+        auto dev = buildDevice(devConf);
+        if (!dev) continue;
+        dev->setManager(shared_from_this());
+        if (!isNew) {
+            unregisterGroupTasksByDevice(devConf.id);
+            for (const auto& grpConf : oldIt->second.groups) removeBufferedValues(grpConf);
+        }
+        {
+            std::unique_lock lock(devicesMtx_);
+            if (const auto dit = devices_.find(devConf.id); dit != devices_.end()) retired.push_back(dit->second);
+            devices_[devConf.id] = dev;
+        }
+        deviceConfigs_[devConf.id] = devConf;
+        for (const auto& grp : dev->getGroups()) registerGroupTask(devConf.id, grp);
+        if (isNew) ++stats.devicesAdded; else ++stats.devicesRebuilt;
+        GLOG_INFO(std::string("热加载: ") + (isNew ? "新增" : "重建") + "设备 " + devConf.id);
+    }
+
+    // 先释放旧分组的订阅等资源（OPC UA 订阅回调指向分组对象），再断开旧设备
+    for (const auto& grp : retiredGroups) grp->retire();
+    for (const auto& dev : retired) {
+        for (const auto& grp : dev->getGroups()) grp->retire();
+        dev->retire();
+    }
+    rebuildWriteIndex();
+    if (calc_ && cfg.calculations != calcConfigs_) {
+        calcConfigs_ = cfg.calculations;
+        calc_->load(calcConfigs_);
+        GLOG_INFO("热加载: 计算标签已更新");
+    }
+    return stats;
+}
+
+std::vector<std::pair<std::string, Group::AdaptiveStats>> DeviceManager::getAdaptiveStats() const {
+    std::vector<std::pair<std::string, Group::AdaptiveStats>> out;
+    std::shared_lock lock(devicesMtx_);
+    for (const auto& [devId, dev] : devices_) {
         for (const auto& grp : dev->getGroups()) {
-            auto pollFunc = [grp]() { grp->pollVariables(); };
-            const auto handle = scheduler_->scheduleEvery(grp->getIntervalMs(), pollFunc);
-            groupTaskHandles_[devId][grp->getId()] = handle;
-            GLOG_INFO("重新注册分组定时任务: 设备=" + devId + " 分组=" + grp->getId());
+            if (auto st = grp->getAdaptiveStats(); st.enabled) out.emplace_back(devId + "/" + grp->getId(), st);
         }
     }
+    return out;
+}
+
+std::vector<std::pair<std::string, RateLimiter::Stats>> DeviceManager::getRateLimitStats() const {
+    std::vector<std::pair<std::string, RateLimiter::Stats>> out;
+    std::shared_lock lock(devicesMtx_);
+    for (const auto& [devId, dev] : devices_) {
+        if (const auto modbus = std::dynamic_pointer_cast<ModbusDevice>(dev); modbus && modbus->hasRateLimit())
+            out.emplace_back(devId, modbus->getRateLimitStats());
+    }
+    return out;
+}
+
+CalcEngine::Stats DeviceManager::getCalcStats() const {
+    return calc_ ? calc_->getStats() : CalcEngine::Stats{};
+}
+
+LoadGovernor::Stats DeviceManager::getLoadShedStats() const {
+    return governor_ ? governor_->getStats() : LoadGovernor::Stats{};
+}
+
+std::vector<std::pair<std::string, JitterStats>> DeviceManager::getJitterStats() const {
+    std::vector<std::pair<std::string, JitterStats>> out;
+    std::lock_guard<std::recursive_mutex> lock(tasksMtx_);
+    for (const auto& [devId, groups] : groupTaskHandles_) {
+        for (const auto& [grpId, handle] : groups) out.emplace_back(devId + "/" + grpId, scheduler_->getJitter(handle));
+    }
+    return out;
+}
+
+void DeviceManager::collectTagHandlesMatching(const std::string& devPattern, const std::string& grpPattern,
+                                              std::vector<TagHandle>& out) const {
+    std::shared_lock lock(devicesMtx_);
+    for (const auto& [devId, dev] : devices_) {
+        if (!globMatch(devPattern, devId)) continue;
+        for (const auto& grp : dev->getGroups()) {
+            if (!globMatch(grpPattern, grp->getId())) continue;
+            grp->collectTagHandles(out);
+        }
+    }
+}
+
+bool DeviceManager::collectTagHandles(const std::string& devId, const std::string& grpId,
+                                      std::vector<TagHandle>& out) const {
+    out.clear();
+    const auto appendDevice = [&](const std::shared_ptr<Device>& dev) {
+        bool found = grpId.empty();
+        for (const auto& grp : dev->getGroups()) {
+            if (!grpId.empty() && grp->getId() != grpId) continue;
+            found = true;
+            grp->collectTagHandles(out);
+        }
+        return found;
+    };
+    std::shared_lock lock(devicesMtx_);
+    if (devId.empty()) {
+        for (const auto& [id, dev] : devices_) appendDevice(dev);
+        if (calc_) calc_->collectTagHandles(out);
+        return true;
+    }
+    const auto it = devices_.find(devId);
+    return it != devices_.end() && appendDevice(it->second);
+}
+
+void DeviceManager::rebuildWriteIndex() {
+    std::unordered_map<TagHandle, WriteTarget> index;
+    {
+        std::shared_lock lock(devicesMtx_);
+        for (const auto& [id, dev] : devices_) {
+            for (const auto& grp : dev->getGroups()) {
+                for (const auto& var : grp->getVariables()) {
+                    if (var->getAccess() != VarAccess::RO) index[var->getHandle()] = {dev, var};
+                }
+            }
+        }
+    }
+    std::unique_lock lock(writeIndexMtx_);
+    writeIndex_.swap(index);
+}
+
+void DeviceManager::writeTag(const std::string& varId, const Variable::ValueType& value,
+                             const Device::WriteCallback& cb) {
+    std::shared_ptr<Device> dev;
+    std::shared_ptr<Variable> var;
+    if (const TagHandle h = TagRegistry::instance().find(varId); h != kInvalidTag) {
+        std::shared_lock lock(writeIndexMtx_);
+        if (const auto it = writeIndex_.find(h); it != writeIndex_.end()) {
+            dev = it->second.device.lock();
+            var = it->second.variable.lock();
+        }
+    }
+    if (!dev || !var) {
+        GLOG_WARN("写入失败: 变量[" + varId + "] 不存在或只读");
+        if (cb) cb(false, "变量不存在或只读");
+        return;
+    }
+    dev->writeVariable(var, value, cb);
 }
@@ -1,32 +1,97 @@
 #pragma once
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include "Device.h"
 #include "ThreadPool.h"
 #include "TimerScheduler.h"
 #include "JsonConfig.h"
+#include "RateLimiter.h"
+#include "LoadGovernor.h"
+#include "CalcEngine.h"
 
 class Group;
 
 class DeviceManager : public std::enable_shared_from_this<DeviceManager> {
 public:
+    // 热加载差异统计
+    struct ReloadStats {
+        int devicesAdded = 0;
+        int devicesRemoved = 0;
+        int devicesRebuilt = 0;
+        int groupsAdded = 0;
+        int groupsRemoved = 0;
+        int groupsRebuilt = 0;
+    };
+
     static std::shared_ptr<DeviceManager> create(
         std::shared_ptr<ThreadPool> pool,
         std::shared_ptr<TimerScheduler> scheduler,
         const GlobalConfig& cfg);
+    ~DeviceManager();
 
     void registerAllGroupTasks();
+    // 以不超过 concurrency 的并发度在后台连接所有设备，每台设备就绪后立即开始采集，不阻塞调用方
+    void startAll(size_t concurrency);
     void unregisterGroupTasksByDevice(const std::string& devId);
     void reRegisterDeviceTasks(const std::string& devId);
     std::shared_ptr<Device> getDevice(const std::string& id);
+    // 与运行中的配置做差异比较，仅增删/重建发生变化的设备与分组，未变化设备的连接与缓存值保持不动
+    ReloadStats applyConfig(const GlobalConfig& cfg);
+    // 按变量 id 异步写入，结果通过 cb 回调；只读或不存在的变量立即回调失败
+    void writeTag(const std::string& varId, const Variable::ValueType& value, const Device::WriteCallback& cb);
+    // 自适应分组的周期决策与节省的读请求，键为 "设备/分组"
+    [[nodiscard]] std::vector<std::pair<std::string, Group::AdaptiveStats>> getAdaptiveStats() const;
+    // 启用限流的设备的令牌桶统计（共用连接的设备统计相同），键为设备 id
+    [[nodiscard]] std::vector<std::pair<std::string, RateLimiter::Stats>> getRateLimitStats() const;
+    // 过载降载状态；未启用时各级别为 0
+    [[nodiscard]] LoadGovernor::Stats getLoadShedStats() const;
+    // 计算标签的公式数与求值耗时
+    [[nodiscard]] CalcEngine::Stats getCalcStats() const;
+    // 各分组采集任务的调度抖动分位数，键为 "设备/分组"
+    [[nodiscard]] std::vector<std::pair<std::string, JitterStats>> getJitterStats() const;
+    // 收集标签句柄：devId 为空时取全部设备（含计算标签），grpId 为空时取设备下全部分组；设备或分组不存在返回 false
+    bool collectTagHandles(const std::string& devId, const std::string& grpId, std::vector<TagHandle>& out) const;
+    // 按通配符（* 与 ?）匹配设备 id 与分组 id，结果追加到 out
+    void collectTagHandlesMatching(const std::string& devPattern, const std::string& grpPattern,
+                                   std::vector<TagHandle>& out) const;
 
 private:
     DeviceManager(std::shared_ptr<ThreadPool> pool,
                   std::shared_ptr<TimerScheduler> scheduler);
     void initDevices(const GlobalConfig& cfg);
+    std::shared_ptr<Device> buildDevice(const DeviceConfig& devConf);
+    std::shared_ptr<Group> buildGroup(const DeviceConfig& devConf, const GroupConfig& grpConf);
+    // 以下两个函数调用方需持有 tasksMtx_
+    void registerGroupTask(const std::string& devId, const std::shared_ptr<Group>& grp, bool immediate = false);
+    void unregisterGroupTask(const std::string& devId, const std::string& grpId);
+    static void removeBufferedValues(const GroupConfig& grpConf);
+    // 重建可写变量索引（RW/WO），初始化与热加载后调用
+    void rebuildWriteIndex();
+
+    struct WriteTarget {
+        std::weak_ptr<Device> device;
+        std::weak_ptr<Variable> variable;
+    };
+
     std::unordered_map<std::string, std::shared_ptr<Device>> devices_;
+    std::unordered_map<std::string, DeviceConfig> deviceConfigs_;
+    mutable std::shared_mutex devicesMtx_;
     std::shared_ptr<ThreadPool> pool_;
     std::shared_ptr<TimerScheduler> scheduler_;
     std::unordered_map<std::string, std::unordered_map<std::string, TimerScheduler::TimerHandle>> groupTaskHandles_;
+    mutable std::recursive_mutex tasksMtx_;
+    std::mutex reloadMtx_;
+    int connectTimeoutMs_ = 10000;
+    int writeCoalesceMs_ = 5;
+    int readShareWindowMs_ = 200;
+    std::unordered_map<TagHandle, WriteTarget> writeIndex_;
+    mutable std::shared_mutex writeIndexMtx_;
+    std::vector<std::thread> startupThreads_;
+    std::shared_ptr<LoadGovernor> governor_;
+    std::shared_ptr<CalcEngine> calc_;
+    std::vector<CalcTagConfig> calcConfigs_;
 };
@@ -0,0 +1,59 @@
+#include "FastClock.h"
+
+namespace {
+constexpr int64_t kRecalibrateNs = 1'000'000'000;
+constexpr int kCalibrationSamples = 5;
+
+int64_t steadyNs(const std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+}
+
+std::atomic<int64_t> FastClock::offsetNs_{0};
+std::atomic<int64_t> FastClock::calibratedAtNs_{INT64_MIN};
+std::atomic<bool> FastClock::calibrating_{false};
+
+void FastClock::calibrate() {
+    // 取夹在两次单调时钟读取之间最窄的一次系统时钟读数，偏移误差不超过该区间的一半
+    int64_t bestSpan = INT64_MAX;
+    int64_t bestOffset = 0;
+    int64_t at = 0;
+    for (int i = 0; i < kCalibrationSamples; ++i) {
+        const int64_t s1 = steadyNs(std::chrono::steady_clock::now());
+        const int64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        const int64_t s2 = steadyNs(std::chrono::steady_clock::now());
+        if (s2 - s1 < bestSpan) {
+            bestSpan = s2 - s1;
+            bestOffset = wall - (s1 + (s2 - s1) / 2);
+            at = s2;
+        }
+    }
+    offsetNs_.store(bestOffset, std::memory_order_relaxed);
+    calibratedAtNs_.store(at, std::memory_order_release);
+}
+
+void FastClock::maybeCalibrate(const int64_t nowNs) {
+    const int64_t last = calibratedAtNs_.load(std::memory_order_acquire);
+    if (last == INT64_MIN) {
+        // 尚无有效偏移：各线程自行校准后再读取，不能沿用初值 0
+        calibrate();
+        return;
+    }
+    if (nowNs - last < kRecalibrateNs) return;
+    // 只让一个线程重新校准，其余线程沿用旧偏移；校准时间在偏移写入后才发布
+    if (calibrating_.exchange(true, std::memory_order_acquire)) return;
+    calibrate();
+    calibrating_.store(false, std::memory_order_release);
+}
+
+std::chrono::system_clock::time_point FastClock::toWall(const std::chrono::steady_clock::time_point t) {
+    const int64_t ns = steadyNs(t);
+    maybeCalibrate(ns);
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::nanoseconds(ns + offsetNs_.load(std::memory_order_relaxed))));
+}
+
+std::chrono::system_clock::time_point FastClock::now() {
+    return toWall(std::chrono::steady_clock::now());
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// 墙上时间的快速来源：读取单调时钟后加上校准偏移，偏移每秒按需重新校准一次，
+// 既避免逐变量调用 system_clock，也能跟随 NTP 对系统时间的调整
+class FastClock {
+public:
+    static std::chrono::system_clock::time_point now();
+    static std::chrono::system_clock::time_point toWall(std::chrono::steady_clock::time_point t);
+    static void calibrate();
+
+private:
+    static void maybeCalibrate(int64_t steadyNs);
+
+    static std::atomic<int64_t> offsetNs_;        // 墙上时间 - 单调时间
+    static std::atomic<int64_t> calibratedAtNs_;  // 上次校准时的单调时间
+    static std::atomic<bool> calibrating_;        // 周期性重新校准的占位，避免多个线程同时校准
+};
+
+// 一次请求/响应的采集时间：同一响应内的所有变量共用同一时间戳
+struct AcquisitionStamp {
+    std::chrono::system_clock::time_point requestSent;
+    std::chrono::system_clock::time_point responseReceived;
+
+    // 设备实际采样发生在请求与响应之间，取中点作为采集时间
+    [[nodiscard]] std::chrono::system_clock::time_point acquired() const {
+        return requestSent + (responseReceived - requestSent) / 2;
+    }
+};
@@ -1,23 +1,105 @@
 #include "Group.h"
+#include <algorithm>
 #include <utility>
 #include "DeviceManager.h"
 #include "Logger.h"
+#include "TagRegistry.h"
 
 Group::Group(DeviceManager* mgr, std::string  deviceId, std::string  id,
              std::string  name, const uint32_t intervalMs)
     : mgr_(mgr), deviceId_(std::move(deviceId)), id_(std::move(id)), name_(std::move(name)), intervalMs_(intervalMs), active_(true) {}
 
-void Group::addVariable(const std::shared_ptr<Variable>& var) {
+void Group::addVariable(const std::shared_ptr<Variable>& var, const uint32_t intervalMs) {
+    uint32_t divisor = 1;
+    if (intervalMs > intervalMs_ && intervalMs_ > 0) {
+        divisor = (intervalMs + intervalMs_ / 2) / intervalMs_;
+        if (divisor * intervalMs_ != intervalMs) {
+            GLOG_WARN("Group[" + getId() + "] 变量[" + var->getId() + "] 周期 " + std::to_string(intervalMs) +
+                      "ms 不是分组周期的整数倍，按 " + std::to_string(divisor * intervalMs_) + "ms 采集");
+        }
+    }
     variables_.push_back(var);
+    rateDivisors_.push_back(divisor);
+    if (divisor > 1) multiRate_ = true;
 }
 
 std::vector<std::shared_ptr<Variable>>& Group::getVariables() { return variables_; }
 const std::vector<std::shared_ptr<Variable>>& Group::getVariables() const { return variables_; }
+void Group::collectTagHandles(std::vector<TagHandle>& out) const {
+    for (const auto& var : variables_) out.push_back(var->getHandle());
+    aggregates_.collectTagHandles(out);
+}
+
 uint32_t Group::getIntervalMs() const { return intervalMs_; }
 std::string Group::getId() const { return id_; }
 std::string Group::getDeviceId() const { return deviceId_; }
 
+void Group::setAdaptive(const uint32_t minMs, const uint32_t maxMs) {
+    std::lock_guard<std::mutex> lock(adaptiveMtx_);
+    adaptive_.enabled = true;
+    adaptive_.minIntervalMs = minMs;
+    adaptive_.maxIntervalMs = std::max(minMs, maxMs);
+    adaptive_.effectiveIntervalMs = minMs;
+}
+
+Group::AdaptiveStats Group::getAdaptiveStats() const {
+    std::lock_guard<std::mutex> lock(adaptiveMtx_);
+    return adaptive_;
+}
+
+bool Group::adaptiveSkip(const std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(adaptiveMtx_);
+    if (!adaptive_.enabled) return false;
+    // 留半个基础周期的余量，避免定时抖动导致多跳过一拍
+    if (now + std::chrono::milliseconds(adaptive_.minIntervalMs / 2) < nextDue_) {
+        ++adaptive_.skipped;
+        adaptive_.readsSaved += variables_.size();
+        return true;
+    }
+    return false;
+}
+
+uint64_t Group::valuesFingerprint() const {
+    const auto& reg = TagRegistry::instance();
+    uint64_t fp = 0;
+    for (const auto& v : variables_) fp = (fp ^ reg.fingerprint(v->getHandle())) * 1099511628211ULL;
+    return fp;
+}
+
+void Group::adaptiveUpdate(const uint64_t before, const std::chrono::steady_clock::time_point now) {
+    const bool changed = valuesFingerprint() != before;
+    std::lock_guard<std::mutex> lock(adaptiveMtx_);
+    ++adaptive_.polls;
+    const uint32_t prev = adaptive_.effectiveIntervalMs;
+    if (changed) {
+        adaptive_.effectiveIntervalMs = adaptive_.minIntervalMs;
+        if (prev != adaptive_.effectiveIntervalMs) ++adaptive_.snaps;
+    } else {
+        adaptive_.effectiveIntervalMs = std::min(adaptive_.maxIntervalMs, prev * 2);
+        if (prev != adaptive_.effectiveIntervalMs) ++adaptive_.stretches;
+    }
+    if (prev != adaptive_.effectiveIntervalMs) {
+        GLOG_DEBUG("Group[" + getId() + "] 自适应周期 " + std::to_string(prev) + "ms -> " +
+                   std::to_string(adaptive_.effectiveIntervalMs) + "ms" + (changed ? "（值变化）" : ""));
+    }
+    nextDue_ = now + std::chrono::milliseconds(adaptive_.effectiveIntervalMs);
+}
+
 void Group::pollVariables() {
+    // 定时器按周期投递，不等待上一轮结束；上一轮仍在进行时跳过本轮并计为超期
+    if (polling_.exchange(true, std::memory_order_acquire)) {
+        const uint64_t n = overruns_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if ((n & (n - 1)) == 0) {
+            GLOG_WARN("Group[" + getId() + "] 上一轮采集未结束，跳过本轮（累计 " + std::to_string(n) + " 次）");
+        }
+        return;
+    }
+    struct Release {
+        std::atomic<bool>& flag;
+        ~Release() { flag.store(false, std::memory_order_release); }
+    } release{polling_};
+    const auto now = std::chrono::steady_clock::now();
+    if (adaptiveSkip(now)) return;
     const auto dev = mgr_->getDevice(getDeviceId());
     if (!dev) {
         GLOG_ERROR("Group[" + getId() + "] 无法获取Device实例");
@@ -26,8 +108,23 @@ void Group::pollVariables() {
     if (!dev->tryEnterPoll()) {
         return;
     }
+    dev->enterPriority(priority_);
+    const bool adaptive = getAdaptiveStats().enabled;
+    const uint64_t before = adaptive ? valuesFingerprint() : 0;
     try {
         pollVariablesImpl(dev);
+        ++cycle_;
+        if (!alarms_.empty()) alarms_.evaluate();
+        if (!aggregates_.empty()) aggregates_.update();
+        if (adaptive) adaptiveUpdate(before, now);
+        if (!dev->hasFirstGoodSample()) {
+            for (const auto& v : variables_) {
+                if (v->getQuality() == VarQuality::GOOD) {
+                    dev->recordSample(VarQuality::GOOD);
+                    break;
+                }
+            }
+        }
     } catch (const std::exception &ex) {
         GLOG_ERROR("Group[" + getId() + "] pollVariablesImpl异常: " + std::string(ex.what()));
         dev->reportError("OpcdaGroup[" + getId() + "] pollVariablesImpl异常: " + ex.what());
@@ -35,5 +132,6 @@ void Group::pollVariables() {
         GLOG_ERROR("Group[" + getId() + "] pollVariablesImpl未知异常");
         dev->reportError("Group[" + getId() + "] pollVariablesImpl未知异常");
     }
+    dev->exitPriority(priority_);
     dev->exitPoll();
 }
\ No newline at end of file
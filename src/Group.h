@@ -3,6 +3,11 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include "AggregateSet.h"
+#include "AlarmEngine.h"
+#include "ThreadPool.h"
 #include "Variable.h"
 
 class Device;
@@ -11,19 +16,52 @@ class DeviceManager;
 
 class Group {
 public:
+    // 自适应轮询统计；readsSaved 按跳过次数 × 变量数估算
+    struct AdaptiveStats {
+        bool enabled = false;
+        uint32_t minIntervalMs = 0;
+        uint32_t maxIntervalMs = 0;
+        uint32_t effectiveIntervalMs = 0;
+        uint64_t polls = 0;
+        uint64_t skipped = 0;
+        uint64_t stretches = 0;
+        uint64_t snaps = 0;
+        uint64_t readsSaved = 0;
+    };
+
     Group(DeviceManager* mgr, std::string  deviceId, std::string  id,
           std::string  name, uint32_t intervalMs);
     virtual ~Group() = default;
 
     virtual void pollVariablesImpl(const std::shared_ptr<Device>& device) = 0;
     virtual void pollVariables();
-    void addVariable(const std::shared_ptr<Variable>& var);
+    // 热加载移除或替换分组时调用（采集任务已注销），释放订阅等协议侧资源；
+    // 正在运行的采集任务可能仍持有分组对象，实现需与之互斥
+    virtual void retire() {}
+    // intervalMs 为变量自身采样周期，按分组周期取整为分频系数；0 表示每个周期都采
+    void addVariable(const std::shared_ptr<Variable>& var, uint32_t intervalMs = 0);
+    // 第 i 个变量的分频系数：第 c 个采集周期中 c % divisor == 0 时该变量到期
+    [[nodiscard]] uint32_t getRateDivisor(size_t index) const { return rateDivisors_[index]; }
+    [[nodiscard]] bool isMultiRate() const { return multiRate_; }
     std::vector<std::shared_ptr<Variable>>& getVariables();
     [[nodiscard]] const std::vector<std::shared_ptr<Variable>>& getVariables() const;
     uint32_t getIntervalMs() const;
     std::string getId() const;
     std::string getDeviceId() const;
     DeviceManager* getDeviceManager() const { return mgr_; }
+    void setPriority(const TaskPriority priority) { priority_ = priority; }
+    [[nodiscard]] TaskPriority getPriority() const { return priority_; }
+    // 开启自适应轮询：定时任务按 minMs 触发，未到有效周期的触发直接跳过
+    void setAdaptive(uint32_t minMs, uint32_t maxMs);
+    [[nodiscard]] AdaptiveStats getAdaptiveStats() const;
+    // 上一轮采集尚未结束时到期而被跳过的次数（设备响应慢或超时）
+    [[nodiscard]] uint64_t getOverruns() const { return overruns_.load(std::memory_order_relaxed); }
+    // 为已加入分组的变量配置限值报警，每轮采集后整组判定
+    void addAlarm(TagHandle h, const AlarmLimits& limits) { alarms_.add(h, limits); }
+    // 为已加入分组的变量追加聚合窗口，派生标签随分组一起列出
+    void addAggregate(TagHandle h, const AggregateConfig& cfg) { aggregates_.add(h, cfg); }
+    // 分组内全部标签：变量在前，聚合派生标签在后
+    void collectTagHandles(std::vector<TagHandle>& out) const;
     friend Device;
 protected:
     DeviceManager* mgr_;
@@ -32,5 +70,23 @@ protected:
     std::string name_;
     const uint32_t intervalMs_;
     std::vector<std::shared_ptr<Variable>> variables_;
+    std::vector<uint32_t> rateDivisors_;
+    bool multiRate_ = false;
+    uint64_t cycle_ = 0;              // 已完成的采集周期数，pollVariablesImpl 内即当前周期序号
     std::atomic<bool> active_;
+    TaskPriority priority_ = TaskPriority::NORMAL;
+    // 同一分组同一时刻只有一轮采集：读计划、换算、触发、自适应等分组状态均不加锁，由它保证独占
+    std::atomic<bool> polling_{false};
+    std::atomic<uint64_t> overruns_{0};
+
+private:
+    bool adaptiveSkip(std::chrono::steady_clock::time_point now);
+    void adaptiveUpdate(uint64_t before, std::chrono::steady_clock::time_point now);
+    [[nodiscard]] uint64_t valuesFingerprint() const;
+
+    AlarmSet alarms_;
+    AggregateSet aggregates_;
+    mutable std::mutex adaptiveMtx_;
+    AdaptiveStats adaptive_;
+    std::chrono::steady_clock::time_point nextDue_{};
 };
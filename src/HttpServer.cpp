@@ -0,0 +1,755 @@
+#include "HttpServer.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include "ChangeLog.h"
+#include "DeviceManager.h"
+#include "Logger.h"
+#include "TagJsonWriter.h"
+#include "SocketUtil.h"
+
+namespace {
+using net::kNoSocket;
+using net::NativeSocket;
+using net::native;
+using net::closeSocket;
+using net::sendAll;
+constexpr size_t kMaxHeaderBytes = 16 * 1024;
+constexpr int kRecvTimeoutMs = 1000;
+constexpr int kIdleTimeouts = 30;             // 收到半个请求头后最多再等约 30 秒
+constexpr auto kIdleKeepAlive = std::chrono::seconds(30);   // 两次请求之间的空闲连接保持时长
+constexpr int kIdleGraceMs = 50;              // 响应后在工作线程上等待下一个请求的时间，之后停靠
+constexpr auto kLongPollStep = std::chrono::milliseconds(20);
+constexpr uint32_t kDefaultLogLimit = 10000;
+constexpr uint32_t kMaxLogLimit = 100000;
+constexpr uint32_t kDefaultHistoryPoints = 10000;
+constexpr uint32_t kMaxHistoryPoints = 100000;
+constexpr int64_t kDefaultHistorySpanMs = 3600 * 1000;
+
+const char* statusText(const int status) {
+    switch (status) {
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 410: return "Gone";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default:  return "Internal Server Error";
+    }
+}
+
+bool iequals(const std::string_view a, const std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// 按 '/' 切分路径，忽略空段
+std::vector<std::string_view> splitPath(std::string_view path) {
+    std::vector<std::string_view> parts;
+    while (!path.empty()) {
+        const auto slash = path.find('/');
+        if (slash != 0) parts.push_back(path.substr(0, slash));
+        if (slash == std::string_view::npos) break;
+        path.remove_prefix(slash + 1);
+    }
+    return parts;
+}
+
+// 先取已提交水位再扫描范围内各标签的变化序号；范围内无变化时把 since 推进到水位，之后从水位继续等待
+uint64_t scanChanges(const std::vector<TagHandle>& handles, uint64_t& since, std::vector<TagHandle>& changed) {
+    auto& reg = TagRegistry::instance();
+    const uint64_t seq = reg.changeSeq();
+    if (seq > since) {
+        for (const TagHandle h : handles) {
+            if (reg.changedAt(h) > since) changed.push_back(h);
+        }
+        if (changed.empty()) since = seq;
+    }
+    return seq;
+}
+
+bool readable(const uintptr_t fd, const int timeoutMs) {
+    pollfd p{native(fd), POLLIN, 0};
+    return net::pollSockets(&p, 1, timeoutMs) > 0;
+}
+
+template<class T>
+bool parseNumber(const std::string* s, T& out) {
+    if (!s) return false;
+    const auto res = std::from_chars(s->data(), s->data() + s->size(), out);
+    return res.ec == std::errc() && res.ptr == s->data() + s->size();
+}
+}
+
+HttpServer::HttpServer(std::shared_ptr<DeviceManager> manager, Config cfg)
+    : manager_(std::move(manager)), cfg_(std::move(cfg)), listenFd_(kNoSocket) {}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+bool HttpServer::start() {
+    if (running_) return true;
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        GLOG_ERROR("HttpServer WSAStartup 失败");
+        return false;
+    }
+#endif
+    const NativeSocket fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    listenFd_ = static_cast<uintptr_t>(fd);
+    if (listenFd_ == kNoSocket) {
+        GLOG_ERROR("HttpServer 创建监听套接字失败");
+        return false;
+    }
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(cfg_.port));
+    if (inet_pton(AF_INET, cfg_.bind.c_str(), &addr.sin_addr) != 1 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 64) != 0) {
+        GLOG_ERROR("HttpServer 监听 " + cfg_.bind + ":" + std::to_string(cfg_.port) + " 失败");
+        closeSocket(listenFd_);
+        listenFd_ = kNoSocket;
+        return false;
+    }
+    running_ = true;
+    hub_ = std::make_unique<WebSocketHub>(manager_, cfg_.ws);
+    hub_->start();
+    for (int i = 0; i < std::max(1, cfg_.workers); ++i) workers_.emplace_back(&HttpServer::workerLoop, this);
+    parkThread_ = std::thread(&HttpServer::parkLoop, this);
+    acceptThread_ = std::thread(&HttpServer::acceptLoop, this);
+    GLOG_INFO("HttpServer 已启动: " + cfg_.bind + ":" + std::to_string(cfg_.port));
+    return true;
+}
+
+void HttpServer::stop() {
+    if (!running_.exchange(false)) return;
+    // 关闭监听套接字使 accept 返回
+#ifdef _WIN32
+    closesocket(native(listenFd_));
+#else
+    ::shutdown(native(listenFd_), SHUT_RDWR);
+    ::close(native(listenFd_));
+#endif
+    listenFd_ = kNoSocket;
+    queueCv_.notify_all();
+    if (acceptThread_.joinable()) acceptThread_.join();
+    for (auto& th : workers_) th.join();
+    workers_.clear();
+    // 停靠线程退出时关闭自己持有的连接，之后再清理它交回队列与尚未接收的连接
+    if (parkThread_.joinable()) parkThread_.join();
+    for (const auto& c : pending_) closeSocket(c.fd);
+    pending_.clear();
+    for (const auto& w : newWaiters_) closeSocket(w.conn.fd);
+    newWaiters_.clear();
+    for (const auto& i : newIdle_) closeSocket(i.conn.fd);
+    newIdle_.clear();
+    parked_ = 0;
+    hub_.reset();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void HttpServer::acceptLoop() {
+    std::string busy;
+    while (running_) {
+        const NativeSocket client = ::accept(native(listenFd_), nullptr, nullptr);
+        const auto fd = static_cast<uintptr_t>(client);
+        if (fd == kNoSocket) {
+            if (!running_) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        const int on = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+        std::unique_lock<std::mutex> lock(queueMtx_);
+        // 所有工作线程都忙且已有等待连接时直接拒绝，避免排队无界增长
+        if (pending_.size() >= static_cast<size_t>(std::max(1, cfg_.workers))) {
+            lock.unlock();
+            busy = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            sendAll(fd, busy);
+            closeSocket(fd);
+            continue;
+        }
+        pending_.push_back(Conn{fd, {}});
+        lock.unlock();
+        queueCv_.notify_one();
+    }
+}
+
+void HttpServer::workerLoop() {
+    Scratch scratch;
+    while (true) {
+        Conn conn;
+        {
+            std::unique_lock<std::mutex> lock(queueMtx_);
+            queueCv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+            if (!running_) return;
+            conn = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        const uintptr_t fd = conn.fd;
+        if (!serve(conn, scratch)) closeSocket(fd);
+    }
+}
+
+bool HttpServer::serve(Conn& conn, Scratch& scratch) {
+    const uintptr_t fd = conn.fd;
+    auto& in = conn.in;
+    net::setRecvTimeout(fd, kRecvTimeoutMs);
+    char buf[4096];
+    int idle = 0;
+    while (running_) {
+        const auto end = in.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (in.size() > kMaxHeaderBytes) {
+                scratch.head = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+                sendAll(fd, scratch.head);
+                return false;
+            }
+            // 两次请求之间的空闲连接不占工作线程
+            if (in.empty() && !readable(fd, kIdleGraceMs)) return parkIdle(conn);
+            const int n = net::recvSome(fd, buf, sizeof(buf));
+            if (n == -1 && ++idle < kIdleTimeouts) continue;
+            if (n <= 0) return false;
+            idle = 0;
+            in.append(buf, n);
+            continue;
+        }
+        Request req;
+        const bool ok = parseRequest(std::string_view(in).substr(0, end), req);
+        in.erase(0, end + 4);
+        scratch.body.clear();
+        int status;
+        if (!ok) {
+            writeError(scratch.body, "malformed request");
+            status = 400;
+            req.keepAlive = false;
+        } else if (req.upgrade && req.path == "/ws") {
+            return upgrade(fd, req, in, scratch);
+        } else {
+            status = route(req, scratch);
+        }
+        if (status == kParked) {
+            Waiter w{std::move(conn), req.keepAlive, scratch.parkSince, std::move(scratch.handles),
+                     scratch.parkDeadline};
+            ++parked_;
+            std::lock_guard<std::mutex> lock(parkMtx_);
+            newWaiters_.push_back(std::move(w));
+            return true;
+        }
+        if (!sendResponse(fd, status, req.keepAlive, scratch) || !req.keepAlive) return false;
+    }
+    return false;
+}
+
+bool HttpServer::parkIdle(Conn& conn) {
+    if (parked_.load(std::memory_order_relaxed) >= cfg_.maxParked) return false;
+    ++parked_;
+    std::lock_guard<std::mutex> lock(parkMtx_);
+    newIdle_.push_back(Idle{std::move(conn), std::chrono::steady_clock::now() + kIdleKeepAlive});
+    return true;
+}
+
+bool HttpServer::sendResponse(const uintptr_t fd, const int status, const bool keepAlive, Scratch& scratch) {
+    auto& head = scratch.head;
+    head.clear();
+    head.append("HTTP/1.1 ").append(std::to_string(status)).append(" ").append(statusText(status));
+    head.append("\r\nContent-Type: application/json\r\nContent-Length: ").append(std::to_string(scratch.body.size()));
+    head.append(keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+    return sendAll(fd, head) && sendAll(fd, scratch.body);
+}
+
+void HttpServer::afterParked(Conn&& conn, const bool keepAlive, std::vector<Idle>& idle, std::vector<Conn>& ready) {
+    if (!keepAlive) {
+        closeSocket(conn.fd);
+        --parked_;
+    } else if (conn.in.find("\r\n\r\n") != std::string::npos) {
+        ready.push_back(std::move(conn));
+        --parked_;
+    } else {
+        idle.push_back(Idle{std::move(conn), std::chrono::steady_clock::now() + kIdleKeepAlive});
+    }
+}
+
+void HttpServer::parkLoop() {
+    Scratch scratch;
+    std::vector<Waiter> waiters;
+    std::vector<Idle> idle;
+    std::vector<Conn> ready;
+    std::vector<pollfd> fds;
+    while (running_) {
+        {
+            std::lock_guard<std::mutex> lock(parkMtx_);
+            for (auto& w : newWaiters_) waiters.push_back(std::move(w));
+            for (auto& i : newIdle_) idle.push_back(std::move(i));
+            newWaiters_.clear();
+            newIdle_.clear();
+        }
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < waiters.size();) {
+            auto& w = waiters[k];
+            scratch.handles.clear();
+            const uint64_t seq = scanChanges(w.handles, w.since, scratch.handles);
+            if (scratch.handles.empty() && now < w.deadline) {
+                ++k;
+                continue;
+            }
+            scratch.body.clear();
+            writeTags(scratch.handles, seq, scratch.body, {}, true);
+            if (sendResponse(w.conn.fd, 200, w.keepAlive, scratch)) {
+                afterParked(std::move(w.conn), w.keepAlive, idle, ready);
+            } else {
+                closeSocket(w.conn.fd);
+                --parked_;
+            }
+            if (k + 1 != waiters.size()) w = std::move(waiters.back());
+            waiters.pop_back();
+        }
+
+        fds.clear();
+        for (const auto& i : idle) fds.push_back(pollfd{native(i.conn.fd), POLLIN, 0});
+        if (fds.empty()) std::this_thread::sleep_for(kLongPollStep);
+        else net::pollSockets(fds.data(), fds.size(), static_cast<int>(kLongPollStep.count()));
+        // 可读（含对端关闭）的空闲连接交回工作线程，超时的关闭；fds 与 idle 下标一一对应
+        const auto after = std::chrono::steady_clock::now();
+        for (size_t k = fds.size(); k-- > 0;) {
+            if (fds[k].revents == 0 && after < idle[k].deadline) continue;
+            if (fds[k].revents != 0) ready.push_back(std::move(idle[k].conn));
+            else closeSocket(idle[k].conn.fd);
+            --parked_;
+            if (k + 1 != idle.size()) idle[k] = std::move(idle.back());
+            idle.pop_back();
+        }
+        if (!ready.empty()) {
+            // 已被接受过的连接不受 503 排队上限限制
+            std::lock_guard<std::mutex> lock(queueMtx_);
+            for (auto& c : ready) pending_.push_back(std::move(c));
+            ready.clear();
+            queueCv_.notify_all();
+        }
+    }
+    for (const auto& w : waiters) closeSocket(w.conn.fd);
+    for (const auto& i : idle) closeSocket(i.conn.fd);
+}
+
+bool HttpServer::upgrade(const uintptr_t fd, const Request& req, std::string& pending, Scratch& scratch) {
+    auto& head = scratch.head;
+    if (req.method != "GET" || req.wsKey.empty()) {
+        head = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(fd, head);
+        return false;
+    }
+    if (hub_->getStats().clients >= static_cast<size_t>(std::max(1, cfg_.ws.maxClients))) {
+        head = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(fd, head);
+        return false;
+    }
+    head = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+    head.append(WebSocketHub::acceptKey(req.wsKey)).append("\r\n\r\n");
+    if (!sendAll(fd, head)) return false;
+    // 客户端已满（与上面的检查存在竞争）时 adopt 失败，由调用方关闭连接
+    return hub_->adopt(fd, std::move(pending));
+}
+
+int HttpServer::route(const Request& req, Scratch& scratch) {
+    auto& body = scratch.body;
+    if (req.method != "GET") {
+        writeError(body, "only GET is supported");
+        return 405;
+    }
+    const auto parts = splitPath(req.path);
+    if (parts.size() < 2 || parts[0] != "api") {
+        writeError(body, "not found");
+        return 404;
+    }
+    auto& reg = TagRegistry::instance();
+    const uint64_t seq = reg.changeSeq();
+
+    if (parts[1] == "tags" && parts.size() == 3) {
+        const TagHandle h = reg.find(urlDecode(parts[2]));
+        if (h == kInvalidTag) {
+            writeError(body, "tag not found");
+            return 404;
+        }
+        TagJsonWriter(body).tag(h);
+        return 200;
+    }
+    if (parts[1] == "tags" && parts.size() == 2) {
+        if (const auto* ids = param(req.params, "ids")) {
+            auto& handles = scratch.handles;
+            handles.clear();
+            std::vector<std::string_view> missing;
+            std::string_view rest(*ids);
+            while (!rest.empty()) {
+                const auto comma = rest.find(',');
+                const auto id = rest.substr(0, comma);
+                if (!id.empty()) {
+                    if (const TagHandle h = reg.find(id); h != kInvalidTag) handles.push_back(h);
+                    else missing.push_back(id);
+                }
+                if (comma == std::string_view::npos) break;
+                rest.remove_prefix(comma + 1);
+            }
+            writeTags(handles, seq, body, missing);
+            return 200;
+        }
+        manager_->collectTagHandles({}, {}, scratch.handles);
+        writeTags(scratch.handles, seq, body);
+        return 200;
+    }
+    if (parts[1] == "devices" && parts.size() >= 4 && parts.back() == "tags") {
+        const std::string dev = urlDecode(parts[2]);
+        std::string grp;
+        if (parts.size() == 6 && parts[3] == "groups") grp = urlDecode(parts[4]);
+        else if (parts.size() != 4) {
+            writeError(body, "not found");
+            return 404;
+        }
+        if (!manager_->collectTagHandles(dev, grp, scratch.handles)) {
+            writeError(body, grp.empty() ? "device not found" : "group not found");
+            return 404;
+        }
+        writeTags(scratch.handles, seq, body);
+        return 200;
+    }
+    if (parts[1] == "changes" && parts.size() == 2) return longPoll(req, scratch);
+    if (parts[1] == "changes" && parts.size() == 3 && parts[2] == "log") return changeLog(req, scratch);
+    if (parts[1] == "history" && parts.size() == 3) return history(req, urlDecode(parts[2]), scratch);
+    if (parts[1] == "alarms" && parts.size() == 2) return alarms(scratch);
+    if (parts[1] == "alarms" && parts.size() == 3 && parts[2] == "events") return alarmEvents(req, scratch);
+
+    writeError(body, "not found");
+    return 404;
+}
+
+int HttpServer::longPoll(const Request& req, Scratch& scratch) {
+    auto& body = scratch.body;
+    uint64_t since = 0;
+    uint32_t timeoutMs = 0;
+    if (const auto* s = param(req.params, "since"); s && !parseNumber(s, since)) {
+        writeError(body, "invalid since");
+        return 400;
+    }
+    if (const auto* t = param(req.params, "timeout_ms"); t && !parseNumber(t, timeoutMs)) {
+        writeError(body, "invalid timeout_ms");
+        return 400;
+    }
+    timeoutMs = std::min(timeoutMs, cfg_.maxLongPollMs);
+    const auto* dev = param(req.params, "device");
+    const auto* grp = param(req.params, "group");
+    auto& handles = scratch.handles;
+    if (!manager_->collectTagHandles(dev ? *dev : std::string{}, grp ? *grp : std::string{}, handles)) {
+        writeError(body, "device or group not found");
+        return 404;
+    }
+
+    // 网关重启后序号从头计数，客户端持有的 since 比当前大时按全量返回
+    if (since > TagRegistry::instance().changeSeq()) since = 0;
+    std::vector<TagHandle> changed;
+    const uint64_t seq = scanChanges(handles, since, changed);
+    // 暂无变化时交给停靠线程等待；停靠已满时立即返回空结果，客户端从 seq 继续轮询
+    if (changed.empty() && timeoutMs > 0 && running_ &&
+        parked_.load(std::memory_order_relaxed) < cfg_.maxParked) {
+        scratch.parkSince = since;
+        scratch.parkDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        return kParked;
+    }
+    writeTags(changed, seq, body, {}, true);
+    return 200;
+}
+
+int HttpServer::changeLog(const Request& req, Scratch& scratch) {
+    auto& body = scratch.body;
+    uint64_t since = 0;
+    uint32_t limit = kDefaultLogLimit;
+    if (const auto* s = param(req.params, "since"); s && !parseNumber(s, since)) {
+        writeError(body, "invalid since");
+        return 400;
+    }
+    if (const auto* l = param(req.params, "limit"); l && !parseNumber(l, limit)) {
+        writeError(body, "invalid limit");
+        return 400;
+    }
+    limit = std::clamp<uint32_t>(limit, 1, kMaxLogLimit);
+    auto& changes = scratch.changes;
+    changes.clear();
+    const auto res = ChangeLog::instance().read(since, limit, changes);
+    TagJsonWriter w(body);
+    if (res.status == ChangeLog::ReadStatus::ResyncRequired) {
+        // 全量重读时当前序号之前的变化都已体现在读到的值里
+        w.raw("{\"error\":\"resync required\",\"seq\":");
+        w.number(TagRegistry::instance().changeSeq());
+        w.raw(",\"oldest\":");
+        w.number(res.oldest);
+        w.raw('}');
+        return 410;
+    }
+    body.reserve(body.size() + 96 + changes.size() * 112);
+    w.raw("{\"seq\":");
+    w.number(res.head);
+    w.raw(",\"next\":");
+    w.number(res.next);
+    w.raw(",\"count\":");
+    w.number(static_cast<uint64_t>(changes.size()));
+    w.raw(",\"changes\":[");
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (i) w.raw(',');
+        w.tag(changes[i].handle, changes[i].sample);
+    }
+    w.raw("]}");
+    return 200;
+}
+
+int HttpServer::history(const Request& req, const std::string& id, Scratch& scratch) {
+    auto& body = scratch.body;
+    const TagHandle h = TagRegistry::instance().find(id);
+    if (h == kInvalidTag) {
+        writeError(body, "tag not found");
+        return 404;
+    }
+    int64_t to = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint32_t maxPoints = kDefaultHistoryPoints;
+    if (const auto* t = param(req.params, "to"); t && !parseNumber(t, to)) {
+        writeError(body, "invalid to");
+        return 400;
+    }
+    int64_t from = to - kDefaultHistorySpanMs;
+    if (const auto* f = param(req.params, "from"); f && !parseNumber(f, from)) {
+        writeError(body, "invalid from");
+        return 400;
+    }
+    if (const auto* m = param(req.params, "max_points"); m && !parseNumber(m, maxPoints)) {
+        writeError(body, "invalid max_points");
+        return 400;
+    }
+    maxPoints = std::clamp<uint32_t>(maxPoints, 1, kMaxHistoryPoints);
+    auto& points = scratch.points;
+    points.clear();
+    const bool truncated = TagHistory::instance().query(h, from, to, maxPoints, points);
+    // 每点形如 [1700000000000,12.5,"GOOD"]
+    body.reserve(body.size() + 96 + points.size() * 40);
+    TagJsonWriter w(body);
+    w.raw("{\"id\":");
+    w.string(id);
+    w.raw(",\"from\":");
+    w.number(from);
+    w.raw(",\"to\":");
+    w.number(to);
+    w.raw(",\"count\":");
+    w.number(static_cast<uint64_t>(points.size()));
+    w.raw(truncated ? ",\"truncated\":true" : ",\"truncated\":false");
+    w.raw(",\"points\":[");
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (i) w.raw(',');
+        w.raw('[');
+        w.number(points[i].tsMs);
+        w.raw(',');
+        w.number(points[i].value);
+        w.raw(",\"");
+        w.raw(TagJsonWriter::qualityName(points[i].quality));
+        w.raw("\"]");
+    }
+    w.raw("]}");
+    return 200;
+}
+
+int HttpServer::alarms(Scratch& scratch) {
+    auto& active = scratch.alarms;
+    active.clear();
+    AlarmEngine::instance().active(active);
+    std::sort(active.begin(), active.end(), [](const auto& a, const auto& b) { return a.since < b.since; });
+    auto& body = scratch.body;
+    body.reserve(body.size() + 32 + active.size() * 96);
+    TagJsonWriter w(body);
+    w.raw("{\"count\":");
+    w.number(static_cast<uint64_t>(active.size()));
+    w.raw(",\"alarms\":[");
+    for (size_t i = 0; i < active.size(); ++i) {
+        const auto& a = active[i];
+        if (i) w.raw(',');
+        w.raw("{\"id\":");
+        w.string(TagRegistry::instance().id(a.handle));
+        w.raw(",\"level\":\"");
+        w.raw(AlarmEngine::levelName(a.level));
+        w.raw("\",\"value\":");
+        w.number(a.value);
+        w.raw(",\"since\":");
+        w.number(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            a.since.time_since_epoch()).count()));
+        w.raw('}');
+    }
+    w.raw("]}");
+    return 200;
+}
+
+int HttpServer::alarmEvents(const Request& req, Scratch& scratch) {
+    auto& body = scratch.body;
+    uint64_t since = 0;
+    uint32_t limit = AlarmEngine::kMaxEvents;
+    if (const auto* s = param(req.params, "since"); s && !parseNumber(s, since)) {
+        writeError(body, "invalid since");
+        return 400;
+    }
+    if (const auto* l = param(req.params, "limit"); l && !parseNumber(l, limit)) {
+        writeError(body, "invalid limit");
+        return 400;
+    }
+    limit = std::clamp<uint32_t>(limit, 1, AlarmEngine::kMaxEvents);
+    auto& events = scratch.alarmEvents;
+    events.clear();
+    uint64_t oldest = 0;
+    const uint64_t head = AlarmEngine::instance().events(since, limit, events, &oldest);
+    body.reserve(body.size() + 64 + events.size() * 128);
+    TagJsonWriter w(body);
+    // oldest 大于 since + 1 说明有事件已滚出队列
+    w.raw("{\"seq\":");
+    w.number(head);
+    w.raw(",\"next\":");
+    w.number(events.empty() ? std::max(since, oldest - 1) : events.back().seq);
+    w.raw(",\"oldest\":");
+    w.number(oldest);
+    w.raw(",\"events\":[");
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& e = events[i];
+        if (i) w.raw(',');
+        w.raw("{\"seq\":");
+        w.number(e.seq);
+        w.raw(",\"id\":");
+        w.string(TagRegistry::instance().id(e.handle));
+        w.raw(",\"from\":\"");
+        w.raw(AlarmEngine::levelName(e.from));
+        w.raw("\",\"to\":\"");
+        w.raw(AlarmEngine::levelName(e.to));
+        w.raw("\",\"value\":");
+        w.number(e.value);
+        w.raw(",\"timestamp\":");
+        w.number(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            e.timestamp.time_since_epoch()).count()));
+        w.raw('}');
+    }
+    w.raw("]}");
+    return 200;
+}
+
+void HttpServer::writeTags(const std::vector<TagHandle>& handles, const uint64_t seq, std::string& body,
+                           const std::vector<std::string_view>& missing, const bool published) {
+    // 每个标签约 100 字节，预留后整个响应只扩容一次
+    body.reserve(body.size() + 64 + handles.size() * 112);
+    TagJsonWriter w(body);
+    w.raw("{\"seq\":");
+    w.number(seq);
+    w.raw(",\"count\":");
+    w.number(static_cast<uint64_t>(handles.size()));
+    w.raw(",\"tags\":[");
+    for (size_t i = 0; i < handles.size(); ++i) {
+        if (i) w.raw(',');
+        if (published) w.publishedTag(handles[i]);
+        else w.tag(handles[i]);
+    }
+    w.raw(']');
+    if (!missing.empty()) {
+        w.raw(",\"missing\":[");
+        for (size_t i = 0; i < missing.size(); ++i) {
+            if (i) w.raw(',');
+            w.string(missing[i]);
+        }
+        w.raw(']');
+    }
+    w.raw('}');
+}
+
+bool HttpServer::parseRequest(const std::string_view head, Request& req) {
+    const auto lineEnd = head.find("\r\n");
+    const auto line = head.substr(0, lineEnd);
+    const auto sp1 = line.find(' ');
+    const auto sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1) return false;
+    req.method = std::string(line.substr(0, sp1));
+    const auto target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    const auto version = line.substr(sp2 + 1);
+    req.keepAlive = version != "HTTP/1.0";
+
+    const auto q = target.find('?');
+    req.path = std::string(target.substr(0, q));
+    if (q != std::string_view::npos) {
+        std::string_view query = target.substr(q + 1);
+        while (!query.empty()) {
+            const auto amp = query.find('&');
+            const auto kv = query.substr(0, amp);
+            const auto eq = kv.find('=');
+            req.params.emplace_back(urlDecode(kv.substr(0, eq)),
+                                    eq == std::string_view::npos ? std::string{} : urlDecode(kv.substr(eq + 1)));
+            if (amp == std::string_view::npos) break;
+            query.remove_prefix(amp + 1);
+        }
+    }
+
+    std::string_view rest = lineEnd == std::string_view::npos ? std::string_view{} : head.substr(lineEnd + 2);
+    while (!rest.empty()) {
+        const auto end = rest.find("\r\n");
+        const auto header = rest.substr(0, end);
+        if (const auto colon = header.find(':'); colon != std::string_view::npos) {
+            const auto name = header.substr(0, colon);
+            auto value = header.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            while (!value.empty() && value.back() == ' ') value.remove_suffix(1);
+            if (iequals(name, "Connection")) {
+                if (iequals(value, "close")) req.keepAlive = false;
+                else if (iequals(value, "keep-alive")) req.keepAlive = true;
+            } else if (iequals(name, "Upgrade")) {
+                req.upgrade = iequals(value, "websocket");
+            } else if (iequals(name, "Sec-WebSocket-Key")) {
+                req.wsKey = std::string(value);
+            }
+        }
+        if (end == std::string_view::npos) break;
+        rest.remove_prefix(end + 2);
+    }
+    return !req.method.empty() && !req.path.empty() && req.path.front() == '/';
+}
+
+std::string HttpServer::urlDecode(const std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') {
+            out.push_back(' ');
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            unsigned v = 0;
+            const auto res = std::from_chars(s.data() + i + 1, s.data() + i + 3, v, 16);
+            if (res.ptr == s.data() + i + 3) {
+                out.push_back(static_cast<char>(v));
+                i += 2;
+            } else {
+                out.push_back('%');
+            }
+        } else {
+            out.push_back(s[i]);
+        }
+    }
+    return out;
+}
+
+const std::string* HttpServer::param(const Params& params, const std::string_view key) {
+    for (const auto& [k, v] : params) {
+        if (k == key) return &v;
+    }
+    return nullptr;
+}
+
+void HttpServer::writeError(std::string& body, const std::string_view message) {
+    TagJsonWriter w(body);
+    w.raw("{\"error\":");
+    w.string(message);
+    w.raw('}');
+}
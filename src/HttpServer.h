@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AlarmEngine.h"
+#include "ChangeLog.h"
+#include "TagHistory.h"
+#include "TagRegistry.h"
+#include "WebSocketHub.h"
+
+class DeviceManager;
+
+// 内嵌 HTTP/JSON 查询接口（只读，GET）：
+//   /api/tags                              全部标签；?ids=a,b,c 指定标签列表
+//   /api/tags/{id}                         单个标签
+//   /api/devices/{dev}/tags                设备下全部标签
+//   /api/devices/{dev}/groups/{grp}/tags   分组下全部标签
+//   /api/changes?since=N&timeout_ms=T      长轮询 since 之后变化的标签，可加 device/group 限定范围
+//   /api/changes/log?since=N&limit=M       变化日志中 since 之后的每一次变化（按序号，含同一标签的多次变化）；
+//                                          since 已滚出日志时返回 410，客户端需全量重读后从响应的 seq 继续
+//   /api/alarms                            当前处于报警的标签
+//   /api/alarms/events?since=N&limit=M     since 之后的报警状态变化事件（按事件序号）
+//   /api/history/{id}?from=&to=&max_points=N  内存历史中的数据点（毫秒时间戳），默认最近一小时
+//   /ws                                    WebSocket 订阅推送，握手后交给 WebSocketHub
+// 响应体中的 seq 为读取前的已提交变化序号水位（见 TagRegistry::changeSeq），客户端下次以它作为 since 即可不漏变化。
+// 连接由独立线程处理，只读 TagRegistry 的无锁值槽，不占用采集线程池。
+// 等待中的长轮询与两次请求之间空闲的 keep-alive 连接交给一个停靠线程，不占用工作线程：
+// 停靠线程每 20ms 检查长轮询并写回响应，空闲连接可读时重新交给工作线程
+class HttpServer {
+public:
+    struct Config {
+        std::string bind = "0.0.0.0";
+        int port = 0;
+        int workers = 4;                 // 同时处理的连接数
+        uint32_t maxLongPollMs = 30000;
+        size_t maxParked = 1024;         // 停靠的长轮询与空闲连接上限，满时长轮询立即返回、空闲连接关闭
+        WebSocketHub::Config ws;
+    };
+
+    HttpServer(std::shared_ptr<DeviceManager> manager, Config cfg);
+    ~HttpServer();
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    bool start();
+    void stop();
+
+private:
+    using Params = std::vector<std::pair<std::string, std::string>>;
+    struct Request {
+        std::string method;
+        std::string path;
+        Params params;
+        bool keepAlive = true;
+        bool upgrade = false;            // Upgrade: websocket
+        std::string wsKey;
+    };
+    // 每个工作线程一份，缓冲区跨请求复用
+    struct Scratch {
+        std::string body;
+        std::string head;
+        std::vector<TagHandle> handles;
+        std::vector<ChangeLog::Change> changes;
+        std::vector<AlarmEngine::Active> alarms;
+        std::vector<AlarmEngine::Event> alarmEvents;
+        std::vector<TagHistory::Point> points;
+        uint64_t parkSince = 0;
+        std::chrono::steady_clock::time_point parkDeadline;
+    };
+    static constexpr int kParked = 0;
+
+    struct Conn {
+        uintptr_t fd;
+        std::string in;                  // 已收到但尚未处理的字节
+    };
+    // 停靠的长轮询：有变化或超时后由停靠线程写回响应
+    struct Waiter {
+        Conn conn;
+        bool keepAlive;
+        uint64_t since;
+        std::vector<TagHandle> handles;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    struct Idle {
+        Conn conn;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void acceptLoop();
+    void workerLoop();
+    void parkLoop();
+    // 返回 true 表示连接已移交（升级为 WebSocket 或交给停靠线程），调用方不再关闭
+    bool serve(Conn& conn, Scratch& scratch);
+    bool parkIdle(Conn& conn);
+    bool sendResponse(uintptr_t fd, int status, bool keepAlive, Scratch& scratch);
+    // 长轮询写完响应后：keep-alive 连接若已收到下一个请求则交给工作线程，否则转为空闲停靠
+    void afterParked(Conn&& conn, bool keepAlive, std::vector<Idle>& idle, std::vector<Conn>& ready);
+    bool upgrade(uintptr_t fd, const Request& req, std::string& pending, Scratch& scratch);
+    int route(const Request& req, Scratch& scratch);
+    // published 为 true 时输出发布值（长轮询按变化返回，与 seq 对应压缩后的序列），否则输出最新值
+    void writeTags(const std::vector<TagHandle>& handles, uint64_t seq, std::string& body,
+                   const std::vector<std::string_view>& missing = {}, bool published = false);
+    // 暂无变化且可以等待时返回 kParked，等待参数放在 scratch 中
+    int longPoll(const Request& req, Scratch& scratch);
+    int changeLog(const Request& req, Scratch& scratch);
+    int alarms(Scratch& scratch);
+    int alarmEvents(const Request& req, Scratch& scratch);
+    int history(const Request& req, const std::string& id, Scratch& scratch);
+
+    static bool parseRequest(std::string_view head, Request& req);
+    static std::string urlDecode(std::string_view s);
+    static const std::string* param(const Params& params, std::string_view key);
+    static void writeError(std::string& body, std::string_view message);
+
+    std::shared_ptr<DeviceManager> manager_;
+    Config cfg_;
+    uintptr_t listenFd_;
+    std::atomic<bool> running_{false};
+    std::thread acceptThread_;
+    std::vector<std::thread> workers_;
+    std::unique_ptr<WebSocketHub> hub_;
+
+    std::mutex queueMtx_;
+    std::condition_variable queueCv_;
+    std::deque<Conn> pending_;
+
+    std::thread parkThread_;
+    std::mutex parkMtx_;
+    std::vector<Waiter> newWaiters_;     // 工作线程交来、停靠线程尚未接收的连接
+    std::vector<Idle> newIdle_;
+    std::atomic<size_t> parked_{0};
+};
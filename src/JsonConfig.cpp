@@ -1,110 +1,456 @@
 #include "JsonConfig.h"
 
-#include <codecvt>
-#include <boost/json.hpp>
+#include <boost/json/basic_parser_impl.hpp>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include "ConfigCache.h"
 
-using namespace boost::json;
+namespace {
 
-inline std::wstring utf8_to_wstring(const std::string& str) {
-    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> conv;
-    return conv.from_bytes(str);
+// UTF-8 -> wstring，wchar_t 为 16 位时（Windows）输出 UTF-16 代理对
+std::wstring utf8ToWide(const std::string_view s) {
+    std::wstring out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size();) {
+        const auto c = static_cast<unsigned char>(s[i]);
+        uint32_t cp;
+        size_t len;
+        if (c < 0x80)              { cp = c;        len = 1; }
+        else if ((c >> 5) == 0x6)  { cp = c & 0x1F; len = 2; }
+        else if ((c >> 4) == 0xE)  { cp = c & 0x0F; len = 3; }
+        else if ((c >> 3) == 0x1E) { cp = c & 0x07; len = 4; }
+        else throw std::runtime_error("Invalid UTF-8 in config");
+        if (i + len > s.size()) throw std::runtime_error("Invalid UTF-8 in config");
+        for (size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+        i += len;
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (cp >= 0x10000) {
+                cp -= 0x10000;
+                out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+                out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+                continue;
+            }
+        }
+        out.push_back(static_cast<wchar_t>(cp));
+    }
+    return out;
 }
 
-static VariableConfig parseVariable(const object& o) {
-    VariableConfig v;
-    v.id = o.at("id").as_string().c_str();
-    v.name = o.at("name").as_string().c_str();
-    v.type = o.at("type").as_string().c_str();
-    v.address = utf8_to_wstring(o.at("address").as_string().c_str());
-    v.length = VariableConfig::regLengthFromType(v.type);
-    if (o.if_contains("persist_on_change"))
-        v.persist_on_change = o.at("persist_on_change").as_bool();
-    if (o.if_contains("access"))
-        v.access = o.at("access").as_string().c_str();
-    return v;
-}
+// 解析上下文：只认识配置结构中的已知节点，其余整棵子树跳过
+enum class Ctx { Root, System, Storage, Fields, Devices, Device, Groups, Group, Variables, Variable, Alarm, Compression, Aggregates, Aggregate, Calcs, Calc, Skip };
 
-static GroupConfig parseGroup(const object& o) {
-    GroupConfig g;
-    g.id = o.at("id").as_string().c_str();
-    g.name = o.at("name").as_string().c_str();
-    g.interval_ms = static_cast<int>(o.at("interval_ms").as_int64());
-    if (o.if_contains("persist_on_change"))
-        g.persist_on_change = o.at("persist_on_change").as_bool();
-    for (auto&& vj : o.at("variables").as_array())
-        g.variables.push_back(parseVariable(vj.as_object()));
-    return g;
-}
+// 必填字段位
+enum : uint32_t {
+    kId = 1u << 0, kName = 1u << 1, kType = 1u << 2, kChildren = 1u << 3,
+    kAddress = 1u << 4, kInterval = 1u << 5,
+    kHost = 1u << 6, kUser = 1u << 7, kPassword = 1u << 8, kDatabase = 1u << 9, kTable = 1u << 10,
+    kSystem = 1u << 11, kStorage = 1u << 12, kDevices = 1u << 13, kExpr = 1u << 14,
+};
 
-static DeviceConfig parseDevice(const object& o) {
-    DeviceConfig d;
-    d.id = o.at("id").as_string().c_str();
-    d.name = o.at("name").as_string().c_str();
-    d.type = o.at("type").as_string().c_str();
-
-    if (d.type == "modbus") {
-        if (o.if_contains("protocol"))   d.protocol = o.at("protocol").as_string().c_str();
-        if (o.if_contains("ip"))         d.ip = o.at("ip").as_string().c_str();
-        if (o.if_contains("port"))       d.port = static_cast<int>(o.at("port").as_int64());
-        if (o.if_contains("slave_id"))   d.slave_id = static_cast<int>(o.at("slave_id").as_int64());
-        if (o.if_contains("endianness")) d.endianness = o.at("endianness").as_string().c_str();
-        if (o.if_contains("byte_swap"))  d.byte_swap = o.at("byte_swap").as_bool();
-    } else if (d.type == "opcda") {
-        if (o.if_contains("host"))       d.host = o.at("host").as_string().c_str();
-        if (o.if_contains("servername")) d.servername = o.at("servername").as_string().c_str();
-    }
-    for (auto&& gj : o.at("groups").as_array())
-        d.groups.push_back(parseGroup(gj.as_object()));
-    return d;
-}
+// boost::json::basic_parser 的事件处理器，边解析边填充 GlobalConfig
+class ConfigHandler {
+public:
+    static constexpr std::size_t max_object_size = std::size_t(-1);
+    static constexpr std::size_t max_array_size = std::size_t(-1);
+    static constexpr std::size_t max_key_size = std::size_t(-1);
+    static constexpr std::size_t max_string_size = std::size_t(-1);
 
-static StorageConfig parseStorage(const object& o) {
-    StorageConfig s;
-    s.type = o.at("type").as_string().c_str();
-    s.host = o.at("host").as_string().c_str();
-    if (o.if_contains("port"))
-        s.port = static_cast<int>(o.at("port").as_int64());
-    s.user = o.at("user").as_string().c_str();
-    s.password = o.at("password").as_string().c_str();
-    s.database = o.at("database").as_string().c_str();
-    s.table = o.at("table").as_string().c_str();
-    if (o.if_contains("write_on_change"))
-        s.write_on_change = o.at("write_on_change").as_bool();
-    if (o.if_contains("write_on_interval_ms"))
-        s.write_on_interval_ms = static_cast<int>(o.at("write_on_interval_ms").as_int64());
-    if (o.if_contains("fields")) {
-        for (auto&& fj : o.at("fields").as_array())
-            s.fields.emplace_back(fj.as_string().c_str());
-    }
-    return s;
-}
+    GlobalConfig cfg;
+
+    bool on_document_begin(boost::json::error_code&) { return true; }
+    bool on_document_end(boost::json::error_code&) { return true; }
+
+    bool on_object_begin(boost::json::error_code&) { return enter(false); }
+    bool on_object_end(std::size_t, boost::json::error_code&) { return leave(); }
+    bool on_array_begin(boost::json::error_code&) { return enter(true); }
+    bool on_array_end(std::size_t, boost::json::error_code&) { return leave(); }
+
+    bool on_key_part(const boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        key_.append(s.data(), s.size());
+        return true;
+    }
+    bool on_key(const boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        key_.append(s.data(), s.size());
+        return true;
+    }
+    bool on_string_part(const boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        str_.append(s.data(), s.size());
+        return true;
+    }
+    bool on_string(const boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        if (str_.empty()) {
+            onString(std::string_view(s.data(), s.size()));
+        } else {
+            str_.append(s.data(), s.size());
+            onString(str_);
+            str_.clear();
+        }
+        key_.clear();
+        return true;
+    }
+    bool on_number_part(boost::json::string_view, boost::json::error_code&) { return true; }
+    bool on_int64(const int64_t v, boost::json::string_view, boost::json::error_code&) { onInt(v); key_.clear(); return true; }
+    bool on_uint64(const uint64_t v, boost::json::string_view, boost::json::error_code&) {
+        if (v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) onDouble(static_cast<double>(v));
+        else onInt(static_cast<int64_t>(v));
+        key_.clear();
+        return true;
+    }
+    bool on_double(const double v, boost::json::string_view, boost::json::error_code&) { onDouble(v); key_.clear(); return true; }
+    bool on_bool(const bool v, boost::json::error_code&) { onBool(v); key_.clear(); return true; }
+    bool on_null(boost::json::error_code&) { key_.clear(); return true; }
+    bool on_comment_part(boost::json::string_view, boost::json::error_code&) { return true; }
+    bool on_comment(boost::json::string_view, boost::json::error_code&) { return true; }
+
+private:
+    struct Frame {
+        Ctx ctx;
+        uint32_t seen;
+    };
+
+    [[nodiscard]] bool is(const char* k) const { return key_ == k; }
+    Frame& top() { return stack_.back(); }
+    DeviceConfig& device() { return cfg.devices.back(); }
+    GroupConfig& group() { return device().groups.back(); }
+    VariableConfig& variable() { return group().variables.back(); }
+
+    Ctx childOf(const Ctx parent, const bool isArray) {
+        auto& f = top();
+        switch (parent) {
+            case Ctx::Root:
+                if (!isArray && is("system"))  { f.seen |= kSystem;  return Ctx::System; }
+                if (!isArray && is("storage")) { f.seen |= kStorage; return Ctx::Storage; }
+                if (isArray && is("devices"))  { f.seen |= kDevices; return Ctx::Devices; }
+                if (isArray && is("calculations")) return Ctx::Calcs;
+                return Ctx::Skip;
+            case Ctx::Calcs:     return isArray ? Ctx::Skip : Ctx::Calc;
+            case Ctx::Storage:   return isArray && is("fields") ? Ctx::Fields : Ctx::Skip;
+            case Ctx::Devices:   return isArray ? Ctx::Skip : Ctx::Device;
+            case Ctx::Device:
+                if (isArray && is("groups")) { f.seen |= kChildren; return Ctx::Groups; }
+                return Ctx::Skip;
+            case Ctx::Groups:    return isArray ? Ctx::Skip : Ctx::Group;
+            case Ctx::Group:
+                if (isArray && is("variables")) { f.seen |= kChildren; return Ctx::Variables; }
+                if (isArray && is("aggregates")) { aggTarget_ = &group().aggregates; return Ctx::Aggregates; }
+                return Ctx::Skip;
+            case Ctx::Variables: return isArray ? Ctx::Skip : Ctx::Variable;
+            case Ctx::Variable:
+                if (!isArray && is("alarm")) return Ctx::Alarm;
+                if (!isArray && is("compression")) return Ctx::Compression;
+                if (isArray && is("aggregates")) { aggTarget_ = &variable().aggregates; return Ctx::Aggregates; }
+                return Ctx::Skip;
+            case Ctx::Aggregates: return isArray ? Ctx::Skip : Ctx::Aggregate;
+            default:             return Ctx::Skip;
+        }
+    }
+
+    bool enter(const bool isArray) {
+        if (stack_.empty()) {
+            if (isArray) throw std::runtime_error("Config root must be an object");
+            stack_.push_back({Ctx::Root, 0});
+            return true;
+        }
+        const Ctx c = childOf(top().ctx, isArray);
+        if (c == Ctx::Device)        cfg.devices.emplace_back();
+        else if (c == Ctx::Group)    device().groups.emplace_back();
+        else if (c == Ctx::Variable) group().variables.emplace_back();
+        else if (c == Ctx::Calc)     cfg.calculations.emplace_back();
+        else if (c == Ctx::Aggregate) aggTarget_->emplace_back();
+        stack_.push_back({c, 0});
+        key_.clear();
+        return true;
+    }
+
+    bool leave() {
+        const Frame f = top();
+        stack_.pop_back();
+        finish(f);
+        return true;
+    }
+
+    static void require(const uint32_t seen, const uint32_t mask, const char* what) {
+        if ((seen & mask) != mask)
+            throw std::runtime_error(std::string("Missing required field in ") + what);
+    }
+
+    void finish(const Frame& f) {
+        switch (f.ctx) {
+            case Ctx::Root:     require(f.seen, kSystem | kStorage | kDevices, "root"); break;
+            case Ctx::Storage:  require(f.seen, kType | kHost | kUser | kPassword | kDatabase | kTable, "storage"); break;
+            case Ctx::Device:   require(f.seen, kId | kName | kType | kChildren, "device"); break;
+            case Ctx::Group:    require(f.seen, kId | kName | kInterval | kChildren, "group"); break;
+            case Ctx::Variable:
+                require(f.seen, kId | kName | kType | kAddress, "variable");
+                finishVariable();
+                break;
+            case Ctx::Aggregate: {
+                const auto& a = aggTarget_->back();
+                if (a.window_ms <= 0 || a.step_ms < 0 || (a.step_ms > 0 && a.window_ms % a.step_ms != 0))
+                    throw std::runtime_error("Invalid aggregate window: window_ms must be positive and a multiple of step_ms");
+                break;
+            }
+            case Ctx::Calc: {
+                require(f.seen, kId | kExpr, "calculation");
+                auto& c = cfg.calculations.back();
+                if (c.name.empty()) c.name = c.id;
+                c.varType = Variable::parseType(c.type);
+                break;
+            }
+            default: break;
+        }
+    }
+
+    void finishVariable() {
+        auto& v = variable();
+        v.length = VariableConfig::regLengthFromType(v.type);
+        v.varType = Variable::parseType(v.type);
+        v.varAccess = Variable::parseAccess(v.access);
+        // scale 为 0 时写入无法由工程值还原原始值（ScaleParams::toRaw 除以 scale）
+        if (v.scaling.scale == 0 || !std::isfinite(v.scaling.scale) || !std::isfinite(v.scaling.offset))
+            throw std::runtime_error("Invalid scale/offset for variable: " + v.id);
+        const auto& c = v.compression;
+        if (!(c.exc_dev >= 0) || !(c.comp_dev >= 0) || !std::isfinite(c.exc_dev) || !std::isfinite(c.comp_dev) ||
+            c.max_interval_ms < 0)
+            throw std::runtime_error("Invalid compression for variable: " + v.id);
+    }
+
+    void onString(const std::string_view v) {
+        auto& f = top();
+        switch (f.ctx) {
+            case Ctx::System:
+                if (is("log_level"))     cfg.system.log_level = v;
+                else if (is("log_file")) cfg.system.log_file = v;
+                else if (is("timer_backend")) cfg.system.timer_backend = v;
+                else if (is("http_bind"))     cfg.system.http_bind = v;
+                else if (is("changelog_spill_path")) cfg.system.changelog_spill_path = v;
+                else if (is("shm_name"))      cfg.system.shm_name = v;
+                break;
+            case Ctx::Storage: {
+                auto& s = cfg.storage;
+                if (is("type"))          { s.type = v;     f.seen |= kType; }
+                else if (is("host"))     { s.host = v;     f.seen |= kHost; }
+                else if (is("user"))     { s.user = v;     f.seen |= kUser; }
+                else if (is("password")) { s.password = v; f.seen |= kPassword; }
+                else if (is("database")) { s.database = v; f.seen |= kDatabase; }
+                else if (is("table"))    { s.table = v;    f.seen |= kTable; }
+                break;
+            }
+            case Ctx::Fields:
+                cfg.storage.fields.emplace_back(v);
+                break;
+            case Ctx::Device: {
+                auto& d = device();
+                if (is("id"))              { d.id = v;   f.seen |= kId; }
+                else if (is("name"))       { d.name = v; f.seen |= kName; }
+                else if (is("type"))       { d.type = v; f.seen |= kType; }
+                else if (is("protocol"))   d.protocol = v;
+                else if (is("ip"))         d.ip = v;
+                else if (is("endianness")) d.endianness = v;
+                else if (is("host"))       d.host = v;
+                else if (is("servername")) d.servername = v;
+                else if (is("endpoint"))   d.endpoint = v;
+                else if (is("username"))   d.username = v;
+                else if (is("password"))   d.password = v;
+                break;
+            }
+            case Ctx::Group: {
+                auto& g = group();
+                if (is("id"))          { g.id = v;   f.seen |= kId; }
+                else if (is("name"))   { g.name = v; f.seen |= kName; }
+                else if (is("mode"))   g.mode = v;
+                else if (is("priority")) {
+                    g.priority = v;
+                    g.taskPriority = ThreadPool::parsePriority(g.priority);
+                    if (g.taskPriority == TaskPriority::SYSTEM)
+                        throw std::runtime_error("Group priority 'system' is reserved: " + g.id);
+                }
+                break;
+            }
+            case Ctx::Calc: {
+                auto& c = cfg.calculations.back();
+                if (is("id"))         { c.id = v;   f.seen |= kId; }
+                else if (is("expr"))  { c.expr = v; f.seen |= kExpr; }
+                else if (is("name"))  c.name = v;
+                else if (is("type"))  c.type = v;
+                break;
+            }
+            case Ctx::Variable: {
+                auto& var = variable();
+                if (is("id"))           { var.id = v;   f.seen |= kId; }
+                else if (is("name"))    { var.name = v; f.seen |= kName; }
+                else if (is("type"))    { var.type = v; f.seen |= kType; }
+                else if (is("address")) { var.address = utf8ToWide(v); f.seen |= kAddress; }
+                else if (is("access"))  var.access = v;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // 整数字段赋值；成员名不是当前上下文的整数字段时返回 false
+    bool setInt(const int64_t v) {
+        const auto i = static_cast<int>(v);
+        switch (top().ctx) {
+            case Ctx::System:
+                if (is("thread_pool_size"))              cfg.system.thread_pool_size = i;
+                else if (is("config_watch_interval_ms")) cfg.system.config_watch_interval_ms = i;
+                else if (is("connect_concurrency"))      cfg.system.connect_concurrency = i;
+                else if (is("connect_timeout_ms"))       cfg.system.connect_timeout_ms = i;
+                else if (is("write_coalesce_ms"))        cfg.system.write_coalesce_ms = i;
+                else if (is("read_share_window_ms"))     cfg.system.read_share_window_ms = i;
+                else if (is("shed_lag_ms"))              cfg.system.shed_lag_ms = i;
+                else if (is("shed_recover_lag_ms"))      cfg.system.shed_recover_lag_ms = i;
+                else if (is("shed_queue_per_thread"))    cfg.system.shed_queue_per_thread = i;
+                else if (is("shed_max_level"))           cfg.system.shed_max_level = i;
+                else if (is("shed_check_interval_ms"))   cfg.system.shed_check_interval_ms = i;
+                else if (is("timer_spin_us"))            cfg.system.timer_spin_us = i;
+                else if (is("timer_cpu"))                cfg.system.timer_cpu = i;
+                else if (is("http_port"))                cfg.system.http_port = i;
+                else if (is("http_workers"))             cfg.system.http_workers = i;
+                else if (is("ws_interval_ms"))           cfg.system.ws_interval_ms = i;
+                else if (is("ws_max_clients"))           cfg.system.ws_max_clients = i;
+                else if (is("changelog_capacity"))       cfg.system.changelog_capacity = i;
+                else if (is("changelog_spill_max_mb"))   cfg.system.changelog_spill_max_mb = i;
+                else if (is("calc_interval_ms"))         cfg.system.calc_interval_ms = i;
+                else if (is("history_retention_s"))      cfg.system.history_retention_s = i;
+                else if (is("history_max_mb"))           cfg.system.history_max_mb = i;
+                else if (is("shm_max_tags"))             cfg.system.shm_max_tags = i;
+                else return false;
+                return true;
+            case Ctx::Storage:
+                if (is("port"))                      cfg.storage.port = i;
+                else if (is("write_on_interval_ms")) cfg.storage.write_on_interval_ms = i;
+                else return false;
+                return true;
+            case Ctx::Device:
+                if (is("port"))          device().port = i;
+                else if (is("slave_id")) device().slave_id = i;
+                else if (is("max_requests_per_sec")) device().max_requests_per_sec = i;
+                else if (is("request_burst"))        device().request_burst = i;
+                else return false;
+                return true;
+            case Ctx::Group:
+                if (is("interval_ms")) { group().interval_ms = i; top().seen |= kInterval; }
+                else if (is("min_interval_ms")) group().min_interval_ms = i;
+                else if (is("max_interval_ms")) group().max_interval_ms = i;
+                else if (is("trigger_address")) group().trigger_address = i;
+                else if (is("trigger_max_stale_ms")) group().trigger_max_stale_ms = i;
+                else return false;
+                return true;
+            case Ctx::Variable:
+                if (is("interval_ms")) variable().interval_ms = i;
+                else return false;
+                return true;
+            case Ctx::Aggregate:
+                if (is("window_ms"))    aggTarget_->back().window_ms = i;
+                else if (is("step_ms")) aggTarget_->back().step_ms = i;
+                else return false;
+                return true;
+            case Ctx::Alarm:
+                if (is("on_delay_ms"))       variable().alarm.on_delay_ms = i;
+                else if (is("off_delay_ms")) variable().alarm.off_delay_ms = i;
+                else return false;
+                return true;
+            case Ctx::Compression:
+                if (is("max_interval_ms")) variable().compression.max_interval_ms = i;
+                else return false;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void onInt(const int64_t v) {
+        // 超出 int 的整数交给 onDouble：整数字段报错，浮点字段照常接受
+        if (v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max() || !setInt(v))
+            onDouble(static_cast<double>(v));
+    }
+
+    void onDouble(const double v) {
+        // 整数字段也接受 1000.0 这类整数值的浮点字面量；带小数或超出范围时报告字段类型错误，
+        // 不静默丢弃（丢弃后必填字段会被误报为缺失）
+        const bool integral = std::isfinite(v) && std::trunc(v) == v &&
+                              v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max();
+        if (setInt(integral ? static_cast<int64_t>(v) : 0)) {
+            if (!integral)
+                throw std::runtime_error("Field '" + key_ + "' must be an integer within int range, got " +
+                                         std::to_string(v));
+            return;
+        }
+        if (top().ctx == Ctx::Variable) {
+            auto& s = variable().scaling;
+            if (is("scale"))          s.scale = v;
+            else if (is("offset"))    s.offset = v;
+            else if (is("clamp_min")) s.clampMin = v;
+            else if (is("clamp_max")) s.clampMax = v;
+            else if (is("valid_min")) s.validMin = v;
+            else if (is("valid_max")) s.validMax = v;
+        } else if (top().ctx == Ctx::Alarm) {
+            auto& a = variable().alarm;
+            if (is("hihi"))          a.hihi = v;
+            else if (is("hi"))       a.hi = v;
+            else if (is("lo"))       a.lo = v;
+            else if (is("lolo"))     a.lolo = v;
+            else if (is("deadband")) a.deadband = v;
+        } else if (top().ctx == Ctx::Compression) {
+            auto& c = variable().compression;
+            if (is("exc_dev"))       c.exc_dev = v;
+            else if (is("comp_dev")) c.comp_dev = v;
+        }
+    }
 
-static SystemConfig parseSystem(const object& o) {
-    SystemConfig s;
-    if (o.if_contains("thread_pool_size"))
-        s.thread_pool_size = static_cast<int>(o.at("thread_pool_size").as_int64());
-    if (o.if_contains("log_level"))
-        s.log_level = o.at("log_level").as_string().c_str();
-    if (o.if_contains("log_file"))
-        s.log_file = o.at("log_file").as_string().c_str();
-    return s;
+    void onBool(const bool v) {
+        switch (top().ctx) {
+            case Ctx::Storage:
+                if (is("write_on_change")) cfg.storage.write_on_change = v;
+                break;
+            case Ctx::Device:
+                if (is("byte_swap")) device().byte_swap = v;
+                break;
+            case Ctx::Group:
+                if (is("persist_on_change")) group().persist_on_change = v;
+                else if (is("adaptive"))     group().adaptive = v;
+                break;
+            case Ctx::Variable:
+                if (is("persist_on_change")) variable().persist_on_change = v;
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<Frame> stack_;
+    std::vector<AggregateConfig>* aggTarget_ = nullptr;  // 当前 aggregates 数组所属的分组或变量
+    std::string key_;   // 当前成员名（可能跨块拼接）
+    std::string str_;   // 跨块的字符串值
+};
+
+} // namespace
+
+GlobalConfig JsonConfig::parse(const std::string_view content) {
+    boost::json::basic_parser<ConfigHandler> parser(boost::json::parse_options{});
+    boost::json::error_code ec;
+    const size_t n = parser.write_some(false, content.data(), content.size(), ec);
+    if (ec) throw std::runtime_error("JSON syntax error: " + ec.message());
+    if (n != content.size()) throw std::runtime_error("Unexpected trailing data in config");
+    return std::move(parser.handler().cfg);
 }
 
-GlobalConfig JsonConfig::load(const std::string& path) {
+GlobalConfig JsonConfig::load(const std::string& path, const std::string& cachePath) {
     try {
-        std::ifstream ifs(path);
+        std::ifstream ifs(path, std::ios::binary);
         if (!ifs) throw std::runtime_error("Cannot open config file: " + path);
         const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        value rootv = parse(content);
-        object root = rootv.as_object();
-
-        GlobalConfig cfg;
-        cfg.system = parseSystem(root.at("system").as_object());
-        cfg.storage = parseStorage(root.at("storage").as_object());
-        for (auto&& devj : root.at("devices").as_array())
-            cfg.devices.push_back(parseDevice(devj.as_object()));
+        if (cachePath.empty()) return parse(content);
+
+        const uint64_t hash = ConfigCache::contentHash(content);
+        if (auto cached = ConfigCache::load(cachePath, hash)) return std::move(*cached);
+        GlobalConfig cfg = parse(content);
+        ConfigCache::save(cachePath, hash, cfg);
         return cfg;
     } catch (const std::exception& e) {
         std::cerr << "[JsonConfig] Failed to parse config: " << e.what() << std::endl;
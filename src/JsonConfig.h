@@ -1,7 +1,14 @@
 #pragma once
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "AggregateSet.h"
+#include "AlarmEngine.h"
+#include "ScaleStage.h"
+#include "TagCompressor.h"
+#include "ThreadPool.h"
+#include "Variable.h"
 
 // 变量配置
 struct VariableConfig {
@@ -12,12 +19,31 @@ struct VariableConfig {
     int length = 0;
     bool persist_on_change = false;
     std::string access = "RO";
+    int interval_ms = 0;             // 变量自身采样周期，0 表示随分组；按分组周期的整数倍取整
+    // 工程量换算：scale / offset / clamp_min / clamp_max / valid_min / valid_max，仅 modbus 非 bool 变量生效
+    ScaleParams scaling;
+    // 限值报警："alarm": {hihi, hi, lo, lolo, deadband, on_delay_ms, off_delay_ms}
+    AlarmLimits alarm;
+    // 数据压缩（工程单位）："compression": {exc_dev, comp_dev, max_interval_ms}
+    CompressionParams compression;
+    // 聚合窗口，与所在分组的 aggregates 合并
+    std::vector<AggregateConfig> aggregates;
+    // 加载时解析一次，DeviceManager 直接使用
+    VarType varType = VarType::UINT16;
+    VarAccess varAccess = VarAccess::RO;
     static int regLengthFromType(const std::string& type) {
         if (type == "bool" || type == "int16" || type == "uint16") return 1;
         if (type == "int32" || type == "uint32" || type == "float") return 2;
         if (type == "int64" || type == "uint64" || type == "double") return 4;
         throw std::runtime_error("Unknown Modbus variable type: " + type);
     }
+    bool operator==(const VariableConfig& o) const {
+        return id == o.id && name == o.name && type == o.type && address == o.address &&
+               length == o.length && persist_on_change == o.persist_on_change && access == o.access &&
+               interval_ms == o.interval_ms && scaling == o.scaling &&
+               alarm == o.alarm && compression == o.compression && aggregates == o.aggregates;
+    }
+    bool operator!=(const VariableConfig& o) const { return !(*this == o); }
 };
 
 struct GroupConfig {
@@ -25,7 +51,28 @@ struct GroupConfig {
     std::string name;
     int interval_ms = 1000;
     bool persist_on_change = false;
+    std::string mode = "subscribe";  // opcua: subscribe/poll
+    std::string priority = "normal"; // high/normal/low
+    TaskPriority taskPriority = TaskPriority::NORMAL;  // 加载时由 priority 解析
+    // 自适应轮询：值不变时周期在 [min, max] 内逐步拉长，一旦变化立即回到 min
+    bool adaptive = false;
+    int min_interval_ms = 0;         // 0 表示取 interval_ms
+    int max_interval_ms = 0;         // 0 表示取 min 的 16 倍
+    // modbus 触发寄存器：每周期只读该地址，值变化或超过最大陈旧时间才整组读取；-1 表示不启用
+    int trigger_address = -1;
+    int trigger_max_stale_ms = 60000;
+    // 对分组内每个变量生效的聚合窗口
+    std::vector<AggregateConfig> aggregates;
     std::vector<VariableConfig> variables;
+    bool operator==(const GroupConfig& o) const {
+        return id == o.id && name == o.name && interval_ms == o.interval_ms &&
+               persist_on_change == o.persist_on_change && mode == o.mode &&
+               priority == o.priority && adaptive == o.adaptive &&
+               min_interval_ms == o.min_interval_ms && max_interval_ms == o.max_interval_ms &&
+               trigger_address == o.trigger_address && trigger_max_stale_ms == o.trigger_max_stale_ms &&
+               aggregates == o.aggregates && variables == o.variables;
+    }
+    bool operator!=(const GroupConfig& o) const { return !(*this == o); }
 };
 
 // 通用设备配置，所有协议的字段都放进来，不用的就是默认值
@@ -41,12 +88,43 @@ struct DeviceConfig {
     int slave_id = 0;        // modbus
     std::string endianness;  // modbus
     bool byte_swap = false;  // modbus
+    // 请求限流（令牌桶），0 表示不限；同一 ip:port 上的设备共用一个桶
+    int max_requests_per_sec = 0;  // modbus
+    int request_burst = 0;         // modbus，令牌桶容量，0 时取 max_requests_per_sec
 
     // opcda 专用
     std::string host;        // opcda
     std::string servername;  // opcda
 
+    // opcua 专用
+    std::string endpoint;    // opcua
+    std::string username;    // opcua
+    std::string password;    // opcua
+
     std::vector<GroupConfig> groups;
+
+    // 除分组外的连接参数是否一致；不一致时热加载需要重建整个设备
+    bool sameConnection(const DeviceConfig& o) const {
+        return id == o.id && name == o.name && type == o.type && protocol == o.protocol &&
+               ip == o.ip && port == o.port && slave_id == o.slave_id &&
+               endianness == o.endianness && byte_swap == o.byte_swap &&
+               max_requests_per_sec == o.max_requests_per_sec && request_burst == o.request_burst &&
+               host == o.host && servername == o.servername &&
+               endpoint == o.endpoint && username == o.username && password == o.password;
+    }
+};
+
+// 计算标签：由表达式从其他标签派生，见 CalcEngine
+struct CalcTagConfig {
+    std::string id;
+    std::string name;
+    std::string type = "double";
+    std::string expr;
+    VarType varType = VarType::DOUBLE;   // 加载时由 type 解析
+    bool operator==(const CalcTagConfig& o) const {
+        return id == o.id && name == o.name && type == o.type && expr == o.expr;
+    }
+    bool operator!=(const CalcTagConfig& o) const { return !(*this == o); }
 };
 
 struct StorageConfig {
@@ -66,15 +144,53 @@ struct SystemConfig {
     int thread_pool_size = 32;
     std::string log_level = "info";
     std::string log_file = "logs/gateway.log";
+    int config_watch_interval_ms = 2000;  // 配置文件变更检测周期，0 表示关闭热加载
+    int connect_concurrency = 16;         // 启动时并行连接设备的数量上限
+    int connect_timeout_ms = 10000;       // 单个设备连接超时
+    int write_coalesce_ms = 5;            // 写请求合并窗口，0 表示收到即写
+    int read_share_window_ms = 200;       // modbus 跨分组共享读结果的最长时间，0 表示关闭
+    // 过载降载：派发延迟或线程池积压超过阈值时逐级拉长低优先级分组周期
+    int shed_lag_ms = 1000;               // 派发延迟阈值，0 表示关闭降载
+    int shed_recover_lag_ms = 200;        // 低于该延迟视为恢复
+    int shed_queue_per_thread = 4;        // 积压阈值 = 线程数 × 该值
+    int shed_max_level = 3;               // 最多拉长到 2^level 倍
+    int shed_check_interval_ms = 1000;
+    // 定时器：timer_backend 为 "timerfd" 时启用 Linux timerfd；timer_spin_us 为到期前忙等时长
+    std::string timer_backend = "default";
+    int timer_spin_us = 0;
+    int timer_cpu = -1;                   // 定时线程绑定的 CPU，-1 表示不绑定
+    // HTTP 查询接口，http_port 为 0 表示关闭
+    std::string http_bind = "0.0.0.0";
+    int http_port = 0;
+    int http_workers = 4;
+    // WebSocket 推送：默认推送周期与最大客户端数
+    int ws_interval_ms = 200;
+    int ws_max_clients = 64;
+    // 变化日志：内存环容量（条），可选落盘路径与磁盘尾部上限；路径为空不落盘
+    int changelog_capacity = 65536;
+    std::string changelog_spill_path;
+    int changelog_spill_max_mb = 64;
+    // 内存历史保留时长，0 表示不记录；内存上限达到后各标签复用自己最旧的块。
+    // 默认上限按 10 万标签、1 秒采样保留 1 小时估算：3.6 亿样本，典型 2~3 字节/样本
+    int history_retention_s = 0;
+    int history_max_mb = 1024;
+    // 共享内存标签表：段名为空表示不发布；容量即可发布的标签句柄上限
+    std::string shm_name;
+    int shm_max_tags = 65536;
+    int calc_interval_ms = 100;           // 计算标签检查输入变化的周期
 };
 
 struct GlobalConfig {
     SystemConfig system;
     StorageConfig storage;
     std::vector<DeviceConfig> devices;
+    std::vector<CalcTagConfig> calculations;
 };
 
 class JsonConfig {
 public:
-    static GlobalConfig load(const std::string& path);
+    // cachePath 非空时启用二进制配置快照：内容哈希一致则直接映射加载，否则解析后重新生成
+    static GlobalConfig load(const std::string& path, const std::string& cachePath = {});
+    // 流式解析 JSON 文本，不构建 DOM
+    static GlobalConfig parse(std::string_view content);
 };
@@ -0,0 +1,113 @@
+#include "LoadGovernor.h"
+#include <algorithm>
+#include <utility>
+#include "Logger.h"
+
+namespace {
+// 按降载顺序排列的可降载优先级；恢复时逆序
+constexpr TaskPriority kSheddable[] = {TaskPriority::LOW, TaskPriority::NORMAL};
+// 连续多少次检查处于低延迟才还原一级，避免在阈值附近来回抖动
+constexpr int kRecoverChecks = 3;
+}
+
+LoadGovernor::LoadGovernor(std::shared_ptr<ThreadPool> pool, std::shared_ptr<TimerScheduler> scheduler,
+                           const Config& cfg)
+    : pool_(std::move(pool)), scheduler_(std::move(scheduler)), cfg_(cfg) {}
+
+LoadGovernor::~LoadGovernor() {
+    if (timer_) scheduler_->cancel(timer_);
+}
+
+void LoadGovernor::start() {
+    if (timer_) return;
+    std::weak_ptr<LoadGovernor> weakSelf = shared_from_this();
+    timer_ = scheduler_->scheduleEvery(cfg_.checkIntervalMs, [weakSelf]() {
+        if (const auto self = weakSelf.lock()) self->evaluate();
+    }, cfg_.checkIntervalMs, TaskPriority::SYSTEM);
+}
+
+void LoadGovernor::track(const TimerScheduler::TimerHandle handle, const std::string& key,
+                         const uint32_t baseIntervalMs, const TaskPriority priority) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tracked_[handle] = {key, baseIntervalMs, priority};
+    if (const int level = stats_.level[static_cast<size_t>(priority)]; level > 0) {
+        scheduler_->setInterval(handle, baseIntervalMs << level);
+        ++stats_.stretchedTasks;
+    }
+}
+
+void LoadGovernor::untrack(const TimerScheduler::TimerHandle handle) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const auto it = tracked_.find(handle);
+    if (it == tracked_.end()) return;
+    if (stats_.level[static_cast<size_t>(it->second.priority)] > 0) --stats_.stretchedTasks;
+    tracked_.erase(it);
+}
+
+LoadGovernor::Stats LoadGovernor::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+void LoadGovernor::evaluate() {
+    const auto lag = scheduler_->takeDispatchLag();
+    const size_t pending = pool_->pendingTasks();
+    const size_t threads = std::max<size_t>(1, pool_->threadCount());
+    const bool overloaded = lag.maxMs >= cfg_.lagMs || pending >= threads * cfg_.queuePerThread;
+    const bool calm = lag.maxMs <= cfg_.recoverLagMs && pending < threads;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    stats_.lastMaxLagMs = lag.maxMs;
+    stats_.lastAvgLagMs = lag.avgMs;
+    stats_.lastPending = pending;
+    const std::string load = " (派发延迟 max=" + std::to_string(lag.maxMs) + "ms avg=" + std::to_string(lag.avgMs) +
+                             "ms 积压=" + std::to_string(pending) + ")";
+
+    if (overloaded) {
+        calmChecks_ = 0;
+        for (const auto p : kSheddable) {
+            auto& level = stats_.level[static_cast<size_t>(p)];
+            if (level >= cfg_.maxLevel) continue;
+            ++level;
+            ++stats_.shedSteps;
+            applyLevel(p);
+            GLOG_WARN("负载过高，降载: " + ThreadPool::priorityToString(p) + " 分组周期 x" +
+                      std::to_string(1 << level) + load);
+            return;
+        }
+        if (!maxLogged_) {
+            GLOG_WARN("负载过高，已达最大降载级别" + load);
+            maxLogged_ = true;
+        }
+        return;
+    }
+    if (!calm || ++calmChecks_ < kRecoverChecks) {
+        if (!calm) calmChecks_ = 0;
+        return;
+    }
+    calmChecks_ = 0;
+    maxLogged_ = false;
+    for (auto it = std::rbegin(kSheddable); it != std::rend(kSheddable); ++it) {
+        auto& level = stats_.level[static_cast<size_t>(*it)];
+        if (level == 0) continue;
+        --level;
+        ++stats_.restoreSteps;
+        applyLevel(*it);
+        GLOG_INFO("负载恢复，还原: " + ThreadPool::priorityToString(*it) + " 分组周期 x" +
+                  std::to_string(1 << level) + load);
+        return;
+    }
+}
+
+void LoadGovernor::applyLevel(const TaskPriority priority) {
+    const int level = stats_.level[static_cast<size_t>(priority)];
+    size_t stretched = 0;
+    for (const auto& [handle, t] : tracked_) {
+        if (t.priority == priority) {
+            scheduler_->setInterval(handle, t.baseIntervalMs << level);
+            GLOG_DEBUG("分组周期调整: " + t.key + " -> " + std::to_string(t.baseIntervalMs << level) + "ms");
+        }
+        if (stats_.level[static_cast<size_t>(t.priority)] > 0) ++stretched;
+    }
+    stats_.stretchedTasks = stretched;
+}
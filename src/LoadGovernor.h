@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ThreadPool.h"
+#include "TimerScheduler.h"
+
+// 过载降载：周期检查调度派发延迟与线程池积压，超过阈值时逐级拉长低优先级分组的周期
+// （先 LOW 后 NORMAL，每级周期翻倍），延迟恢复后按相反顺序逐级还原；HIGH 分组不受影响
+class LoadGovernor : public std::enable_shared_from_this<LoadGovernor> {
+public:
+    struct Config {
+        uint32_t lagMs = 1000;          // 派发延迟超过该值视为过载
+        uint32_t recoverLagMs = 200;    // 派发延迟低于该值视为恢复
+        uint32_t queuePerThread = 4;    // 积压任务数超过 线程数 × 该值 视为过载
+        int maxLevel = 3;               // 每个优先级最多拉长到 2^maxLevel 倍
+        uint32_t checkIntervalMs = 1000;
+    };
+    struct Stats {
+        std::array<int, kTaskPriorityCount> level{};   // 各优先级当前降载级别
+        uint64_t shedSteps = 0;
+        uint64_t restoreSteps = 0;
+        uint32_t lastMaxLagMs = 0;
+        uint32_t lastAvgLagMs = 0;
+        size_t lastPending = 0;
+        size_t stretchedTasks = 0;                     // 当前被拉长周期的分组任务数
+    };
+
+    LoadGovernor(std::shared_ptr<ThreadPool> pool, std::shared_ptr<TimerScheduler> scheduler, const Config& cfg);
+    ~LoadGovernor();
+
+    void start();
+    // 登记可降载的周期任务；当前已处于降载状态时立即按级别拉长
+    void track(TimerScheduler::TimerHandle handle, const std::string& key, uint32_t baseIntervalMs,
+               TaskPriority priority);
+    void untrack(TimerScheduler::TimerHandle handle);
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Tracked {
+        std::string key;
+        uint32_t baseIntervalMs;
+        TaskPriority priority;
+    };
+
+    void evaluate();
+    void applyLevel(TaskPriority priority);
+
+    std::shared_ptr<ThreadPool> pool_;
+    std::shared_ptr<TimerScheduler> scheduler_;
+    Config cfg_;
+    TimerScheduler::TimerHandle timer_ = 0;
+    int calmChecks_ = 0;
+    bool maxLogged_ = false;
+
+    mutable std::mutex mtx_;
+    std::unordered_map<TimerScheduler::TimerHandle, Tracked> tracked_;
+    Stats stats_;
+};
@@ -1,8 +1,35 @@
 #include "ModbusDevice.h"
 #include <thread>
 #include <cerrno>
+#include <algorithm>
+#include <map>
 #include <utility>
 #include "Logger.h"
+#include "ModbusVariable.h"
+#include "FastClock.h"
+
+namespace {
+// 单次请求上限（Modbus 协议 PDU 限制）
+constexpr int kMaxWriteRegisters = 123;
+constexpr int kMaxWriteCoils = 1968;
+constexpr int kMaxReadRegisters = 125;
+constexpr int kMaxReadBits = 2000;
+// 本线程最近一次读请求的发出与收到响应时间，读原语写入，readShared 随数据一并返回
+thread_local AcquisitionStamp tlsStamp{};
+
+// 令牌不足时的排队依据：采集按本轮周期结束时刻，写入取当前时刻（最先放行）；未设置时默认 1 秒后
+thread_local std::chrono::steady_clock::time_point tlsDeadline{};
+
+class DeadlineScope {
+public:
+    explicit DeadlineScope(const std::chrono::steady_clock::time_point deadline) : prev_(tlsDeadline) {
+        tlsDeadline = deadline;
+    }
+    ~DeadlineScope() { tlsDeadline = prev_; }
+private:
+    std::chrono::steady_clock::time_point prev_;
+};
+}
 
 ModbusDevice::ModbusDevice(const std::string& id,
                            const std::string& name,
@@ -28,10 +55,17 @@ ModbusDevice::ModbusDevice(const std::string& id,
 {}
 
 ModbusDevice::~ModbusDevice() {
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        writerStop_ = true;
+    }
+    writeCv_.notify_all();
+    if (writerThread_.joinable()) writerThread_.join();
     disconnect();
 }
 
 bool ModbusDevice::connect() {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     if (ctx_) {
         modbus_close(ctx_);
@@ -69,6 +103,7 @@ void ModbusDevice::disconnect() {
 }
 
 bool ModbusDevice::readRegisters(const int addr, const int count, std::vector<uint16_t>& regs) {
+    throttle();
     std::unique_lock<std::mutex> lock(comm_mtx_);
     const auto now = std::chrono::steady_clock::now();
 
@@ -98,7 +133,10 @@ bool ModbusDevice::readRegisters(const int addr, const int count, std::vector<ui
         failCount_ = 0;
     }
     regs.resize(count);
-    if (const int rc = modbus_read_registers(ctx_, addr, count, regs.data()); rc == count) {
+    tlsStamp.requestSent = FastClock::now();
+    const int rc = modbus_read_registers(ctx_, addr, count, regs.data());
+    tlsStamp.responseReceived = FastClock::now();
+    if (rc == count) {
         if (!online_) {
             GLOG_INFO(logPrefix() + "通信恢复正常！");
             online_ = true;
@@ -130,9 +168,13 @@ bool ModbusDevice::readRegisters(const int addr, const int count, std::vector<ui
 }
 
 bool ModbusDevice::readInputRegisters(const int addr, const int count, std::vector<uint16_t>& regs) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     regs.resize(count);
-    if (const int rc = modbus_read_input_registers(ctx_, addr, count, regs.data()); rc == count) {
+    tlsStamp.requestSent = FastClock::now();
+    const int rc = modbus_read_input_registers(ctx_, addr, count, regs.data());
+    tlsStamp.responseReceived = FastClock::now();
+    if (rc == count) {
         lastError_.clear();
         return true;
     } else {
@@ -142,9 +184,13 @@ bool ModbusDevice::readInputRegisters(const int addr, const int count, std::vect
 }
 
 bool ModbusDevice::readCoils(const int addr, const int count, std::vector<uint8_t>& coils) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     coils.resize(count);
-    if (const int rc = modbus_read_bits(ctx_, addr, count, coils.data()); rc == count) {
+    tlsStamp.requestSent = FastClock::now();
+    const int rc = modbus_read_bits(ctx_, addr, count, coils.data());
+    tlsStamp.responseReceived = FastClock::now();
+    if (rc == count) {
         lastError_.clear();
         return true;
     } else {
@@ -154,9 +200,13 @@ bool ModbusDevice::readCoils(const int addr, const int count, std::vector<uint8_
 }
 
 bool ModbusDevice::readDiscreteInputs(const int addr, const int count, std::vector<uint8_t>& inputs) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     inputs.resize(count);
-    if (const int rc = modbus_read_input_bits(ctx_, addr, count, inputs.data()); rc == count) {
+    tlsStamp.requestSent = FastClock::now();
+    const int rc = modbus_read_input_bits(ctx_, addr, count, inputs.data());
+    tlsStamp.responseReceived = FastClock::now();
+    if (rc == count) {
         lastError_.clear();
         return true;
     } else {
@@ -166,6 +216,7 @@ bool ModbusDevice::readDiscreteInputs(const int addr, const int count, std::vect
 }
 
 bool ModbusDevice::writeSingleRegister(const int addr, const uint16_t value) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     int rc = modbus_write_register(ctx_, addr, value);
     if (rc == 1) {
@@ -178,6 +229,7 @@ bool ModbusDevice::writeSingleRegister(const int addr, const uint16_t value) {
 }
 
 bool ModbusDevice::writeMultipleRegisters(const int addr, const std::vector<uint16_t>& values) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     if (const int rc = modbus_write_registers(ctx_, addr, static_cast<int>(values.size()), values.data()); rc == values.size()) {
         lastError_.clear();
@@ -189,6 +241,7 @@ bool ModbusDevice::writeMultipleRegisters(const int addr, const std::vector<uint
 }
 
 bool ModbusDevice::writeSingleCoil(const int addr, const bool on) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     if (const int rc = modbus_write_bit(ctx_, addr, on ? 1 : 0); rc == 1) {
         lastError_.clear();
@@ -200,6 +253,7 @@ bool ModbusDevice::writeSingleCoil(const int addr, const bool on) {
 }
 
 bool ModbusDevice::writeMultipleCoils(const int addr, const std::vector<uint8_t>& values) {
+    throttle();
     std::lock_guard<std::mutex> lock(comm_mtx_);
     if (const int rc = modbus_write_bits(ctx_, addr, static_cast<int>(values.size()), values.data()); rc == values.size()) {
         lastError_.clear();
@@ -210,6 +264,316 @@ bool ModbusDevice::writeMultipleCoils(const int addr, const std::vector<uint8_t>
     }
 }
 
+int ModbusDevice::maxReadCount(const Area area) {
+    return area == Area::Coil || area == Area::DiscreteInput ? kMaxReadBits : kMaxReadRegisters;
+}
+
+bool ModbusDevice::readArea(const Area area, const int addr, const int count, std::vector<uint16_t>& out) {
+    std::vector<uint8_t> bits;
+    bool ok = false;
+    switch (area) {
+        case Area::Coil:            ok = readCoils(addr, count, bits); break;
+        case Area::DiscreteInput:   ok = readDiscreteInputs(addr, count, bits); break;
+        case Area::InputRegister:   return readInputRegisters(addr, count, out);
+        case Area::HoldingRegister: return readRegisters(addr, count, out);
+        default: return false;
+    }
+    if (ok) out.assign(bits.begin(), bits.end());
+    return ok;
+}
+
+void ModbusDevice::registerReadRanges(const std::string& groupId, const void* owner,
+                                      const std::vector<ReadRange>& ranges) {
+    std::lock_guard<std::mutex> lock(planMtx_);
+    groupRanges_[groupId] = {owner, ranges};
+    rebuildReadPlan();
+}
+
+void ModbusDevice::unregisterReadRanges(const std::string& groupId, const void* owner) {
+    std::lock_guard<std::mutex> lock(planMtx_);
+    const auto it = groupRanges_.find(groupId);
+    // 热加载替换分组时新分组可能已用同一 id 登记，只删除自己登记的范围
+    if (it == groupRanges_.end() || it->second.owner != owner) return;
+    groupRanges_.erase(it);
+    rebuildReadPlan();
+}
+
+void ModbusDevice::rebuildReadPlan() {
+    std::vector<ReadRange> all;
+    for (const auto& [id, reg] : groupRanges_) all.insert(all.end(), reg.ranges.begin(), reg.ranges.end());
+    std::sort(all.begin(), all.end(), [](const ReadRange& a, const ReadRange& b) {
+        return a.area != b.area ? a.area < b.area : a.start < b.start;
+    });
+    // 与分组内规则一致：只合并重叠或紧邻的范围，单块不超过协议上限
+    mergedRanges_.clear();
+    for (const auto& r : all) {
+        if (!mergedRanges_.empty()) {
+            auto& last = mergedRanges_.back();
+            const int end = std::max(last.start + last.count, r.start + r.count);
+            if (last.area == r.area && r.start <= last.start + last.count && end - last.start <= maxReadCount(r.area)) {
+                last.count = end - last.start;
+                continue;
+            }
+        }
+        mergedRanges_.push_back(r);
+    }
+    readCache_.clear();
+    splitRanges_.clear();
+    GLOG_INFO(logPrefix() + "读取计划: 分组=" + std::to_string(groupRanges_.size()) +
+              " 范围=" + std::to_string(all.size()) + " 合并后=" + std::to_string(mergedRanges_.size()));
+}
+
+AcquisitionStamp ModbusDevice::lastReadStamp() {
+    return tlsStamp;
+}
+
+bool ModbusDevice::readShared(const Area area, const int addr, const int count, const uint32_t maxAgeMs,
+                              std::vector<uint16_t>& out, AcquisitionStamp& stamp) {
+    const auto covers = [&](const ReadRange& r) {
+        return r.area == area && r.start <= addr && addr + count <= r.start + r.count;
+    };
+    const auto sameRange = [](const ReadRange& a, const ReadRange& b) {
+        return a.area == b.area && a.start == b.start && a.count == b.count;
+    };
+    // 锁只保护查缓存与计划；物理读与限流等待在锁外进行。覆盖本范围的块正在被其他分组读取时
+    // 等它的结果，同时到期的分组仍只发一次请求
+    std::unique_lock<std::mutex> lock(planMtx_);
+    ReadRange target{area, addr, count};
+    auto now = std::chrono::steady_clock::now();
+    for (;;) {
+        now = std::chrono::steady_clock::now();
+        const auto maxAge = std::chrono::milliseconds(std::min<uint32_t>(maxAgeMs, readShareWindowMs_));
+        for (const auto& block : readCache_) {
+            if (now - block.readAt <= maxAge && covers(block.range)) {
+                const auto first = block.words.begin() + (addr - block.range.start);
+                out.assign(first, first + count);
+                stamp = block.stamp;
+                ++readStats_.sharedHits;
+                return true;
+            }
+        }
+        target = {area, addr, count};
+        if (readShareWindowMs_ > 0) {
+            for (const auto& r : mergedRanges_) {
+                if (!covers(r)) continue;
+                // 合并块曾因异常响应读失败（如跨越了不存在的地址）时改按分组自身范围读
+                if (std::none_of(splitRanges_.begin(), splitRanges_.end(),
+                                 [&](const ReadRange& s) { return sameRange(s, r); })) target = r;
+                break;
+            }
+        }
+        if (std::none_of(inFlight_.begin(), inFlight_.end(), [&](const ReadRange& r) { return covers(r); })) break;
+        readDoneCv_.wait(lock);
+    }
+    inFlight_.push_back(target);
+    ++readStats_.physicalReads;
+    lock.unlock();
+
+    std::vector<uint16_t> words;
+    bool ok;
+    bool split = false;
+    {
+        DeadlineScope deadline(now + 2 * std::chrono::milliseconds(maxAgeMs));
+        ok = readArea(target.area, target.start, target.count, words);
+        if (!ok && !sameRange(target, ReadRange{area, addr, count}) && isConnected()) {
+            // 合并块失败而连接仍在：多为块内含 PLC 未实现的地址，按本分组范围重读
+            ok = readArea(area, addr, count, words);
+            split = ok;
+        }
+    }
+    if (ok) stamp = tlsStamp;
+
+    lock.lock();
+    inFlight_.erase(std::find_if(inFlight_.begin(), inFlight_.end(), [&](const ReadRange& r) { return sameRange(r, target); }));
+    readDoneCv_.notify_all();
+    if (split) {
+        ++readStats_.physicalReads;
+        splitRanges_.push_back(target);
+        GLOG_WARN(logPrefix() + "合并读块 起始=" + std::to_string(target.start) + " 数量=" + std::to_string(target.count) +
+                  " 读取失败，改为按分组范围分别读取");
+        target = {area, addr, count};
+    }
+    if (!ok) return false;
+
+    const auto first = words.begin() + (addr - target.start);
+    out.assign(first, first + count);
+    if (readShareWindowMs_ > 0) {
+        readCache_.erase(std::remove_if(readCache_.begin(), readCache_.end(), [&](const CachedBlock& b) {
+            return now - b.readAt > std::chrono::milliseconds(readShareWindowMs_) ||
+                   (b.range.area == target.area && b.range.start == target.start);
+        }), readCache_.end());
+        readCache_.push_back({target, std::move(words), now, stamp});
+    }
+    return true;
+}
+
+ModbusDevice::ReadStats ModbusDevice::getReadStats() const {
+    std::lock_guard<std::mutex> lock(planMtx_);
+    return readStats_;
+}
+
+void ModbusDevice::writeVariable(const std::shared_ptr<Variable>& var, const Variable::ValueType& value,
+                                 const WriteCallback& cb) {
+    const auto mbVar = std::dynamic_pointer_cast<ModbusVariable>(var);
+    if (!mbVar) {
+        if (cb) cb(false, "变量类型错误");
+        return;
+    }
+    const int address = mbVar->addressAsInt();
+    const auto area = ModbusGroup::guessAreaFromAddress(address);
+    PendingWrite w{area == ModbusGroup::ModbusRegisterArea::Coil, ModbusGroup::stripAreaPrefix(address), {}, cb};
+    if (area != ModbusGroup::ModbusRegisterArea::Coil && area != ModbusGroup::ModbusRegisterArea::HoldingRegister) {
+        if (cb) cb(false, "地址[" + std::to_string(address) + "] 不可写");
+        return;
+    }
+    try {
+        if (w.coil) {
+            bool on = false;
+            std::visit([&on](auto&& v) {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, std::string>) on = v == "true" || v == "1";
+                else on = v != T{};
+            }, value);
+            w.words.push_back(on ? 1 : 0);
+        } else {
+            w.words = mbVar->encodeValue(value);
+        }
+    } catch (const std::exception& ex) {
+        if (cb) cb(false, ex.what());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        if (writerStop_) {
+            if (cb) cb(false, "设备已停止");
+            return;
+        }
+        pendingWrites_.push_back(std::move(w));
+        // 写线程按需创建，只读设备不占线程
+        if (!writerThread_.joinable()) writerThread_ = std::thread(&ModbusDevice::writerLoop, this);
+    }
+    writeCv_.notify_one();
+}
+
+void ModbusDevice::yieldToWrites() const {
+    while (writerActive_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void ModbusDevice::writerLoop() {
+    std::unique_lock<std::mutex> lock(writeMtx_);
+    while (true) {
+        writeCv_.wait(lock, [this] { return writerStop_ || !pendingWrites_.empty(); });
+        if (writerStop_) break;
+        // 合并窗口：等待短时间收集后续写请求
+        if (writeCoalesceMs_ > 0) {
+            writeCv_.wait_for(lock, std::chrono::milliseconds(writeCoalesceMs_), [this] { return writerStop_; });
+            if (writerStop_) break;
+        }
+        std::vector<PendingWrite> batch;
+        batch.swap(pendingWrites_);
+        lock.unlock();
+        writerActive_.store(true, std::memory_order_release);
+        flushWrites(batch);
+        writerActive_.store(false, std::memory_order_release);
+        lock.lock();
+    }
+    for (const auto& w : pendingWrites_) {
+        if (w.cb) w.cb(false, "设备已停止");
+    }
+    pendingWrites_.clear();
+}
+
+void ModbusDevice::flushWrites(std::vector<PendingWrite>& batch) {
+    DeadlineScope deadline(std::chrono::steady_clock::now());
+    // 按到达顺序展开到地址表，同一地址后写覆盖先写
+    std::map<int, uint16_t> regs, coils;
+    for (const auto& w : batch) {
+        auto& table = w.coil ? coils : regs;
+        for (size_t k = 0; k < w.words.size(); ++k) table[w.addr + static_cast<int>(k)] = w.words[k];
+    }
+
+    // 连续地址合并为一次请求，记录每个地址所在请求的结果
+    std::map<int, bool> regOk, coilOk;
+    size_t requests = 0;
+    std::string error = "设备未连接";
+    auto runAll = [&](const std::map<int, uint16_t>& table, std::map<int, bool>& result, const bool coil) {
+        const int maxRun = coil ? kMaxWriteCoils : kMaxWriteRegisters;
+        for (auto it = table.begin(); it != table.end();) {
+            const int start = it->first;
+            std::vector<uint16_t> words;
+            auto runEnd = it;
+            while (runEnd != table.end() && runEnd->first == start + static_cast<int>(words.size()) &&
+                   static_cast<int>(words.size()) < maxRun) {
+                words.push_back(runEnd->second);
+                ++runEnd;
+            }
+            bool ok;
+            if (coil) {
+                if (words.size() == 1) ok = writeSingleCoil(start, words[0] != 0);
+                else ok = writeMultipleCoils(start, std::vector<uint8_t>(words.begin(), words.end()));
+            } else {
+                if (words.size() == 1) ok = writeSingleRegister(start, words[0]);
+                else ok = writeMultipleRegisters(start, words);
+            }
+            ++requests;
+            if (!ok) error = getLastError();
+            for (; it != runEnd; ++it) result[it->first] = ok;
+        }
+    };
+    if (reconnectForWrite()) {
+        runAll(regs, regOk, false);
+        runAll(coils, coilOk, true);
+    } else {
+        error = getLastError();
+    }
+
+    {
+        // 写入后作废共享读缓存，下一次采集读回新值
+        std::lock_guard<std::mutex> lock(planMtx_);
+        readCache_.clear();
+    }
+
+    size_t failed = 0;
+    for (const auto& w : batch) {
+        const auto& result = w.coil ? coilOk : regOk;
+        bool ok = true;
+        for (size_t k = 0; k < w.words.size() && ok; ++k) {
+            const auto it = result.find(w.addr + static_cast<int>(k));
+            ok = it != result.end() && it->second;
+        }
+        if (!ok) ++failed;
+        if (w.cb) w.cb(ok, ok ? std::string() : error);
+    }
+    GLOG_DEBUG(logPrefix() + "写入 " + std::to_string(batch.size()) + " 项，合并为 " +
+               std::to_string(requests) + " 次请求，失败 " + std::to_string(failed));
+}
+
+bool ModbusDevice::reconnectForWrite() {
+    {
+        std::lock_guard<std::mutex> lock(comm_mtx_);
+        if (ctx_ && online_) return true;
+        if (reconnecting_) {
+            lastError_ = "设备未连接，正在重连";
+            return false;
+        }
+        reconnecting_ = true;
+    }
+    GLOG_INFO(logPrefix() + "设备未连接，写入前尝试重连");
+    const bool ok = connect();
+    std::lock_guard<std::mutex> lock(comm_mtx_);
+    reconnecting_ = false;
+    if (ok) {
+        failCount_ = 0;
+    } else {
+        online_ = false;
+        lastFailTime_ = std::chrono::steady_clock::now();
+        lastError_ = "设备未连接，重连失败: " + lastError_;
+    }
+    return ok;
+}
+
 bool ModbusDevice::isConnected() const {
     std::lock_guard<std::mutex> lock(comm_mtx_);
     return ctx_ != nullptr && online_;
@@ -233,6 +597,31 @@ std::string ModbusDevice::getLastError() const {
     return lastError_;
 }
 
+void ModbusDevice::setRateLimit(const int ratePerSec, const int burst) {
+    if (ratePerSec <= 0) {
+        limiter_.reset();
+        return;
+    }
+    const uint32_t cap = burst > 0 ? burst : ratePerSec;
+    bool updated = false;
+    limiter_ = RateLimiter::shared(ip_ + ":" + std::to_string(port_), ratePerSec, cap, &updated);
+    if (updated) {
+        GLOG_WARN(logPrefix() + "更新同一连接上共享的令牌桶: " + std::to_string(ratePerSec) + " 次/秒，突发 " +
+                  std::to_string(cap) + "，与该连接上其他设备的配置不一致时以最后加载的为准");
+    }
+}
+
+RateLimiter::Stats ModbusDevice::getRateLimitStats() const {
+    return limiter_ ? limiter_->getStats() : RateLimiter::Stats{};
+}
+
+void ModbusDevice::throttle() const {
+    if (!limiter_) return;
+    const auto deadline = tlsDeadline != std::chrono::steady_clock::time_point{}
+        ? tlsDeadline : std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    limiter_->acquire(deadline);
+}
+
 std::string ModbusDevice::logPrefix() const {
     return "Modbus[" + name_ + "] ";
 }
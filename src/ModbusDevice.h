@@ -5,11 +5,29 @@
 #include <vector>
 #include <chrono>
 #include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <map>
+#include <unordered_map>
 #include "Device.h"
+#include "ModbusGroup.h"
+#include "RateLimiter.h"
+#include "FastClock.h"
 
 
 class ModbusDevice final : public Device {
 public:
+    using Area = ModbusGroup::ModbusRegisterArea;
+    struct ReadRange {
+        Area area;
+        int start;
+        int count;
+    };
+    struct ReadStats {
+        uint64_t physicalReads = 0;   // 实际发往 PLC 的读请求
+        uint64_t sharedHits = 0;      // 由其他分组的读结果满足的请求
+    };
+
     ModbusDevice(const std::string& id,
                  const std::string& name,
                  std::string  ip,
@@ -36,6 +54,33 @@ public:
     bool writeSingleCoil(int addr, bool on);
     bool writeMultipleCoils(int addr, const std::vector<uint8_t>& values);
 
+    // 跨分组读合并：各分组登记自己的读范围，设备把所有分组的重叠/紧邻范围合并为物理读块。
+    // readShared 命中 maxAgeMs 内已读过的块时直接返回缓存，否则读取覆盖该范围的整块；
+    // 整块读失败（异常响应）时改按请求范围读取，此后该块不再合并，直到计划重建
+    void registerReadRanges(const std::string& groupId, const void* owner, const std::vector<ReadRange>& ranges);
+    // 分组移除时注销；owner 与登记时不同（同 id 的新分组已重新登记）时忽略
+    void unregisterReadRanges(const std::string& groupId, const void* owner);
+    // stamp 返回数据的采集时间；命中缓存时为原始那次读的时间
+    bool readShared(Area area, int addr, int count, uint32_t maxAgeMs, std::vector<uint16_t>& out,
+                    AcquisitionStamp& stamp);
+    // 当前线程最近一次读原语的请求发出/响应收到时间
+    static AcquisitionStamp lastReadStamp();
+    void setReadShareWindow(const int ms) { readShareWindowMs_ = ms > 0 ? ms : 0; }
+    [[nodiscard]] ReadStats getReadStats() const;
+    static int maxReadCount(Area area);
+
+    // 写入管线：按变量地址排队，合并窗口内的相邻地址合并为一次多寄存器/多线圈写
+    void writeVariable(const std::shared_ptr<Variable>& var, const Variable::ValueType& value,
+                       const WriteCallback& cb) override;
+    void setWriteCoalesceWindow(const int ms) { writeCoalesceMs_ = ms > 0 ? ms : 0; }
+    // 采集循环在每次读之前调用：有写请求等待时让出通信，保证写入延迟有上界
+    void yieldToWrites() const;
+
+    // 请求限流：读、写、重连都先取令牌；同一 ip:port 的设备共用一个令牌桶
+    void setRateLimit(int ratePerSec, int burst);
+    [[nodiscard]] bool hasRateLimit() const { return limiter_ != nullptr; }
+    [[nodiscard]] RateLimiter::Stats getRateLimitStats() const;
+
     bool isConnected() const;
     bool isOnline()    const;
     std::string getStatusString() const;
@@ -49,7 +94,28 @@ public:
     void setFailThreshold(const int n)      { failThreshold_      = n;  }
 
 private:
+    struct PendingWrite {
+        bool coil;
+        int addr;                      // 去掉区号后的协议地址
+        std::vector<uint16_t> words;   // 线圈时每个元素为 0/1
+        WriteCallback cb;
+    };
+
+    struct CachedBlock {
+        ReadRange range;
+        std::vector<uint16_t> words;
+        std::chrono::steady_clock::time_point readAt;
+        AcquisitionStamp stamp;
+    };
+
     std::string logPrefix() const;
+    void throttle() const;
+    bool readArea(Area area, int addr, int count, std::vector<uint16_t>& out);
+    void rebuildReadPlan();
+    void writerLoop();
+    void flushWrites(std::vector<PendingWrite>& batch);
+    // 写入前设备未连接时立即尝试重连一次（不受采集的重连间隔限制），采集线程正在重连时不重复发起
+    bool reconnectForWrite();
 
     modbus_t* ctx_;
     mutable std::mutex comm_mtx_;
@@ -66,4 +132,29 @@ private:
     int failThreshold_;
     int reconnectIntervalMs_;
     std::string lastError_;
+
+    std::mutex writeMtx_;
+    std::condition_variable writeCv_;
+    std::vector<PendingWrite> pendingWrites_;
+    std::thread writerThread_;
+    bool writerStop_ = false;
+    std::atomic<bool> writerActive_{false};
+    int writeCoalesceMs_ = 5;
+
+    struct GroupRanges {
+        const void* owner;
+        std::vector<ReadRange> ranges;
+    };
+
+    mutable std::mutex planMtx_;
+    std::condition_variable readDoneCv_;
+    std::unordered_map<std::string, GroupRanges> groupRanges_;
+    std::vector<ReadRange> mergedRanges_;
+    std::vector<ReadRange> splitRanges_;   // 整块读失败、改为分别读取的合并块
+    std::vector<ReadRange> inFlight_;      // 正在读取的块
+    std::vector<CachedBlock> readCache_;
+    int readShareWindowMs_ = 200;
+    ReadStats readStats_;
+
+    std::shared_ptr<RateLimiter> limiter_;
 };
@@ -1,8 +1,8 @@
 #include "ModbusGroup.h"
 #include "ModbusDevice.h"
 #include "ModbusVariable.h"
-#include "DataBuffer.h"
 #include "Logger.h"
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <string>
@@ -10,6 +10,118 @@
 #include <iomanip>
 #include <sstream>
 #include "DeviceManager.h"
+
+namespace {
+
+void logValue(const std::string& groupId, const ModbusVariable& var) {
+    std::string valueStr;
+    const auto& value = var.getValue();
+    std::visit([&](auto&& vv){
+        using T = std::decay_t<decltype(vv)>;
+        if constexpr (std::is_same_v<T, std::string>)
+            valueStr = vv;
+        else if constexpr (std::is_same_v<T, bool>)
+            valueStr = vv ? "true" : "false";
+        else
+            valueStr = std::to_string(vv);
+    }, value);
+
+    auto tp = var.getTimestamp();
+    std::time_t t = std::chrono::system_clock::to_time_t(tp);
+    std::tm tm{};
+    localtime_s(&tm, &t);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+
+    std::string qualityStr;
+    switch (var.getQuality()) {
+        case VarQuality::GOOD: qualityStr = "GOOD"; break;
+        case VarQuality::BAD: qualityStr = "BAD"; break;
+        case VarQuality::UNCERTAIN: qualityStr = "UNCERTAIN"; break;
+        default: qualityStr = "?"; break;
+    }
+
+    std::ostringstream msg;
+    msg << "ModbusGroup[" << groupId << "] 变量[" << var.getVarid() << "] = "
+        << valueStr << " [Time=" << oss.str() << ", Quality=" << qualityStr << "]";
+    GLOG_DEBUG(msg.str());
+}
+
+double toDouble(const Variable::ValueType& value) {
+    return std::visit([](auto&& v) -> double {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::string>) return 0;
+        else return static_cast<double>(v);
+    }, value);
+}
+
+} // namespace
+
+void ModbusGroup::setTrigger(const int address, const uint32_t maxStaleMs) {
+    triggerAddress_ = address;
+    triggerMaxStaleMs_ = maxStaleMs;
+    triggerValid_ = false;
+}
+
+bool ModbusGroup::triggerFired(ModbusDevice* device) {
+    if (triggerAddress_ < 0) return true;
+    const auto now = std::chrono::steady_clock::now();
+    const int realAddress = stripAreaPrefix(triggerAddress_);
+    bool ok = false;
+    uint16_t value = 0;
+    std::vector<uint16_t> regs;
+    std::vector<uint8_t> bits;
+    switch (guessAreaFromAddress(triggerAddress_)) {
+        case ModbusRegisterArea::Coil:
+            ok = device->readCoils(realAddress, 1, bits);
+            if (ok) value = bits[0];
+            break;
+        case ModbusRegisterArea::DiscreteInput:
+            ok = device->readDiscreteInputs(realAddress, 1, bits);
+            if (ok) value = bits[0];
+            break;
+        case ModbusRegisterArea::InputRegister:
+            ok = device->readInputRegisters(realAddress, 1, regs);
+            if (ok) value = regs[0];
+            break;
+        case ModbusRegisterArea::HoldingRegister:
+            ok = device->readRegisters(realAddress, 1, regs);
+            if (ok) value = regs[0];
+            break;
+        default:
+            break;
+    }
+    // 触发寄存器读失败时退回整组读取，由逐项读取的失败路径置 BAD
+    if (!ok) {
+        triggerValid_ = false;
+        triggerPending_ = false;
+        return true;
+    }
+    const bool stale = now - lastFullRead_ >= std::chrono::milliseconds(triggerMaxStaleMs_);
+    if (triggerValid_ && value == lastTrigger_ && !stale) {
+        ++triggerSkips_;
+        return false;
+    }
+    GLOG_DEBUG("ModbusGroup[" + getId() + "] 触发寄存器=" + std::to_string(value) +
+               (stale && triggerValid_ && value == lastTrigger_ ? "（超过最大陈旧时间）" : "") +
+               "，整组读取，此前跳过 " + std::to_string(triggerSkips_) + " 次");
+    triggerSkips_ = 0;
+    // 整组读取全部成功后才记为已处理（见 commitTrigger），读失败时下周期仍按变化重读
+    pendingTrigger_ = value;
+    pendingTriggerAt_ = now;
+    triggerPending_ = true;
+    return true;
+}
+
+void ModbusGroup::commitTrigger() {
+    if (!triggerPending_) return;
+    triggerPending_ = false;
+    if (!planOk_) return;
+    lastTrigger_ = pendingTrigger_;
+    triggerValid_ = true;
+    lastFullRead_ = pendingTriggerAt_;
+}
+
 void ModbusGroup::pollVariablesImpl(const std::shared_ptr<Device> &dev) {
     auto device = std::dynamic_pointer_cast<ModbusDevice>(dev);
     if (!device) {
@@ -21,88 +133,181 @@ void ModbusGroup::pollVariablesImpl(const std::shared_ptr<Device> &dev) {
         GLOG_ERROR("ModbusGroup[" + getId() + "] 设备类型错误！");
         return;
     }
+    // 续读上周期让出的剩余读取时不再检查触发寄存器
+    if (resumeRead_ == 0 && !triggerFired(modbusDevice)) return;
 
+    if (plannedFor_ != getVariables().size()) {
+        device_ = device;
+        resetPlans(modbusDevice);
+        resumeRead_ = 0;
+    }
+    // 触发寄存器分组在触发时整组读取，不做分频
+    const size_t first = resumeRead_;
+    if (first == 0) planOk_ = true;
+    const uint32_t mask = first > 0 ? resumeMask_ : triggerAddress_ >= 0 ? allDueMask_ : dueMask(cycle_);
+    resumeRead_ = 0;
+    auto planIt = plans_.find(mask);
+    if (planIt == plans_.end()) planIt = plans_.emplace(mask, buildPlan(mask)).first;
+    // 共享读的最大数据年龄不超过本组周期的一半，保证本组看到的值不早于上一周期
+    const uint32_t maxAgeMs = intervalMs_ / 2;
+    AcquisitionStamp stamp;
+    const auto& reads = planIt->second;
+    for (size_t r = first; r < reads.size(); ++r) {
+        // 同设备有更高优先级的采集进行中：让出设备并结束本周期，剩余读取下周期继续。
+        // 每周期至少完成一次读取，高优先级持续繁忙时低优先级仍能推进
+        if (r > first && modbusDevice->higherPriorityActive(priority_)) {
+            resumeRead_ = r;
+            resumeMask_ = mask;
+            break;
+        }
+        const auto& read = reads[r];
+        modbusDevice->yieldToWrites();
+        const bool ok = modbusDevice->readShared(read.area, read.start, read.count, maxAgeMs, words_, stamp);
+        planOk_ = planOk_ && ok;
+        const bool bitArea = read.area == ModbusRegisterArea::Coil || read.area == ModbusRegisterArea::DiscreteInput;
+        // 同一响应的变量共用一个采集时间；失败时也只取一次时间
+        const auto ts = ok ? stamp.acquired() : FastClock::now();
+        for (const auto& [mbVar, offset] : read.vars) {
+            if (ok) {
+                const auto wordIt = words_.begin() + offset;
+                const auto wordEnd = wordIt + mbVar->registerCount();
+                // 有换算的变量只解码暂存，整组读完后批量换算
+                if (const int32_t slot = mbVar->scaleSlot(); slot >= 0 && !bitArea) {
+                    regScratch_.assign(wordIt, wordEnd);
+                    scale_.raw(slot) = toDouble(mbVar->decodeValue(regScratch_));
+                    scaleTs_[slot] = ts;
+                    scalePending_.push_back(static_cast<uint32_t>(slot));
+                    continue;
+                }
+                if (bitArea) {
+                    bitScratch_.assign(wordIt, wordEnd);
+                    mbVar->setRawBits(bitScratch_, ts);
+                } else {
+                    regScratch_.assign(wordIt, wordEnd);
+                    mbVar->setRawValue(regScratch_, ts);
+                }
+                logValue(getId(), *mbVar);
+            } else {
+                mbVar->setQuality(VarQuality::BAD, ts);
+                GLOG_DEBUG("ModbusGroup[" + getId() + "] 变量[" + mbVar->getVarid() + "] 采集失败，已置BAD");
+            }
+        }
+    }
+    if (!scalePending_.empty()) publishScaled();
+    if (resumeRead_ == 0) commitTrigger();
+}
+
+void ModbusGroup::retire() {
+    if (const auto device = device_.lock()) device->unregisterReadRanges(getId(), this);
+}
+
+void ModbusGroup::resetScaling() {
+    scale_.clear();
+    scaleVars_.clear();
+    scalePending_.clear();
     for (const auto& v : getVariables()) {
-        auto mbVar = std::dynamic_pointer_cast<ModbusVariable>(v);
+        auto* mbVar = dynamic_cast<ModbusVariable*>(v.get());
+        if (!mbVar) continue;
+        if (!mbVar->isScaled()) {
+            mbVar->setScaleSlot(-1);
+            continue;
+        }
+        mbVar->setScaleSlot(static_cast<int32_t>(scale_.add(mbVar->getScaling())));
+        scaleVars_.push_back(mbVar);
+    }
+    scaleTs_.assign(scaleVars_.size(), {});
+}
+
+void ModbusGroup::publishScaled() {
+    // 整组一次换算；本周期未到期的条目也参与计算，换取无分支的连续循环，结果不发布
+    scale_.apply();
+    for (const uint32_t slot : scalePending_) {
+        auto* mbVar = scaleVars_[slot];
+        mbVar->setValue(scale_.value(slot), scale_.outOfRange(slot) ? VarQuality::UNCERTAIN : VarQuality::GOOD,
+                        scaleTs_[slot]);
+        logValue(getId(), *mbVar);
+    }
+    scalePending_.clear();
+}
+
+uint32_t ModbusGroup::dueMask(const uint64_t cycle) const {
+    uint32_t mask = 0;
+    for (size_t k = 0; k < divisors_.size(); ++k) {
+        if (cycle % divisors_[k] == 0) mask |= 1u << k;
+    }
+    return mask;
+}
+
+void ModbusGroup::resetPlans(ModbusDevice* device) {
+    divisors_.clear();
+    plans_.clear();
+    for (size_t i = 0; i < getVariables().size(); ++i) {
+        const uint32_t d = getRateDivisor(i);
+        if (std::find(divisors_.begin(), divisors_.end(), d) == divisors_.end()) divisors_.push_back(d);
+    }
+    // 分频种类过多时合并到最快的一档，掩码只有 32 位
+    if (divisors_.size() > 32) {
+        GLOG_WARN("ModbusGroup[" + getId() + "] 变量周期种类超过 32 个，全部按分组周期采集");
+        divisors_.assign(1, 1);
+    }
+    allDueMask_ = divisors_.size() >= 32 ? 0xFFFFFFFFu : (1u << divisors_.size()) - 1;
+    plannedFor_ = getVariables().size();
+    resetScaling();
+
+    // 以全量计划登记到设备，各子周期的读范围都落在全量范围之内
+    const auto full = buildPlan(allDueMask_);
+    std::vector<ModbusDevice::ReadRange> ranges;
+    ranges.reserve(full.size());
+    for (const auto& r : full) ranges.push_back({r.area, r.start, r.count});
+    device->registerReadRanges(getId(), this, ranges);
+    GLOG_INFO("ModbusGroup[" + getId() + "] 读取计划: 变量=" + std::to_string(getVariables().size()) +
+              " 请求=" + std::to_string(full.size()) + " 分频种类=" + std::to_string(divisors_.size()) +
+              " 换算=" + std::to_string(scaleVars_.size()));
+    plans_.emplace(allDueMask_, full);
+}
+
+std::vector<ModbusGroup::PlannedRead> ModbusGroup::buildPlan(const uint32_t mask) const {
+    struct Item {
+        ModbusRegisterArea area;
+        int start;
+        int count;
+        std::shared_ptr<ModbusVariable> var;
+    };
+    std::vector<Item> items;
+    const auto& vars = getVariables();
+    for (size_t i = 0; i < vars.size(); ++i) {
+        auto mbVar = std::dynamic_pointer_cast<ModbusVariable>(vars[i]);
         if (!mbVar) continue;
+        const uint32_t d = getRateDivisor(i);
+        const auto k = static_cast<size_t>(std::find(divisors_.begin(), divisors_.end(), d) - divisors_.begin());
+        if (k < divisors_.size() && !(mask & (1u << k))) continue;
         const int address = mbVar->addressAsInt();
-        const int regCount = mbVar->registerCount();
-        ModbusRegisterArea area = guessAreaFromAddress(address);
-        const int realAddress=stripAreaPrefix(address);
-        bool ok = false;
-        std::vector<uint16_t> regs;
-        std::vector<uint8_t>  bits;
-
-        switch (area) {
-            case ModbusRegisterArea::Coil:
-                ok = modbusDevice->readCoils(realAddress, regCount, bits);
-                if (ok) mbVar->setRawBits(bits); // 你要实现 setRawBits 支持 bool
-                break;
-            case ModbusRegisterArea::DiscreteInput:
-                ok = modbusDevice->readDiscreteInputs(realAddress, regCount, bits);
-                if (ok) mbVar->setRawBits(bits);
-                break;
-            case ModbusRegisterArea::InputRegister:
-                ok = modbusDevice->readInputRegisters(realAddress, regCount, regs);
-                if (ok) mbVar->setRawValue(regs);
-                break;
-            case ModbusRegisterArea::HoldingRegister:
-                ok = modbusDevice->readRegisters(realAddress, regCount, regs);
-                if (ok) mbVar->setRawValue(regs);
-                break;
-            default:
+        const auto area = guessAreaFromAddress(address);
+        if (area == ModbusRegisterArea::Unknown) {
+            if (mask == allDueMask_)
                 GLOG_ERROR("ModbusGroup[" + getId() + "] 变量[" + mbVar->getVarid() + "] 地址[" + std::to_string(address) + "] 未识别寄存器区，跳过！");
-                continue;
+            continue;
         }
+        items.push_back({area, stripAreaPrefix(address), mbVar->registerCount(), mbVar});
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        return a.area != b.area ? a.area < b.area : a.start < b.start;
+    });
 
-        if (ok) {
-            mbVar->setQuality(VarQuality::GOOD);
-            std::string valueStr;
-            const auto& value = mbVar->getValue();
-            std::visit([&](auto&& vv){
-                using T = std::decay_t<decltype(vv)>;
-                if constexpr (std::is_same_v<T, std::string>)
-                    valueStr = vv;
-                else if constexpr (std::is_same_v<T, bool>)
-                    valueStr = vv ? "true" : "false";
-                else
-                    valueStr = std::to_string(vv);
-            }, value);
-
-            auto tp = mbVar->getTimestamp();
-            std::time_t t = std::chrono::system_clock::to_time_t(tp);
-            std::tm tm{};
-            localtime_s(&tm, &t);
-            std::ostringstream oss;
-            oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-
-            std::string qualityStr;
-            switch (mbVar->getQuality()) {
-                case VarQuality::GOOD: qualityStr = "GOOD"; break;
-                case VarQuality::BAD: qualityStr = "BAD"; break;
-                case VarQuality::UNCERTAIN: qualityStr = "UNCERTAIN"; break;
-                default: qualityStr = "?"; break;
+    // 同区内重叠或紧邻的地址合并为一次读；不跨空洞，避免读到 PLC 未映射的地址
+    std::vector<PlannedRead> plan;
+    for (const auto& it : items) {
+        const int limit = ModbusDevice::maxReadCount(it.area);
+        if (!plan.empty()) {
+            auto& last = plan.back();
+            const int end = std::max(last.start + last.count, it.start + it.count);
+            if (last.area == it.area && it.start <= last.start + last.count && end - last.start <= limit) {
+                last.count = end - last.start;
+                last.vars.emplace_back(it.var, it.start - last.start);
+                continue;
             }
-
-            std::ostringstream msg;
-            msg << "ModbusGroup[" << getId() << "] 变量[" << mbVar->getVarid() << "] = "
-                << valueStr << " [Time=" << oss.str() << ", Quality=" << qualityStr << "]";
-            GLOG_DEBUG(msg.str());
-            DataBuffer::instance().set(
-                mbVar->getVarid(),
-                mbVar->getValue(),
-                mbVar->getTimestamp(),
-                mbVar->getQuality()
-            );
-        } else {
-            mbVar->setQuality(VarQuality::BAD);
-            DataBuffer::instance().set(
-                mbVar->getVarid(),
-                mbVar->getValue(),
-                std::chrono::system_clock::now(),
-                VarQuality::BAD
-            );
-            GLOG_DEBUG("ModbusGroup[" + getId() + "] 变量[" + mbVar->getVarid() + "] 采集失败，已置BAD");
         }
+        plan.push_back({it.area, it.start, it.count, {{it.var, 0}}});
     }
+    return plan;
 }
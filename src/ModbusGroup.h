@@ -1,5 +1,15 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "Group.h"
+#include "ScaleStage.h"
+
+class ModbusDevice;
+class ModbusVariable;
 
 class ModbusGroup final : public Group {
 public:
@@ -22,4 +32,64 @@ public:
         return address % 10000;
     }
     void pollVariablesImpl(const std::shared_ptr<Device> &dev) override ;
+    // 从设备注销本分组登记的读范围
+    void retire() override;
+    // 启用触发寄存器：address 按寄存器区编址（如 40001），maxStaleMs 为强制整组读取的最长间隔
+    void setTrigger(int address, uint32_t maxStaleMs);
+
+private:
+    // 一次物理读及其覆盖的变量（变量在块内的偏移）
+    struct PlannedRead {
+        ModbusRegisterArea area;
+        int start;
+        int count;
+        std::vector<std::pair<std::shared_ptr<ModbusVariable>, int>> vars;
+    };
+
+    // 读取触发寄存器；返回 true 表示本周期需要整组读取
+    bool triggerFired(ModbusDevice* device);
+    // 整组读取结束（含让出后续读完）时调用：全部读取成功才提交本次触发值
+    void commitTrigger();
+    // 变量集合变化后重置计划，并以全量计划登记到设备供跨分组合并
+    void resetPlans(ModbusDevice* device);
+    // 把 mask 中到期的变量按区与地址合并为块读计划
+    [[nodiscard]] std::vector<PlannedRead> buildPlan(uint32_t mask) const;
+    // 第 cycle 个周期到期的分频档位掩码
+    [[nodiscard]] uint32_t dueMask(uint64_t cycle) const;
+    // 为配置了换算的变量分配换算阶段下标
+    void resetScaling();
+    // 本周期解码暂存的原始值批量换算后发布
+    void publishScaled();
+
+    // 按到期掩码缓存的读计划；分频档位有限，掩码组合数很少
+    std::unordered_map<uint32_t, std::vector<PlannedRead>> plans_;
+    std::vector<uint32_t> divisors_;   // 去重后的分频系数，下标即掩码位
+    uint32_t allDueMask_ = 1;
+    size_t plannedFor_ = static_cast<size_t>(-1);
+    // 让出给高优先级采集时未完成的读计划：下周期从 resumeRead_ 起续读 resumeMask_ 对应的计划
+    size_t resumeRead_ = 0;
+    uint32_t resumeMask_ = 0;
+    std::weak_ptr<ModbusDevice> device_;   // 登记读范围的设备
+    // 采集热路径复用的缓冲：响应数据与单个变量的寄存器/位切片，避免每周期每变量分配
+    std::vector<uint16_t> words_;
+    std::vector<uint16_t> regScratch_;
+    std::vector<uint8_t> bitScratch_;
+
+    // 工程量换算：条目与 scaleVars_ 一一对应，scalePending_ 为本周期已解码待发布的条目
+    ScaleStage scale_;
+    std::vector<ModbusVariable*> scaleVars_;
+    std::vector<std::chrono::system_clock::time_point> scaleTs_;
+    std::vector<uint32_t> scalePending_;
+
+    int triggerAddress_ = -1;
+    uint32_t triggerMaxStaleMs_ = 60000;
+    bool triggerValid_ = false;
+    uint16_t lastTrigger_ = 0;
+    std::chrono::steady_clock::time_point lastFullRead_{};
+    uint64_t triggerSkips_ = 0;
+    // 已触发、等待整组读取结果的触发值
+    bool triggerPending_ = false;
+    uint16_t pendingTrigger_ = 0;
+    std::chrono::steady_clock::time_point pendingTriggerAt_{};
+    bool planOk_ = true;               // 当前读计划（含续读部分）的读取是否全部成功
 };
@@ -1,18 +1,102 @@
 #include "ModbusVariable.h"
+#include <cmath>
 #include <cstring>
+#include <limits>
 #include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
-int ModbusVariable::addressAsInt() const {
+namespace {
+
+// 源值能否不截断高位地转换为整数类型 T（浮点源按截断后的整数部分判断）
+template<class T, class V>
+bool fitsInteger(const V v) {
+    using L = std::numeric_limits<T>;
+    if constexpr (std::is_same_v<V, bool>) {
+        return true;
+    } else if constexpr (std::is_floating_point_v<V>) {
+        const double t = std::trunc(static_cast<double>(v));
+        return t >= static_cast<double>(L::min()) && t < static_cast<double>(L::max()) + 1.0;
+    } else if constexpr (std::is_signed_v<V>) {
+        if (v < 0) return std::is_signed_v<T> && static_cast<int64_t>(v) >= static_cast<int64_t>(L::min());
+        return static_cast<uint64_t>(v) <= static_cast<uint64_t>(L::max());
+    } else {
+        return static_cast<uint64_t>(v) <= static_cast<uint64_t>(L::max());
+    }
+}
+
+template<class T, class V>
+T checkedCast(const V v) {
+    if constexpr (std::is_integral_v<T>) {
+        if (!fitsInteger<T>(v)) throw std::out_of_range("写入值超出变量类型范围: " + std::to_string(v));
+    } else if constexpr (std::is_same_v<T, float> && std::is_floating_point_v<V>) {
+        if (std::isfinite(v) && std::fabs(static_cast<double>(v)) > std::numeric_limits<float>::max())
+            throw std::out_of_range("写入值超出 float 范围: " + std::to_string(v));
+    }
+    return static_cast<T>(v);
+}
+
+// 写入值可能来自 JSON 等外部来源，类型不一定与变量一致，统一转换为目标类型；
+// 超出目标类型范围的值拒绝写入，不做截断回绕
+template<class T>
+T convertValue(const Variable::ValueType& value) {
+    return std::visit([](auto&& v) -> T {
+        using V = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<V, std::string>) {
+            try {
+                if constexpr (std::is_same_v<T, bool>) return v == "true" || v == "1";
+                else if constexpr (std::is_floating_point_v<T>) return checkedCast<T>(std::stod(v));
+                else if constexpr (std::is_signed_v<T>) return checkedCast<T>(std::stoll(v));
+                else if (v.find('-') == std::string::npos) return checkedCast<T>(std::stoull(v));
+            } catch (const std::out_of_range&) {
+                throw std::out_of_range("写入值超出变量类型范围: " + v);
+            } catch (...) {
+                throw std::invalid_argument("无法转换写入值: " + v);
+            }
+            throw std::out_of_range("写入值超出变量类型范围: " + v);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return v != V{};
+        } else {
+            return checkedCast<T>(v);
+        }
+    }, value);
+}
+
+template<class T>
+uint64_t toBits(const T v) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(T));
+    return bits;
+}
+
+} // namespace
+
+ModbusVariable::ModbusVariable(std::string id, std::string name, std::wstring address,
+                               const VarType type, const VarAccess access,
+                               const std::string& endianness, const bool byteSwap,
+                               const ScaleParams& scaling)
+    : Variable(std::move(id), std::move(name), address,
+               scaling.isIdentity() || type == VarType::BOOL ? type : VarType::DOUBLE, access),
+      address_(parseAddress(address)), type_(type), wordOrder_(parseWordOrder(endianness, byteSwap)),
+      scaled_(!scaling.isIdentity() && type != VarType::BOOL), scaling_(scaling) {}
+
+int ModbusVariable::parseAddress(const std::wstring& address) {
     try {
-        if (address_.rfind(L"0x", 0) == 0 || address_.rfind(L"0X", 0) == 0)
-            return std::stoi(address_, nullptr, 16);
+        if (address.rfind(L"0x", 0) == 0 || address.rfind(L"0X", 0) == 0)
+            return std::stoi(address, nullptr, 16);
         else
-            return std::stoi(address_);
+            return std::stoi(address);
     } catch (...) {
         return 0;
     }
 }
 
+ModbusVariable::WordOrder ModbusVariable::parseWordOrder(const std::string& endianness, const bool byteSwap) {
+    if (endianness == "little") return byteSwap ? WordOrder::CDAB : WordOrder::DCBA;
+    if (endianness == "big" && byteSwap) return WordOrder::BADC;
+    return WordOrder::ABCD;
+}
 
 int ModbusVariable::registerCount() const {
     switch (type_) {
@@ -24,41 +108,35 @@ int ModbusVariable::registerCount() const {
     }
 }
 
-void ModbusVariable::setRawBits(const std::vector<uint8_t>& bits) {
+void ModbusVariable::setRawBits(const std::vector<uint8_t>& bits, const std::chrono::system_clock::time_point timestamp) {
     if (type_ == VarType::BOOL) {
         if (bits.empty()) {
             return;
         }
-        value_ = (bits[0] != 0);
-        timestamp_ = std::chrono::system_clock::now();
+        setValue(bits[0] != 0, VarQuality::GOOD, timestamp);
     } else {
     }
 }
 
-void ModbusVariable::setRawValue(const std::vector<uint16_t>& regs) {
-    rawRegs_ = regs;
-    value_ = decodeValue();
-    timestamp_ = std::chrono::system_clock::now();
+void ModbusVariable::setRawValue(const std::vector<uint16_t>& regs,
+                                 const std::chrono::system_clock::time_point timestamp) {
+    setValue(decodeValue(regs), VarQuality::GOOD, timestamp);
 }
 
-ModbusVariable::ValueType ModbusVariable::decodeValue() const {
-    return decodeValue(endianness_, byteSwap_);
-}
-
-ModbusVariable::ValueType ModbusVariable::decodeValue(const std::string& endianness, bool byteSwap) const {
-    if (rawRegs_.empty()) return {};
+ModbusVariable::ValueType ModbusVariable::decodeValue(const std::vector<uint16_t>& regs) const {
+    if (regs.empty()) return {};
 
     // 16位类型直接返回
     if (type_ == VarType::BOOL)
-        return (rawRegs_[0] != 0);
+        return (regs[0] != 0);
     if (type_ == VarType::INT16)
-        return static_cast<int16_t>(rawRegs_[0]);
+        return static_cast<int16_t>(regs[0]);
     if (type_ == VarType::UINT16)
-        return rawRegs_[0];
+        return regs[0];
 
     // 32位 float/int32/uint32
-    if ((type_ == VarType::FLOAT || type_ == VarType::INT32 || type_ == VarType::UINT32) && rawRegs_.size() >= 2) {
-        uint16_t r0 = rawRegs_[0], r1 = rawRegs_[1];
+    if ((type_ == VarType::FLOAT || type_ == VarType::INT32 || type_ == VarType::UINT32) && regs.size() >= 2) {
+        uint16_t r0 = regs[0], r1 = regs[1];
         // abcd:    high=reg[0], low=reg[1]
         // cdab:    high=reg[1], low=reg[0]
         // badc:    high=qToBigEndian(reg[0]), low=qToBigEndian(reg[1])
@@ -66,16 +144,11 @@ ModbusVariable::ValueType ModbusVariable::decodeValue(const std::string& endiann
         float f;
         uint32_t u32;
         int32_t i32;
-        if (endianness == "big" && !byteSwap) {      // abcd
-            u32 = (uint32_t(r0) << 16) | r1;
-        } else if (endianness == "little" && !byteSwap) { // dcba
-            u32 = (uint32_t(toBigEndian(r1)) << 16) | toBigEndian(r0);
-        } else if (endianness == "big" && byteSwap) {    // badc
-            u32 = (uint32_t(toBigEndian(r0)) << 16) | toBigEndian(r1);
-        } else if (endianness == "little" && byteSwap) { // cdab
-            u32 = (uint32_t(r1) << 16) | r0;
-        } else { // fallback abcd
-            u32 = (uint32_t(r0) << 16) | r1;
+        switch (wordOrder_) {
+            case WordOrder::DCBA: u32 = (uint32_t(toBigEndian(r1)) << 16) | toBigEndian(r0); break;
+            case WordOrder::BADC: u32 = (uint32_t(toBigEndian(r0)) << 16) | toBigEndian(r1); break;
+            case WordOrder::CDAB: u32 = (uint32_t(r1) << 16) | r0; break;
+            default:              u32 = (uint32_t(r0) << 16) | r1; break;
         }
 
         if (type_ == VarType::FLOAT) {
@@ -90,21 +163,24 @@ ModbusVariable::ValueType ModbusVariable::decodeValue(const std::string& endiann
     }
 
     // 64位 double/int64/uint64
-    if ((type_ == VarType::DOUBLE || type_ == VarType::INT64 || type_ == VarType::UINT64) && rawRegs_.size() >= 4) {
-        uint16_t r[4] = {rawRegs_[0], rawRegs_[1], rawRegs_[2], rawRegs_[3]};
+    if ((type_ == VarType::DOUBLE || type_ == VarType::INT64 || type_ == VarType::UINT64) && regs.size() >= 4) {
+        uint16_t r[4] = {regs[0], regs[1], regs[2], regs[3]};
         uint64_t u64 = 0;
-        if (endianness == "big" && !byteSwap) { // abcdefgh
-            u64 = (uint64_t(r[0]) << 48) | (uint64_t(r[1]) << 32) | (uint64_t(r[2]) << 16) | r[3];
-        } else if (endianness == "little" && !byteSwap) { // hgfedcba
-            u64 = (uint64_t(toBigEndian(r[3])) << 48) | (uint64_t(toBigEndian(r[2])) << 32) |
-                  (uint64_t(toBigEndian(r[1])) << 16) | toBigEndian(r[0]);
-        } else if (endianness == "big" && byteSwap) { // badcfehg
-            u64 = (uint64_t(toBigEndian(r[0])) << 48) | (uint64_t(toBigEndian(r[1])) << 32) |
-                  (uint64_t(toBigEndian(r[2])) << 16) | toBigEndian(r[3]);
-        } else if (endianness == "little" && byteSwap) { // ghefcdab
-            u64 = (uint64_t(r[3]) << 48) | (uint64_t(r[2]) << 32) | (uint64_t(r[1]) << 16) | r[0];
-        } else { // fallback
-            u64 = (uint64_t(r[0]) << 48) | (uint64_t(r[1]) << 32) | (uint64_t(r[2]) << 16) | r[3];
+        switch (wordOrder_) {
+            case WordOrder::DCBA: // hgfedcba
+                u64 = (uint64_t(toBigEndian(r[3])) << 48) | (uint64_t(toBigEndian(r[2])) << 32) |
+                      (uint64_t(toBigEndian(r[1])) << 16) | toBigEndian(r[0]);
+                break;
+            case WordOrder::BADC: // badcfehg
+                u64 = (uint64_t(toBigEndian(r[0])) << 48) | (uint64_t(toBigEndian(r[1])) << 32) |
+                      (uint64_t(toBigEndian(r[2])) << 16) | toBigEndian(r[3]);
+                break;
+            case WordOrder::CDAB: // ghefcdab
+                u64 = (uint64_t(r[3]) << 48) | (uint64_t(r[2]) << 32) | (uint64_t(r[1]) << 16) | r[0];
+                break;
+            default:              // abcdefgh
+                u64 = (uint64_t(r[0]) << 48) | (uint64_t(r[1]) << 32) | (uint64_t(r[2]) << 16) | r[3];
+                break;
         }
 
         if (type_ == VarType::DOUBLE) {
@@ -121,4 +197,62 @@ ModbusVariable::ValueType ModbusVariable::decodeValue(const std::string& endiann
     }
 
     return {};
-}
\ No newline at end of file
+}
+
+std::vector<uint16_t> ModbusVariable::encodeValue(const ValueType& value) const {
+    if (!scaled_) return encodeRaw(value);
+    double raw = scaling_.toRaw(convertValue<double>(value));
+    if (!std::isfinite(raw))
+        throw std::invalid_argument("写入值无法换算为原始值（scale=" + std::to_string(scaling_.scale) + "）");
+    if (type_ == VarType::FLOAT || type_ == VarType::DOUBLE) return encodeRaw(raw);
+    raw = std::round(raw);
+    double lo = 0, hi = 0;
+    switch (type_) {
+        case VarType::INT16:  lo = INT16_MIN; hi = INT16_MAX; break;
+        case VarType::UINT16: hi = UINT16_MAX; break;
+        case VarType::INT32:  lo = INT32_MIN; hi = INT32_MAX; break;
+        case VarType::UINT32: hi = UINT32_MAX; break;
+        case VarType::INT64:  lo = -9223372036854775808.0; hi = 9223372036854774784.0; break;
+        case VarType::UINT64: hi = 18446744073709549568.0; break;
+        default: break;
+    }
+    if (!(raw >= lo && raw <= hi))
+        throw std::invalid_argument("写入值换算后超出寄存器范围: " + std::to_string(raw));
+    return encodeRaw(raw);
+}
+
+std::vector<uint16_t> ModbusVariable::encodeRaw(const ValueType& value) const {
+    uint64_t bits = 0;
+    switch (type_) {
+        case VarType::BOOL:   return {static_cast<uint16_t>(convertValue<bool>(value) ? 1 : 0)};
+        case VarType::INT16:  return {static_cast<uint16_t>(convertValue<int16_t>(value))};
+        case VarType::UINT16: return {convertValue<uint16_t>(value)};
+        case VarType::INT32:  bits = toBits(convertValue<int32_t>(value)); break;
+        case VarType::UINT32: bits = toBits(convertValue<uint32_t>(value)); break;
+        case VarType::FLOAT:  bits = toBits(convertValue<float>(value)); break;
+        case VarType::INT64:  bits = toBits(convertValue<int64_t>(value)); break;
+        case VarType::UINT64: bits = toBits(convertValue<uint64_t>(value)); break;
+        case VarType::DOUBLE: bits = toBits(convertValue<double>(value)); break;
+        default: throw std::invalid_argument("不支持的变量类型");
+    }
+
+    if (registerCount() == 2) {
+        const auto hi = static_cast<uint16_t>(bits >> 16), lo = static_cast<uint16_t>(bits);
+        switch (wordOrder_) {
+            case WordOrder::DCBA: return {toBigEndian(lo), toBigEndian(hi)};
+            case WordOrder::BADC: return {toBigEndian(hi), toBigEndian(lo)};
+            case WordOrder::CDAB: return {lo, hi};
+            default:              return {hi, lo};
+        }
+    }
+
+    // w[0] 为最高 16 位
+    uint16_t w[4];
+    for (int k = 0; k < 4; ++k) w[k] = static_cast<uint16_t>(bits >> (48 - 16 * k));
+    switch (wordOrder_) {
+        case WordOrder::DCBA: return {toBigEndian(w[3]), toBigEndian(w[2]), toBigEndian(w[1]), toBigEndian(w[0])};
+        case WordOrder::BADC: return {toBigEndian(w[0]), toBigEndian(w[1]), toBigEndian(w[2]), toBigEndian(w[3])};
+        case WordOrder::CDAB: return {w[3], w[2], w[1], w[0]};
+        default:              return {w[0], w[1], w[2], w[3]};
+    }
+}
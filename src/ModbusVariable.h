@@ -1,26 +1,45 @@
 #pragma once
+#include "ScaleStage.h"
 #include "Variable.h"
-#include <utility>
+#include <cstdint>
 #include <vector>
 
 class ModbusVariable final : public Variable {
 public:
+    // 32/64 位值的字节序，由设备的 endianness + byte_swap 在构造时折算
+    enum class WordOrder : uint8_t { ABCD, DCBA, BADC, CDAB };
+
+    // 配置了工程量换算时标签以 DOUBLE 类型登记，type 仍为寄存器中的原始类型；BOOL 变量不做换算
     ModbusVariable(std::string id, std::string name, std::wstring address,
-               const VarType type, const VarAccess access,
-               std::string  endianness, const bool byteSwap)
-: Variable(std::move(id), std::move(name), std::move(address), type, access),
-  endianness_(std::move(endianness)), byteSwap_(byteSwap) {}
-    [[nodiscard]] int addressAsInt() const;
+                   VarType type, VarAccess access,
+                   const std::string& endianness, bool byteSwap,
+                   const ScaleParams& scaling = {});
+    [[nodiscard]] int addressAsInt() const { return address_; }
     [[nodiscard]] int registerCount() const;
-    void setRawBits(const std::vector<uint8_t>& bits);
-    void setRawValue(const std::vector<uint16_t>& regs);
-    [[nodiscard]] ValueType decodeValue() const;
-    [[nodiscard]] ValueType decodeValue(const std::string& endianness, bool byteSwap) const;
+    void setRawBits(const std::vector<uint8_t>& bits, std::chrono::system_clock::time_point timestamp);
+    void setRawValue(const std::vector<uint16_t>& regs, std::chrono::system_clock::time_point timestamp);
+    [[nodiscard]] ValueType decodeValue(const std::vector<uint16_t>& regs) const;
+    // decodeValue 的逆过程：按变量类型与字节序编码为寄存器序列，值无法转换时抛 invalid_argument。
+    // 有换算时 value 为工程值，先还原为原始值，整数类型四舍五入且不得超出类型范围
+    [[nodiscard]] std::vector<uint16_t> encodeValue(const ValueType& value) const;
+    [[nodiscard]] VarType getVarType() const { return type_; }
+    [[nodiscard]] bool isScaled() const { return scaled_; }
+    [[nodiscard]] const ScaleParams& getScaling() const { return scaling_; }
+    // 所属分组换算阶段中的下标，-1 表示不换算；由分组在重建读计划时分配
+    [[nodiscard]] int32_t scaleSlot() const { return scaleSlot_; }
+    void setScaleSlot(const int32_t slot) { scaleSlot_ = slot; }
+    static WordOrder parseWordOrder(const std::string& endianness, bool byteSwap);
+    static int parseAddress(const std::wstring& address);
     static uint16_t toBigEndian(const uint16_t val) {
         return (val >> 8) | (val << 8);
     }
 private:
-    std::string endianness_;
-    bool byteSwap_;
-    std::vector<uint16_t> rawRegs_;
+    [[nodiscard]] std::vector<uint16_t> encodeRaw(const ValueType& value) const;
+
+    int address_;
+    VarType type_;
+    WordOrder wordOrder_;
+    bool scaled_;
+    ScaleParams scaling_;
+    int32_t scaleSlot_ = -1;
 };
@@ -1,6 +1,8 @@
 // OpcdaDevice.cpp
 
 #include "OpcdaDevice.h"
+#include <chrono>
+#include <thread>
 #include <utility>
 #include <windows.h>
 #include "Logger.h"
@@ -30,9 +32,17 @@ bool OpcdaDevice::connect() {
         if(opcServer_==nullptr){
             opcServer_ = opcHOST_->connectDAServer(utf8_to_wstring(serverName_));
         }
-        do{
+        // 等待服务端进入运行状态，超时则本次连接失败，避免无限忙等拖住启动
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(connectTimeoutMs_);
+        opcServer_->getStatus(status_);
+        while (status_.dwServerState != OPC_STATUS_RUNNING) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                GLOG_ERROR(logPrefix() + "等待服务端运行状态超时");
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
             opcServer_->getStatus(status_);
-        } while (status_.dwServerState != OPC_STATUS_RUNNING);
+        }
         GLOG_INFO(logPrefix() + "连接成功");
         connected_= true;
     }
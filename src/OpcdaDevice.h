@@ -35,6 +35,7 @@ public:
     );
     bool enableAsync(const std::string& groupId, IAsyncDataCallback* cb);
     void removeGroup(const std::string& groupId);
+    void setConnectTimeout(const int ms) { connectTimeoutMs_ = ms > 0 ? ms : 10000; }
 
 
 private:
@@ -44,6 +45,7 @@ private:
     COPCServer* opcServer_{};
     ServerStatus status_{};
     bool connected_ = false;
+    int connectTimeoutMs_ = 10000;
     mutable std::mutex mtx_;
     std::unordered_map<std::string, std::shared_ptr<COPCGroup>> groups_;
 };
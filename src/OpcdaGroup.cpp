@@ -5,9 +5,9 @@
 #include <utility>
 #include "OpcdaDevice.h"
 #include "Logger.h"
-#include "DataBuffer.h"
 #include "DeviceManager.h"
 #include "OpcdaVariable.h"
+#include "FastClock.h"
 #include "OPCItem.h"
 #define MESSAGE_PUMP_UNTIL(x)                                 \
 while (!x){                                                   \
@@ -66,37 +66,23 @@ void OpcdaGroup::pollVariablesImpl(const std::shared_ptr<Device> &dev) {
         for (const auto &[addr, item]: opcItems_) items.push_back(item);
         auto *complete = new CTransComplete("OpcdaGroup[" + getId() + "] 异步读成功");
         CTransaction *transaction = nullptr;
+        AcquisitionStamp stamp;
+        stamp.requestSent = FastClock::now();
         transaction = group_->readAsync(items, complete);
         MESSAGE_PUMP_UNTIL(transaction->isCompleted());
+        stamp.responseReceived = FastClock::now();
+        const auto ts = stamp.acquired();
         for (const auto& [addr, item] : opcItems_) {
             if (const OPCItemData* asyncData = transaction->getItemValue(item); asyncData && !FAILED(asyncData->Error)) {
                 if (auto it = std::find_if(getVariables().begin(), getVariables().end(),[&addr](const auto& v) { return v->getAddress() == addr; }); it != getVariables().end()) {
                     if (const auto var= std::dynamic_pointer_cast<OpcdaVariable>(*it)) {
                         if (asyncData->wQuality==192) {
-                            var->setRawValue(asyncData->vDataValue);
-                            DataBuffer::instance().set(
-                                var->getVarid(),
-                                var->getValue(),
-                                std::chrono::system_clock::now(),
-                                VarQuality::BAD
-                            );
+                            var->setRawValue(asyncData->vDataValue, ts);
                         }else {
-                            var->setQuality(VarQuality::BAD);
-                            DataBuffer::instance().set(
-                                var->getVarid(),
-                                var->getValue(),
-                                std::chrono::system_clock::now(),
-                                VarQuality::BAD
-                            );
+                            var->setQuality(VarQuality::BAD, ts);
                         }
                     }else {
-                        var->setQuality(VarQuality::BAD);
-                        DataBuffer::instance().set(
-                            var->getVarid(),
-                            var->getValue(),
-                            std::chrono::system_clock::now(),
-                            VarQuality::BAD
-                        );
+                        (*it)->setQuality(VarQuality::BAD, ts);
                     }
                 }
             }
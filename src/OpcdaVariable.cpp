@@ -2,11 +2,8 @@
 #include <codecvt>
 #include <locale>
 
-void OpcdaVariable::setRawValue(const VARIANT& var) {
-    rawVar_ = var;
-    value_=decodeValue(var);
-    timestamp_ = std::chrono::system_clock::now();
-    quality_ = VarQuality::GOOD;
+void OpcdaVariable::setRawValue(const VARIANT& var, const std::chrono::system_clock::time_point timestamp) {
+    setValue(decodeValue(var), VarQuality::GOOD, timestamp);
 }
 
 OpcdaVariable::ValueType OpcdaVariable::decodeValue(const VARIANT& var) {
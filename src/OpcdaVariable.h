@@ -5,11 +5,7 @@
 class OpcdaVariable final : public Variable {
 public:
     using Variable::Variable;
-    void setRawValue(const VARIANT& var);
+    void setRawValue(const VARIANT& var, std::chrono::system_clock::time_point timestamp);
 
     static ValueType decodeValue(const VARIANT& var);
-    [[nodiscard]] VARIANT getRawVariant() const { return rawVar_; }
-
-private:
-    VARIANT rawVar_{};
 };
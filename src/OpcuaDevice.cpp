@@ -1,5 +1,108 @@
-//
-// Created by user on 25-7-5.
-//
+// OpcuaDevice.cpp
 
 #include "OpcuaDevice.h"
+#include <codecvt>
+#include <locale>
+#include <utility>
+#include "Logger.h"
+
+OpcuaDevice::OpcuaDevice(const std::string& id,
+                         const std::string& name,
+                         std::string  endpoint,
+                         std::string  username,
+                         std::string  password)
+    : Device(id, name), endpoint_(std::move(endpoint)),
+      username_(std::move(username)), password_(std::move(password))
+{
+    // 会话关闭意味着服务端订阅与注册节点全部失效；仅连接闪断后重新激活原会话时订阅仍然有效，无需重建
+    client_.onSessionClosed([this] {
+        ++sessionGeneration_;
+        GLOG_WARN(logPrefix() + "会话已关闭，订阅将在下次周期批量重建");
+    });
+    client_.onDisconnected([this] {
+        connected_ = false;
+    });
+    client_.onSessionActivated([this] {
+        connected_ = true;
+    });
+}
+
+OpcuaDevice::~OpcuaDevice() {
+    disconnect();
+}
+
+bool OpcuaDevice::connect() {
+    ++clientWaiters_;
+    std::lock_guard<std::mutex> lock(clientMtx_);
+    --clientWaiters_;
+    if (connected_ && client_.isConnected()) {
+        return true;
+    }
+    try {
+        if (!username_.empty()) {
+            client_.config().setUserIdentityToken(opcua::UserNameIdentityToken(username_, password_));
+        }
+        client_.connect(endpoint_);
+        connected_ = true;
+        GLOG_INFO(logPrefix() + "连接成功");
+    } catch (const std::exception& ex) {
+        connected_ = false;
+        GLOG_ERROR(logPrefix() + "连接失败: " + ex.what());
+        return false;
+    }
+    if (bool expected = false; pumpRunning_.compare_exchange_strong(expected, true)) {
+        pumpThread_ = std::thread(&OpcuaDevice::pumpLoop, this);
+    }
+    return true;
+}
+
+void OpcuaDevice::disconnect() {
+    pumpRunning_ = false;
+    if (pumpThread_.joinable()) pumpThread_.join();
+    std::lock_guard<std::mutex> lock(clientMtx_);
+    try {
+        if (client_.isConnected()) client_.disconnect();
+    } catch (const std::exception& ex) {
+        GLOG_WARN(logPrefix() + "断开连接异常: " + ex.what());
+    }
+    connected_ = false;
+    ++sessionGeneration_;
+    GLOG_INFO(logPrefix() + "已断开连接");
+}
+
+bool OpcuaDevice::isConnected() const {
+    return connected_;
+}
+
+std::string OpcuaDevice::logPrefix() const {
+    return "Opcua[" + name_ + "] ";
+}
+
+void OpcuaDevice::pumpLoop() {
+    while (pumpRunning_) {
+        if (!connected_) {
+            // 断线期间不驱动事件循环，由分组周期调用 connect() 重连
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clientMtx_);
+            try {
+                // 短超时，避免长时间占用客户端锁阻塞轮询模式的读请求
+                client_.runIterate(5);
+            } catch (const std::exception& ex) {
+                GLOG_WARN(logPrefix() + "事件循环异常: " + ex.what());
+            }
+        }
+        // std::mutex 不保证公平，释放后立即重新加锁可能一直抢在等待的读请求之前；
+        // 有等待者时先让它拿到锁（同步服务调用期间客户端同样会处理订阅推送）
+        while (clientWaiters_.load() > 0 && pumpRunning_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+std::string OpcuaDevice::wstring_to_utf8(const std::wstring& wstr) {
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> conv;
+    return conv.to_bytes(wstr);
+}
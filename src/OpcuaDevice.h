@@ -1,16 +1,49 @@
-//
-// Created by user on 25-7-5.
-//
-
-#ifndef OPCUADEVICE_H
-#define OPCUADEVICE_H
-
-
-
-class OpcuaDevice {
-
+// OpcuaDevice.h
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <open62541pp/client.hpp>
+#include "Device.h"
+
+class OpcuaDevice final : public Device {
+public:
+    OpcuaDevice(const std::string& id,
+                const std::string& name,
+                std::string  endpoint,
+                std::string  username,
+                std::string  password);
+    ~OpcuaDevice() override;
+    bool connect() override;
+    void disconnect() override;
+    [[nodiscard]] bool isConnected() const;
+    [[nodiscard]] std::string logPrefix() const;
+    // 会话代数：每次会话失效递增，分组据此判断订阅/注册节点是否需要重建
+    [[nodiscard]] uint64_t sessionGeneration() const { return sessionGeneration_; }
+    // open62541 客户端非线程安全，所有服务调用都经由此处串行化
+    template<class F>
+    auto withClient(F&& fn) -> decltype(fn(std::declval<opcua::Client&>())) {
+        // 登记等待者，事件循环线程见到后让出客户端锁
+        ++clientWaiters_;
+        std::unique_lock<std::mutex> lock(clientMtx_);
+        --clientWaiters_;
+        return fn(client_);
+    }
+    static std::string wstring_to_utf8(const std::wstring& wstr);
+
+private:
+    // 后台驱动客户端事件循环，订阅推送的数据在这里回调
+    void pumpLoop();
+
+    std::string endpoint_;
+    std::string username_;
+    std::string password_;
+    opcua::Client client_;
+    mutable std::mutex clientMtx_;
+    std::atomic<int> clientWaiters_{0};  // 正在等待客户端锁的服务调用数
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> pumpRunning_{false};
+    std::atomic<uint64_t> sessionGeneration_{1};
+    std::thread pumpThread_;
 };
-
-
-
-#endif //OPCUADEVICE_H
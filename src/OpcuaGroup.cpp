@@ -0,0 +1,185 @@
+#include "OpcuaGroup.h"
+#include <algorithm>
+#include <utility>
+#include <open62541pp/services/attribute.hpp>
+#include <open62541pp/services/monitoreditem.hpp>
+#include <open62541pp/services/subscription.hpp>
+#include <open62541pp/services/view.hpp>
+#include "OpcuaDevice.h"
+#include "OpcuaVariable.h"
+#include "FastClock.h"
+#include "Logger.h"
+
+OpcuaGroup::OpcuaGroup(DeviceManager* mgr, std::string deviceId, std::string id,
+                       std::string name, const uint32_t intervalMs, const std::string& mode)
+    : Group(mgr, std::move(deviceId), std::move(id), std::move(name), intervalMs),
+      pollMode_(mode == "poll"), callbackTarget_(std::make_shared<OpcuaGroup*>(this)) {}
+
+OpcuaGroup::~OpcuaGroup() {
+    closeSubscription();
+}
+
+void OpcuaGroup::closeSubscription() {
+    const auto uaDev = std::dynamic_pointer_cast<OpcuaDevice>(device_.lock());
+    if (!uaDev) {
+        // 设备已析构：客户端及其回调随之销毁
+        *callbackTarget_ = nullptr;
+        return;
+    }
+    uaDev->withClient([&](opcua::Client& client) {
+        if (generation_ == uaDev->sessionGeneration()) dropSubscription(client);
+        *callbackTarget_ = nullptr;
+        closed_ = true;
+        monitored_.clear();
+        subscriptionId_ = 0;
+        registeredIds_.clear();
+    });
+}
+
+void OpcuaGroup::dropSubscription(opcua::Client& client) {
+    if (subscriptionId_ == 0) return;
+    // 监控项随订阅一并删除；会话不可用时删除失败，订阅随会话超时由服务端清理
+    try {
+        const auto rc = opcua::services::deleteSubscription(client, subscriptionId_);
+        if (rc.isBad()) GLOG_WARN("OpcuaGroup[" + getId() + "] 删除订阅失败 id=" + std::to_string(subscriptionId_));
+    } catch (const std::exception& ex) {
+        GLOG_WARN("OpcuaGroup[" + getId() + "] 删除订阅异常: " + std::string(ex.what()));
+    }
+    subscriptionId_ = 0;
+    monitored_.clear();
+}
+
+void OpcuaGroup::pollVariablesImpl(const std::shared_ptr<Device> &dev) {
+    const auto uaDev = std::dynamic_pointer_cast<OpcuaDevice>(dev);
+    if (!uaDev) {
+        GLOG_ERROR("OpcuaGroup[" + getId() + "] 设备类型错误！");
+        return;
+    }
+    device_ = uaDev;
+    if (!uaDev->isConnected() && !uaDev->connect()) {
+        throw std::runtime_error("连接OPC UA服务端失败");
+    }
+    const bool varsChanged = uaVars_.size() != getVariables().size();
+    if (varsChanged) {
+        uaVars_.clear();
+        uaSamplingMs_.clear();
+        for (size_t i = 0; i < getVariables().size(); ++i) {
+            if (auto uaVar = std::dynamic_pointer_cast<OpcuaVariable>(getVariables()[i])) {
+                uaVars_.push_back(uaVar);
+                uaSamplingMs_.push_back(static_cast<double>(intervalMs_) * getRateDivisor(i));
+            }
+        }
+    }
+    uaDev->withClient([&](opcua::Client& client) {
+        if (closed_) return;
+        if (generation_ != uaDev->sessionGeneration()) {
+            // 会话已更换：旧订阅与注册节点随会话失效，仅丢弃本地句柄
+            subscriptionId_ = 0;
+            registeredIds_.clear();
+            monitored_.clear();
+            generation_ = uaDev->sessionGeneration();
+        }
+        // 变量集合变化后按新集合重建订阅与注册节点
+        if (varsChanged) {
+            dropSubscription(client);
+            registeredIds_.clear();
+        }
+        if (pollMode_) {
+            if (registeredIds_.size() != uaVars_.size()) registerNodes(client);
+            readRegistered(client);
+        } else if (subscriptionId_ == 0) {
+            createSubscription(client);
+        }
+    });
+}
+
+void OpcuaGroup::createSubscription(opcua::Client& client) {
+    opcua::SubscriptionParameters params{};
+    params.publishingInterval = static_cast<double>(intervalMs_);
+    const auto subResp = opcua::services::createSubscription(client, params, true, {}, {});
+    opcua::throwIfBad(subResp.responseHeader().serviceResult());
+    subscriptionId_ = subResp.subscriptionId();
+
+    // 监控项按批次一次性创建，重连后的订阅重建同样只需 ceil(N/kBatchSize) 次往返
+    size_t okCount = 0;
+    for (size_t begin = 0; begin < uaVars_.size(); begin += kBatchSize) {
+        const size_t end = std::min(begin + kBatchSize, uaVars_.size());
+        std::vector<opcua::MonitoredItemCreateRequest> items;
+        items.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            items.emplace_back(
+                opcua::ReadValueId(uaVars_[i]->getNodeId(), opcua::AttributeId::Value),
+                opcua::MonitoringMode::Reporting,
+                opcua::MonitoringParameters(static_cast<uint32_t>(i), uaSamplingMs_[i],
+                                            opcua::ExtensionObject{}, 1, true));
+        }
+        const opcua::CreateMonitoredItemsRequest request(
+            opcua::RequestHeader{}, subscriptionId_, opcua::TimestampsToReturn::Both, items);
+        const auto resp = opcua::services::createMonitoredItemsDataChange(
+            client, request,
+            [target = callbackTarget_](uint32_t, const uint32_t monId, const opcua::DataValue& dv) {
+                if (OpcuaGroup* self = *target) self->onDataChange(monId, dv);
+            },
+            {});
+        opcua::throwIfBad(resp.responseHeader().serviceResult());
+        const auto results = resp.results();
+        for (size_t k = 0; k < results.size() && begin + k < end; ++k) {
+            const auto& var = uaVars_[begin + k];
+            if (results[k].statusCode().isBad()) {
+                GLOG_WARN("OpcuaGroup[" + getId() + "] 变量[" + var->getId() + "] 创建监控项失败");
+                var->setQuality(VarQuality::BAD);
+                continue;
+            }
+            monitored_[results[k].monitoredItemId()] = var;
+            ++okCount;
+        }
+    }
+    GLOG_INFO("OpcuaGroup[" + getId() + "] 订阅已建立 id=" + std::to_string(subscriptionId_) +
+              " 监控项=" + std::to_string(okCount) + "/" + std::to_string(uaVars_.size()));
+}
+
+void OpcuaGroup::registerNodes(opcua::Client& client) {
+    registeredIds_.clear();
+    registeredIds_.reserve(uaVars_.size());
+    for (size_t begin = 0; begin < uaVars_.size(); begin += kBatchSize) {
+        const size_t end = std::min(begin + kBatchSize, uaVars_.size());
+        std::vector<opcua::NodeId> nodes;
+        nodes.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) nodes.push_back(uaVars_[i]->getNodeId());
+        const opcua::RegisterNodesRequest request(opcua::RequestHeader{}, nodes);
+        const auto resp = opcua::services::registerNodes(client, request);
+        opcua::throwIfBad(resp.responseHeader().serviceResult());
+        for (const auto& id : resp.registeredNodeIds()) registeredIds_.push_back(id);
+    }
+    GLOG_INFO("OpcuaGroup[" + getId() + "] 已注册节点 " + std::to_string(registeredIds_.size()) + " 个");
+}
+
+void OpcuaGroup::readRegistered(opcua::Client& client) {
+    for (size_t begin = 0; begin < registeredIds_.size(); begin += kBatchSize) {
+        const size_t end = std::min(begin + kBatchSize, registeredIds_.size());
+        std::vector<opcua::ReadValueId> ids;
+        ids.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) ids.emplace_back(registeredIds_[i], opcua::AttributeId::Value);
+        const opcua::ReadRequest request(opcua::RequestHeader{}, 0.0, opcua::TimestampsToReturn::Neither, ids);
+        AcquisitionStamp stamp;
+        stamp.requestSent = FastClock::now();
+        const auto resp = opcua::services::read(client, request);
+        stamp.responseReceived = FastClock::now();
+        opcua::throwIfBad(resp.responseHeader().serviceResult());
+        const auto results = resp.results();
+        const auto ts = stamp.acquired();
+        for (size_t k = 0; k < results.size() && begin + k < end; ++k) {
+            uaVars_[begin + k]->setRawValue(results[k], ts);
+        }
+    }
+}
+
+void OpcuaGroup::onDataChange(const uint32_t monitoredItemId, const opcua::DataValue& dv) {
+    const auto it = monitored_.find(monitoredItemId);
+    if (it == monitored_.end()) return;
+    it->second->setRawValue(dv, FastClock::now());
+    if (!firstGoodSeen_ && it->second->getQuality() == VarQuality::GOOD) {
+        firstGoodSeen_ = true;
+        if (const auto dev = device_.lock()) dev->recordSample(VarQuality::GOOD);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <open62541pp/client.hpp>
+#include "Group.h"
+
+class OpcuaDevice;
+class OpcuaVariable;
+
+// mode = "subscribe"：建立订阅与监控项，由服务端按 interval_ms 推送变化，周期任务仅做连接与订阅保活
+// mode = "poll"     ：批量 RegisterNodes 后按周期批量 Read
+class OpcuaGroup final : public Group {
+public:
+    OpcuaGroup(DeviceManager* mgr, std::string deviceId, std::string id,
+               std::string name, uint32_t intervalMs, const std::string& mode);
+    // 析构前删除服务端订阅，并使已登记的数据变化回调失效
+    ~OpcuaGroup() override;
+    void pollVariablesImpl(const std::shared_ptr<Device> &dev) override ;
+    void retire() override { closeSubscription(); }
+    // 删除订阅与监控项并使回调失效，之后不再建立订阅或读取；可重复调用
+    void closeSubscription();
+
+private:
+    void createSubscription(opcua::Client& client);
+    void dropSubscription(opcua::Client& client);
+    void registerNodes(opcua::Client& client);
+    void readRegistered(opcua::Client& client);
+    void onDataChange(uint32_t monitoredItemId, const opcua::DataValue& dv);
+
+    // 单次服务请求的节点数上限，多数服务端 MaxNodesPerRead/MaxMonitoredItemsPerCall 不低于此值
+    static constexpr size_t kBatchSize = 1000;
+
+    bool pollMode_;
+    uint64_t generation_ = 0;          // 建立订阅/注册节点时的会话代数
+    uint32_t subscriptionId_ = 0;
+    std::vector<std::shared_ptr<OpcuaVariable>> uaVars_;
+    std::vector<double> uaSamplingMs_;  // 各监控项的采样周期（变量自身周期）
+    std::vector<opcua::NodeId> registeredIds_;
+    std::unordered_map<uint32_t, std::shared_ptr<OpcuaVariable>> monitored_;
+    // 数据变化回调持有它而非裸 this：回调只在持有客户端锁时触发，析构时在同一把锁内置空
+    std::shared_ptr<OpcuaGroup*> callbackTarget_;
+    std::weak_ptr<Device> device_;     // 订阅回调中记录首个有效数据
+    bool firstGoodSeen_ = false;
+    bool closed_ = false;              // 客户端锁内访问
+};
@@ -0,0 +1,51 @@
+#include "OpcuaVariable.h"
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include "OpcuaDevice.h"
+
+OpcuaVariable::OpcuaVariable(std::string id, std::string name, std::wstring address,
+                             const VarType type, const VarAccess access)
+    : Variable(std::move(id), std::move(name), std::move(address), type, access),
+      nodeId_(parseNodeId(OpcuaDevice::wstring_to_utf8(getAddress()))) {}
+
+void OpcuaVariable::setRawValue(const opcua::DataValue& dv, const std::chrono::system_clock::time_point timestamp) {
+    const auto& status = dv.status();
+    if (status.isBad() || !dv.hasValue()) {
+        setQuality(VarQuality::BAD, timestamp);
+        return;
+    }
+    setValue(decodeValue(dv.value()), status.isGood() ? VarQuality::GOOD : VarQuality::UNCERTAIN, timestamp);
+}
+
+OpcuaVariable::ValueType OpcuaVariable::decodeValue(const opcua::Variant& var) {
+    if (var.isType<bool>())     return var.scalar<bool>();
+    if (var.isType<int16_t>())  return var.scalar<int16_t>();
+    if (var.isType<uint16_t>()) return var.scalar<uint16_t>();
+    if (var.isType<int32_t>())  return var.scalar<int32_t>();
+    if (var.isType<uint32_t>()) return var.scalar<uint32_t>();
+    if (var.isType<int64_t>())  return var.scalar<int64_t>();
+    if (var.isType<uint64_t>()) return var.scalar<uint64_t>();
+    if (var.isType<float>())    return var.scalar<float>();
+    if (var.isType<double>())   return var.scalar<double>();
+    if (var.isType<opcua::String>())
+        return std::string(static_cast<std::string_view>(var.scalar<opcua::String>()));
+    return {};
+}
+
+opcua::NodeId OpcuaVariable::parseNodeId(const std::string& address) {
+    std::string_view s(address);
+    uint16_t ns = 0;
+    if (s.rfind("ns=", 0) == 0) {
+        const auto semi = s.find(';');
+        if (semi == std::string_view::npos)
+            throw std::invalid_argument("Invalid NodeId: " + address);
+        ns = static_cast<uint16_t>(std::stoi(std::string(s.substr(3, semi - 3))));
+        s.remove_prefix(semi + 1);
+    }
+    if (s.rfind("i=", 0) == 0)
+        return {ns, static_cast<uint32_t>(std::stoul(std::string(s.substr(2))))};
+    if (s.rfind("s=", 0) == 0)
+        return {ns, std::string(s.substr(2))};
+    throw std::invalid_argument("Invalid NodeId: " + address);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "Variable.h"
+#include <open62541pp/types.hpp>
+
+class OpcuaVariable final : public Variable {
+public:
+    OpcuaVariable(std::string id, std::string name, std::wstring address,
+                  VarType type, VarAccess access);
+    // 地址在构造时解析一次，订阅重建与轮询读时直接复用
+    [[nodiscard]] const opcua::NodeId& getNodeId() const { return nodeId_; }
+    void setRawValue(const opcua::DataValue& dv, std::chrono::system_clock::time_point timestamp);
+
+    static ValueType decodeValue(const opcua::Variant& var);
+    // 支持 "ns=2;s=Tag"、"ns=2;i=1001"、"i=2258"、"s=Tag" 格式
+    static opcua::NodeId parseNodeId(const std::string& address);
+
+private:
+    opcua::NodeId nodeId_;
+};
@@ -0,0 +1,91 @@
+#include "RateLimiter.h"
+#include <algorithm>
+#include <unordered_map>
+
+RateLimiter::RateLimiter(const double ratePerSec, const uint32_t burst)
+    : rate_(ratePerSec), burst_(std::max<uint32_t>(1, burst)), tokens_(burst_),
+      lastRefill_(std::chrono::steady_clock::now()) {}
+
+std::shared_ptr<RateLimiter> RateLimiter::shared(const std::string& key, const double ratePerSec,
+                                                 const uint32_t burst, bool* updated) {
+    static std::mutex mtx;
+    static std::unordered_map<std::string, std::weak_ptr<RateLimiter>> limiters;
+    std::lock_guard<std::mutex> lock(mtx);
+    if (updated) *updated = false;
+    if (auto existing = limiters[key].lock()) {
+        const bool changed = existing->reconfigure(ratePerSec, burst);
+        if (updated) *updated = changed;
+        return existing;
+    }
+    auto limiter = std::make_shared<RateLimiter>(ratePerSec, burst);
+    limiters[key] = limiter;
+    return limiter;
+}
+
+bool RateLimiter::reconfigure(const double ratePerSec, const uint32_t burst) {
+    const uint32_t cap = std::max<uint32_t>(1, burst);
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (rate_ == ratePerSec && burst_ == cap) return false;
+    // 先按旧速率结算到当前时刻，再切换参数
+    refill(std::chrono::steady_clock::now());
+    rate_ = ratePerSec;
+    burst_ = cap;
+    tokens_ = std::min<double>(burst_, tokens_);
+    // 排队者按新速率重新计算等待时间
+    cv_.notify_all();
+    return true;
+}
+
+double RateLimiter::getRate() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return rate_;
+}
+
+uint32_t RateLimiter::getBurst() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return burst_;
+}
+
+void RateLimiter::refill(const std::chrono::steady_clock::time_point now) {
+    const double elapsed = std::chrono::duration<double>(now - lastRefill_).count();
+    tokens_ = std::min<double>(burst_, tokens_ + elapsed * rate_);
+    lastRefill_ = now;
+}
+
+void RateLimiter::acquire(const std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    const auto start = std::chrono::steady_clock::now();
+    refill(start);
+    if (waiters_.empty() && tokens_ >= 1.0) {
+        tokens_ -= 1.0;
+        ++stats_.granted;
+        return;
+    }
+    const uint64_t ticket = nextTicket_++;
+    waiters_.push({deadline, ticket});
+    ++stats_.throttled;
+    for (;;) {
+        const auto now = std::chrono::steady_clock::now();
+        refill(now);
+        if (waiters_.top().ticket == ticket && tokens_ >= 1.0) break;
+        // 队首等待下一个令牌生成；其他等待者在队首放行时被唤醒
+        const auto wait = std::chrono::duration<double>((1.0 - std::min(tokens_, 1.0)) / rate_);
+        cv_.wait_for(lock, std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait) +
+                           std::chrono::microseconds(100));
+    }
+    tokens_ -= 1.0;
+    waiters_.pop();
+    ++stats_.granted;
+    const auto waitedMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    stats_.totalWaitMs += waitedMs;
+    stats_.maxWaitMs = std::max(stats_.maxWaitMs, waitedMs);
+    cv_.notify_all();
+}
+
+RateLimiter::Stats RateLimiter::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Stats st = stats_;
+    st.queued = waiters_.size();
+    return st;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+// 令牌桶限流：每个请求取一个令牌，令牌不足时按截止时间排队，截止时间早的先放行
+class RateLimiter {
+public:
+    struct Stats {
+        uint64_t granted = 0;       // 放行的请求数
+        uint64_t throttled = 0;     // 因令牌不足而排队的请求数
+        uint64_t totalWaitMs = 0;   // 累计排队时间
+        uint64_t maxWaitMs = 0;
+        size_t queued = 0;          // 当前排队数
+    };
+
+    RateLimiter(double ratePerSec, uint32_t burst);
+
+    // 按 key 共享同一个限流器（同一物理连接上的多个设备）。已存在且参数不同时按本次参数更新
+    // （配置重载后以最新的设置为准），updated 非空时返回是否发生了更新
+    static std::shared_ptr<RateLimiter> shared(const std::string& key, double ratePerSec, uint32_t burst,
+                                               bool* updated = nullptr);
+
+    // 修改速率与突发容量，已积累的令牌按新容量截断；参数未变时返回 false
+    bool reconfigure(double ratePerSec, uint32_t burst);
+
+    void acquire(std::chrono::steady_clock::time_point deadline);
+    [[nodiscard]] Stats getStats() const;
+    [[nodiscard]] double getRate() const;
+    [[nodiscard]] uint32_t getBurst() const;
+
+private:
+    struct Waiter {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t ticket;
+        bool operator>(const Waiter& o) const {
+            return deadline != o.deadline ? deadline > o.deadline : ticket > o.ticket;
+        }
+    };
+
+    void refill(std::chrono::steady_clock::time_point now);
+
+    double rate_;
+    uint32_t burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point lastRefill_;
+    uint64_t nextTicket_ = 0;
+    std::priority_queue<Waiter, std::vector<Waiter>, std::greater<>> waiters_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    Stats stats_;
+};
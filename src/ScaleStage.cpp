@@ -0,0 +1,60 @@
+#include "ScaleStage.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALE_STAGE_SSE2 1
+#endif
+
+void ScaleStage::clear() {
+    scale_.clear(); offset_.clear();
+    clampMin_.clear(); clampMax_.clear();
+    validMin_.clear(); validMax_.clear();
+    raw_.clear(); eng_.clear(); bad_.clear();
+}
+
+uint32_t ScaleStage::add(const ScaleParams& p) {
+    const auto i = static_cast<uint32_t>(scale_.size());
+    scale_.push_back(p.scale);
+    offset_.push_back(p.offset);
+    clampMin_.push_back(p.clampMin);
+    clampMax_.push_back(p.clampMax);
+    validMin_.push_back(p.validMin);
+    validMax_.push_back(p.validMax);
+    raw_.push_back(0);
+    eng_.push_back(0);
+    bad_.push_back(0);
+    return i;
+}
+
+void ScaleStage::apply() {
+    const size_t n = scale_.size();
+    const double* raw = raw_.data();
+    const double* scale = scale_.data();
+    const double* offset = offset_.data();
+    const double* cmin = clampMin_.data();
+    const double* cmax = clampMax_.data();
+    const double* vmin = validMin_.data();
+    const double* vmax = validMax_.data();
+    double* eng = eng_.data();
+    uint8_t* bad = bad_.data();
+    size_t i = 0;
+#ifdef SCALE_STAGE_SSE2
+    // 每次两个条目；max/min 的参数顺序保证 NaN 原样传出，与标量路径一致
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(raw + i), _mm_loadu_pd(scale + i)), _mm_loadu_pd(offset + i));
+        const __m128d ok = _mm_and_pd(_mm_cmpge_pd(v, _mm_loadu_pd(vmin + i)), _mm_cmple_pd(v, _mm_loadu_pd(vmax + i)));
+        const int mask = _mm_movemask_pd(ok);
+        bad[i] = (mask & 1) == 0;
+        bad[i + 1] = (mask & 2) == 0;
+        v = _mm_max_pd(_mm_loadu_pd(cmin + i), v);
+        v = _mm_min_pd(_mm_loadu_pd(cmax + i), v);
+        _mm_storeu_pd(eng + i, v);
+    }
+#endif
+    for (; i < n; ++i) {
+        double v = raw[i] * scale[i] + offset[i];
+        bad[i] = !(v >= vmin[i] && v <= vmax[i]);
+        v = v < cmin[i] ? cmin[i] : v;
+        v = v > cmax[i] ? cmax[i] : v;
+        eng[i] = v;
+    }
+}
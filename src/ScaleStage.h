@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// 工程量换算参数：eng = raw * scale + offset；超出 [validMin, validMax] 时品质为 UNCERTAIN，
+// 之后再限幅到 [clampMin, clampMax]。未配置的上下限为 ±inf，不影响结果
+struct ScaleParams {
+    double scale = 1.0;
+    double offset = 0.0;
+    double clampMin = -std::numeric_limits<double>::infinity();
+    double clampMax = std::numeric_limits<double>::infinity();
+    double validMin = -std::numeric_limits<double>::infinity();
+    double validMax = std::numeric_limits<double>::infinity();
+
+    [[nodiscard]] bool isIdentity() const {
+        return scale == 1.0 && offset == 0.0 &&
+               clampMin == -std::numeric_limits<double>::infinity() &&
+               clampMax == std::numeric_limits<double>::infinity() &&
+               validMin == -std::numeric_limits<double>::infinity() &&
+               validMax == std::numeric_limits<double>::infinity();
+    }
+    bool operator==(const ScaleParams& o) const {
+        return scale == o.scale && offset == o.offset && clampMin == o.clampMin && clampMax == o.clampMax &&
+               validMin == o.validMin && validMax == o.validMax;
+    }
+    // 工程值还原为原始值，用于写入。scale 为 0 时无法还原，返回 NaN（配置加载时已拒绝 scale 为 0）
+    [[nodiscard]] double toRaw(const double eng) const {
+        return scale != 0.0 ? (eng - offset) / scale : std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+// 批量换算阶段：参数按列存放，一组解码完成后对整组原始值做一次向量化的换算、校验与限幅。
+// 非线程安全，由所属分组在采集线程内独占使用
+class ScaleStage {
+public:
+    void clear();
+    // 追加一个条目，返回其下标
+    uint32_t add(const ScaleParams& p);
+    [[nodiscard]] size_t size() const { return scale_.size(); }
+    [[nodiscard]] bool empty() const { return scale_.empty(); }
+
+    // 解码后的原始值写入 raw(i)，apply 后从 value(i) / outOfRange(i) 取结果
+    double& raw(const uint32_t i) { return raw_[i]; }
+    void apply();
+    [[nodiscard]] double value(const uint32_t i) const { return eng_[i]; }
+    // 超出有效范围或结果为 NaN
+    [[nodiscard]] bool outOfRange(const uint32_t i) const { return bad_[i] != 0; }
+
+private:
+    std::vector<double> scale_, offset_, clampMin_, clampMax_, validMin_, validMax_;
+    std::vector<double> raw_, eng_;
+    std::vector<uint8_t> bad_;
+};
@@ -0,0 +1,314 @@
+#include "ShmTagTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "Logger.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 共享内存中的字段按 C 布局声明，写入时以同宽度的无锁原子变量访问
+template<class T>
+std::atomic<T>& atomicAt(T& v) {
+    static_assert(sizeof(std::atomic<T>) == sizeof(T) && std::atomic<T>::is_always_lock_free);
+    return *reinterpret_cast<std::atomic<T>*>(&v);
+}
+
+constexpr uint8_t kNoValue = IOT_SHM_KIND_NONE;
+
+uint64_t alignUp(const uint64_t n) { return (n + 63) & ~uint64_t{63}; }
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+static_assert(sizeof(iot_shm_slot) == 32, "iot_shm_slot layout");
+
+ShmTagTable& ShmTagTable::instance() {
+    static ShmTagTable table;
+    return table;
+}
+
+ShmTagTable::~ShmTagTable() {
+    if (!header_) return;
+    {
+        std::lock_guard<std::mutex> lock(heartbeatMtx_);
+        heartbeatStop_ = true;
+    }
+    heartbeatCv_.notify_all();
+    if (heartbeat_.joinable()) heartbeat_.join();
+    enabled_.store(false, std::memory_order_relaxed);
+    // 已映射的读取方据此得知需要重新打开
+    atomicAt(header_->state).store(0, std::memory_order_release);
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(mapping_);
+#else
+    ::munmap(base_, size_);
+    ::shm_unlink(name_.c_str());
+#endif
+}
+
+bool ShmTagTable::create(const std::string& name, const size_t bytes) {
+#ifdef _WIN32
+    name_ = "Local\\" + name;
+    const auto size = static_cast<uint64_t>(bytes);
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), name_.c_str());
+    if (!mapping) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        GLOG_ERROR("共享内存 " + name_ + " 已被其他进程占用");
+        CloseHandle(mapping);
+        return false;
+    }
+    void* p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!p) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+#else
+    name_ = name.front() == '/' ? name : "/" + name;
+    int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        if (const int old = ::shm_open(name_.c_str(), O_RDONLY, 0); old >= 0) {
+            const bool alive = ownerAlive(old);
+            ::close(old);
+            if (alive) {
+                GLOG_ERROR("共享内存 " + name_ + " 已被运行中的网关占用");
+                return false;
+            }
+        }
+        // 上次异常退出遗留的段：删除后重建，仍映射着它的读取方经 iot_shm_alive 发现心跳停止后重新打开
+        GLOG_WARN("共享内存 " + name_ + " 为遗留段，删除后重建");
+        ::shm_unlink(name_.c_str());
+        fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) return false;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name_.c_str());
+        return false;
+    }
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        ::shm_unlink(name_.c_str());
+        return false;
+    }
+#endif
+    base_ = static_cast<uint8_t*>(p);
+    size_ = bytes;
+    return true;
+}
+
+bool ShmTagTable::ownerAlive(const int fd) const {
+#ifdef _WIN32
+    (void)fd;
+    return true;
+#else
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(iot_shm_header))) return false;
+    void* p = ::mmap(nullptr, sizeof(iot_shm_header), PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    auto& h = *static_cast<iot_shm_header*>(p);
+    const uint32_t magic = atomicAt(h.magic).load(std::memory_order_acquire);
+    const uint32_t version = h.version;
+    const uint32_t state = atomicAt(h.state).load(std::memory_order_relaxed);
+    const auto pid = static_cast<pid_t>(h.publisher_pid);
+    const int64_t heartbeat = version >= 2 ? atomicAt(h.heartbeat_ms).load(std::memory_order_relaxed) : 0;
+    ::munmap(p, sizeof(iot_shm_header));
+    if (magic != IOT_SHM_MAGIC || state == 0 || pid <= 0 || pid == ::getpid()) return false;
+    if (::kill(pid, 0) != 0 && errno != EPERM) return false;
+    // 进程号可能已被复用：有心跳字段的段再要求心跳未超时
+    return version < 2 || nowMs() - heartbeat <= IOT_SHM_STALE_MS;
+#endif
+}
+
+void ShmTagTable::heartbeatLoop() {
+    std::unique_lock<std::mutex> lock(heartbeatMtx_);
+    while (!heartbeatCv_.wait_for(lock, std::chrono::milliseconds(IOT_SHM_HEARTBEAT_MS),
+                                  [this] { return heartbeatStop_; })) {
+        atomicAt(header_->heartbeat_ms).store(nowMs(), std::memory_order_relaxed);
+    }
+}
+
+void ShmTagTable::configure(const Config& cfg) {
+    if (configured_) {
+        GLOG_WARN("共享内存标签表已配置，忽略重新配置");
+        return;
+    }
+    configured_ = true;
+    if (cfg.name.empty()) return;
+    capacity_ = std::max<uint32_t>(1, cfg.capacity);
+    uint32_t buckets = 1;
+    while (buckets < capacity_ * 2ull) buckets <<= 1;
+    indexMask_ = buckets - 1;
+
+    const uint64_t slotsOffset = alignUp(sizeof(iot_shm_header));
+    const uint64_t namesOffset = alignUp(slotsOffset + uint64_t{capacity_} * sizeof(iot_shm_slot));
+    const uint64_t indexOffset = alignUp(namesOffset + uint64_t{capacity_} * IOT_SHM_NAME_BYTES);
+    const uint64_t total = alignUp(indexOffset + uint64_t{buckets} * sizeof(uint32_t));
+    if (!create(cfg.name, static_cast<size_t>(total))) {
+        GLOG_ERROR("共享内存标签表 " + cfg.name + " 创建失败，不发布");
+        return;
+    }
+    header_ = reinterpret_cast<iot_shm_header*>(base_);
+    slots_ = reinterpret_cast<iot_shm_slot*>(base_ + slotsOffset);
+    names_ = reinterpret_cast<char*>(base_ + namesOffset);
+    index_ = reinterpret_cast<uint32_t*>(base_ + indexOffset);
+    for (uint32_t i = 0; i < capacity_; ++i) slots_[i].kind = kNoValue;
+
+    header_->version = IOT_SHM_VERSION;
+    header_->capacity = capacity_;
+    header_->index_mask = indexMask_;
+    header_->slots_offset = slotsOffset;
+    header_->names_offset = namesOffset;
+    header_->index_offset = indexOffset;
+    header_->total_size = total;
+#ifdef _WIN32
+    header_->publisher_pid = GetCurrentProcessId();
+#else
+    header_->publisher_pid = static_cast<uint64_t>(::getpid());
+#endif
+    header_->started_ms = nowMs();
+    header_->heartbeat_ms = header_->started_ms;
+    atomicAt(header_->state).store(1, std::memory_order_relaxed);
+    // 魔数最后写入，读取方校验通过即可看到完整的头部
+    atomicAt(header_->magic).store(IOT_SHM_MAGIC, std::memory_order_release);
+    enabled_.store(true, std::memory_order_release);
+    heartbeat_ = std::thread(&ShmTagTable::heartbeatLoop, this);
+    GLOG_INFO("共享内存标签表 " + name_ + "：" + std::to_string(capacity_) + " 个标签，" +
+              std::to_string(total >> 10) + " KB");
+}
+
+void ShmTagTable::beginSlot(iot_shm_slot& s) {
+    auto& seq = atomicAt(s.seq);
+    uint32_t v = seq.load(std::memory_order_relaxed);
+    for (;;) {
+        if (v & 1) {
+            std::this_thread::yield();
+            v = seq.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (seq.compare_exchange_weak(v, v + 1, std::memory_order_acquire, std::memory_order_relaxed)) break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ShmTagTable::endSlot(iot_shm_slot& s) {
+    atomicAt(s.seq).fetch_add(1, std::memory_order_release);
+}
+
+void ShmTagTable::beginIndex() {
+    atomicAt(header_->index_seq).fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ShmTagTable::endIndex() {
+    atomicAt(header_->index_seq).fetch_add(1, std::memory_order_release);
+}
+
+void ShmTagTable::publish(const TagHandle h, const uint8_t kind, const uint64_t bits, const uint8_t quality,
+                          const int64_t tsMs) {
+    if (h >= capacity_) return;
+    iot_shm_slot& s = slots_[h];
+    beginSlot(s);
+    atomicAt(s.kind).store(kind, std::memory_order_relaxed);
+    atomicAt(s.quality).store(quality, std::memory_order_relaxed);
+    atomicAt(s.bits).store(bits, std::memory_order_relaxed);
+    atomicAt(s.ts_ms).store(tsMs, std::memory_order_relaxed);
+    endSlot(s);
+}
+
+void ShmTagTable::insertIndex(const uint32_t slot) {
+    const char* name = names_ + size_t{slot} * IOT_SHM_NAME_BYTES;
+    uint32_t b = static_cast<uint32_t>(iot_shm_hash(name, std::strlen(name))) & indexMask_;
+    for (;;) {
+        auto& e = atomicAt(index_[b]);
+        const uint32_t cur = e.load(std::memory_order_relaxed);
+        if (cur == IOT_SHM_INDEX_EMPTY || cur == IOT_SHM_INDEX_DELETED) {
+            if (cur == IOT_SHM_INDEX_EMPTY) ++indexUsed_;
+            e.store(slot + 1, std::memory_order_relaxed);
+            return;
+        }
+        b = (b + 1) & indexMask_;
+    }
+}
+
+void ShmTagTable::rebuildIndex() {
+    for (uint32_t b = 0; b <= indexMask_; ++b) atomicAt(index_[b]).store(IOT_SHM_INDEX_EMPTY, std::memory_order_relaxed);
+    indexUsed_ = 0;
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        if (atomicAt(slots_[i].gen).load(std::memory_order_relaxed) & 1) insertIndex(i);
+    }
+}
+
+void ShmTagTable::bind(const TagHandle h, const std::string_view id) {
+    if (h >= capacity_ || id.empty() || id.size() >= IOT_SHM_NAME_BYTES) {
+        if (!warnedCapacity_) {
+            warnedCapacity_ = true;
+            GLOG_WARN("标签[" + std::string(id) + "] 超出共享内存标签表容量或 id 过长，未发布（仅提示一次）");
+        }
+        return;
+    }
+    if (atomicAt(slots_[h].gen).load(std::memory_order_relaxed) & 1) unbind(h);
+    iot_shm_slot& s = slots_[h];
+    beginIndex();
+    char* name = names_ + size_t{h} * IOT_SHM_NAME_BYTES;
+    std::memcpy(name, id.data(), id.size());
+    std::memset(name + id.size(), 0, IOT_SHM_NAME_BYTES - id.size());
+    beginSlot(s);
+    atomicAt(s.gen).fetch_add(1, std::memory_order_relaxed);
+    atomicAt(s.kind).store(kNoValue, std::memory_order_relaxed);
+    atomicAt(s.quality).store(IOT_SHM_QUALITY_UNCERTAIN, std::memory_order_relaxed);
+    atomicAt(s.bits).store(0, std::memory_order_relaxed);
+    atomicAt(s.ts_ms).store(0, std::memory_order_relaxed);
+    endSlot(s);
+    // 负载（含删除标记）超过 3/4 时整体重建，去掉删除标记
+    if ((indexUsed_ + 1) * 4ull > (indexMask_ + 1) * 3ull) rebuildIndex();
+    else insertIndex(h);
+    ++bound_;
+    atomicAt(header_->tag_count).store(bound_, std::memory_order_relaxed);
+    endIndex();
+}
+
+void ShmTagTable::unbind(const TagHandle h) {
+    if (h >= capacity_) return;
+    iot_shm_slot& s = slots_[h];
+    if (!(atomicAt(s.gen).load(std::memory_order_relaxed) & 1)) return;
+    beginIndex();
+    char* name = names_ + size_t{h} * IOT_SHM_NAME_BYTES;
+    uint32_t b = static_cast<uint32_t>(iot_shm_hash(name, std::strlen(name))) & indexMask_;
+    for (uint32_t probe = 0; probe <= indexMask_; ++probe, b = (b + 1) & indexMask_) {
+        auto& e = atomicAt(index_[b]);
+        const uint32_t cur = e.load(std::memory_order_relaxed);
+        if (cur == IOT_SHM_INDEX_EMPTY) break;
+        if (cur == h + 1) {
+            e.store(IOT_SHM_INDEX_DELETED, std::memory_order_relaxed);
+            break;
+        }
+    }
+    name[0] = 0;
+    beginSlot(s);
+    atomicAt(s.gen).fetch_add(1, std::memory_order_relaxed);
+    atomicAt(s.kind).store(kNoValue, std::memory_order_relaxed);
+    endSlot(s);
+    --bound_;
+    atomicAt(header_->tag_count).store(bound_, std::memory_order_relaxed);
+    endIndex();
+}
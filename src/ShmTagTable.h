@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "Variable.h"
+#include "shm/iot_shm.h"
+
+// 共享内存标签表：把 TagRegistry 的实时值按句柄发布到命名共享内存段（布局见 shm/iot_shm.h），
+// 同机进程用 shm/iot_shm.c 读取库无锁、无系统调用地读取当前值。
+// 绑定/解绑由 TagRegistry 在注册互斥锁内调用；值写入在标签值槽写锁内调用。
+// 句柄不小于容量或 id 超过 IOT_SHM_NAME_BYTES - 1 字节的标签不发布。
+// 发布的是值槽中的最新值，有意不经过例外/旋转门压缩：共享内存是当前值镜像，读取方按需取值，
+// 不存在按变化推送的带宽问题；压缩只作用于变化序号、变化日志、历史与按变化推送的下游
+class ShmTagTable {
+public:
+    struct Config {
+        std::string name;                   // 为空表示不发布
+        uint32_t capacity = 65536;          // 值槽数
+    };
+
+    static ShmTagTable& instance();
+    ~ShmTagTable();
+    ShmTagTable(const ShmTagTable&) = delete;
+    ShmTagTable& operator=(const ShmTagTable&) = delete;
+
+    // 须在注册首个标签前调用（启动时加载设备之前），之后调用会被忽略；创建失败只记录日志
+    void configure(const Config& cfg);
+    [[nodiscard]] bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void bind(TagHandle h, std::string_view id);
+    void unbind(TagHandle h);
+    // kind 为 Variable::ValueType 下标，TagRegistry::kNoValue 表示无值
+    void publish(TagHandle h, uint8_t kind, uint64_t bits, uint8_t quality, int64_t tsMs);
+
+private:
+    ShmTagTable() = default;
+
+    bool create(const std::string& name, size_t bytes);
+    // 同名段已存在时判断其发布进程是否仍在运行；仍在运行则不接管
+    bool ownerAlive(int fd) const;
+    void heartbeatLoop();
+    void beginSlot(iot_shm_slot& s);
+    void endSlot(iot_shm_slot& s);
+    void beginIndex();
+    void endIndex();
+    void insertIndex(uint32_t slot);
+    void rebuildIndex();
+
+    std::atomic<bool> enabled_{false};
+    bool configured_ = false;
+    std::string name_;
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    iot_shm_header* header_ = nullptr;
+    iot_shm_slot* slots_ = nullptr;
+    char* names_ = nullptr;
+    uint32_t* index_ = nullptr;
+    uint32_t capacity_ = 0;
+    uint32_t indexMask_ = 0;
+    std::thread heartbeat_;
+    std::mutex heartbeatMtx_;
+    std::condition_variable heartbeatCv_;
+    bool heartbeatStop_ = false;
+    // 以下在注册互斥锁内访问
+    uint32_t indexUsed_ = 0;                // 含已删除标记
+    uint32_t bound_ = 0;
+    bool warnedCapacity_ = false;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string_view>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// HttpServer / WebSocketHub 共用的套接字封装；句柄统一以 uintptr_t 保存，头文件不暴露平台类型
+namespace net {
+
+constexpr uintptr_t kNoSocket = ~uintptr_t{0};
+
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+inline int pollSockets(pollfd* fds, const size_t n, const int timeoutMs) {
+    return WSAPoll(fds, static_cast<ULONG>(n), timeoutMs);
+}
+#else
+using NativeSocket = int;
+inline int pollSockets(pollfd* fds, const size_t n, const int timeoutMs) {
+    return ::poll(fds, static_cast<nfds_t>(n), timeoutMs);
+}
+#endif
+
+inline NativeSocket native(const uintptr_t fd) { return static_cast<NativeSocket>(fd); }
+
+inline void closeSocket(const uintptr_t fd) {
+#ifdef _WIN32
+    closesocket(native(fd));
+#else
+    ::close(native(fd));
+#endif
+}
+
+inline void setRecvTimeout(const uintptr_t fd, const int ms) {
+#ifdef _WIN32
+    const DWORD tv = ms;
+#else
+    timeval tv{ms / 1000, (ms % 1000) * 1000};
+#endif
+    setsockopt(native(fd), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+}
+
+inline void setNonBlocking(const uintptr_t fd) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(native(fd), FIONBIO, &on);
+#else
+    ::fcntl(native(fd), F_SETFL, ::fcntl(native(fd), F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+inline bool wouldBlock() {
+#ifdef _WIN32
+    const int err = WSAGetLastError();
+    return err == WSAEWOULDBLOCK || err == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// 返回 >0 为读到的字节数，0 为对端关闭，-1 为超时/暂无数据，-2 为错误
+inline int recvSome(const uintptr_t fd, char* buf, const int len) {
+    const int n = ::recv(native(fd), buf, len, 0);
+    if (n >= 0) return n;
+    return wouldBlock() ? -1 : -2;
+}
+
+// 返回已发送字节数；非阻塞套接字缓冲区满时可能少于 data.size()，出错返回 -1
+inline long long sendSome(const uintptr_t fd, std::string_view data) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    long long total = 0;
+    while (!data.empty()) {
+        const int n = ::send(native(fd), data.data(), static_cast<int>(std::min<size_t>(data.size(), 1 << 30)), flags);
+        if (n < 0) return wouldBlock() ? total : -1;
+        if (n == 0) break;
+        total += n;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return total;
+}
+
+inline bool sendAll(const uintptr_t fd, const std::string_view data) {
+    return sendSome(fd, data) == static_cast<long long>(data.size());
+}
+
+} // namespace net
@@ -0,0 +1,182 @@
+#include "TagCompressor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "TagRegistry.h"
+
+TagCompressor& TagCompressor::instance() {
+    static TagCompressor compressor;
+    return compressor;
+}
+
+TagCompressor::~TagCompressor() {
+    for (auto& b : blocks_) delete b.load();
+}
+
+TagCompressor::State* TagCompressor::find(const TagHandle h) const {
+    const uint32_t b = h >> kBlockBits;
+    if (b >= kMaxBlocks) return nullptr;
+    Block* block = blocks_[b].load(std::memory_order_acquire);
+    return block ? &block->states[h & (kBlockSize - 1)] : nullptr;
+}
+
+TagCompressor::Published* TagCompressor::findPublished(const TagHandle h) const {
+    const uint32_t b = h >> kBlockBits;
+    if (b >= kMaxBlocks) return nullptr;
+    Block* block = blocks_[b].load(std::memory_order_acquire);
+    return block ? &block->published[h & (kBlockSize - 1)] : nullptr;
+}
+
+void TagCompressor::publish(Published& slot, const Point* p) {
+    if (!p) {
+        slot.kind.store(kNone, std::memory_order_relaxed);
+        return;
+    }
+    slot.bits.store(p->bits, std::memory_order_relaxed);
+    slot.ts.store(p->ts, std::memory_order_relaxed);
+    slot.quality.store(p->quality, std::memory_order_relaxed);
+    slot.kind.store(p->kind, std::memory_order_relaxed);
+}
+
+bool TagCompressor::published(const TagHandle h, Point& out) const {
+    const Published* slot = findPublished(h);
+    if (!slot) return false;
+    out.kind = slot->kind.load(std::memory_order_relaxed);
+    if (out.kind == kNone) return false;
+    out.bits = slot->bits.load(std::memory_order_relaxed);
+    out.ts = slot->ts.load(std::memory_order_relaxed);
+    out.quality = slot->quality.load(std::memory_order_relaxed);
+    return true;
+}
+
+void TagCompressor::configure(const TagHandle h, const CompressionParams& params) {
+    State* s = find(h);
+    if (!params.enabled()) {
+        if (s && s->enabled) {
+            s->enabled = false;
+            publish(*findPublished(h), nullptr);
+            tags_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (!s) {
+        std::lock_guard<std::mutex> lock(blockMtx_);
+        auto& slot = blocks_[h >> kBlockBits];
+        if (!slot.load(std::memory_order_relaxed)) slot.store(new Block(), std::memory_order_release);
+        s = &slot.load(std::memory_order_relaxed)->states[h & (kBlockSize - 1)];
+    }
+    if (s->enabled && s->params == params) return;
+    if (!s->enabled) tags_.fetch_add(1, std::memory_order_relaxed);
+    *s = State{};
+    publish(*findPublished(h), nullptr);
+    s->params = params;
+    s->maxInterval = static_cast<double>(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::milliseconds(std::max(0, params.max_interval_ms))).count());
+    s->enabled = true;
+}
+
+void TagCompressor::restart(const TagHandle h) {
+    State* s = find(h);
+    if (!s || !s->enabled) return;
+    const CompressionParams params = s->params;
+    const double maxInterval = s->maxInterval;
+    *s = State{};
+    s->params = params;
+    s->maxInterval = maxInterval;
+    s->enabled = true;
+    publish(*findPublished(h), nullptr);
+}
+
+bool TagCompressor::active(const TagHandle h) const {
+    const State* s = find(h);
+    return s && s->enabled;
+}
+
+void TagCompressor::emit(State& s, const Sample& p, Output& out) {
+    out.points[out.count++] = p.raw;
+    s.archive = p;
+    s.hasArchive = true;
+    s.hasHeld = false;
+}
+
+void TagCompressor::door(State& s, const Sample& p, Output& out) {
+    if (!s.hasArchive) {
+        emit(s, p, out);
+        return;
+    }
+    const uint8_t lastQuality = s.hasHeld ? s.held.raw.quality : s.archive.raw.quality;
+    const auto dt = static_cast<double>(p.raw.ts - s.archive.raw.ts);
+    // 品质变化、超过最长间隔、非有限值或时间回退时，先输出暂存点再输出当前点
+    if (p.raw.quality != lastQuality || (s.maxInterval > 0 && dt >= s.maxInterval) || s.params.comp_dev <= 0 ||
+        !std::isfinite(p.value) || !std::isfinite(s.archive.value) || dt <= 0) {
+        if (s.hasHeld) emit(s, s.held, out);
+        emit(s, p, out);
+        return;
+    }
+    const double dev = s.params.comp_dev;
+    const double up = (p.value + dev - s.archive.value) / dt;
+    const double low = (p.value - dev - s.archive.value) / dt;
+    // 以轴点到当前样本的连线落在之前所有样本构成的门内为准（比只看门是否交叉更严），
+    // 保证轴点与下一个输出点之间的线性插值与任一原始样本相差不超过 comp_dev
+    const double slope = (p.value - s.archive.value) / dt;
+    if (!s.hasHeld) {
+        s.upper = up;
+        s.lower = low;
+    } else if (slope >= s.lower && slope <= s.upper) {
+        s.upper = std::min(s.upper, up);
+        s.lower = std::max(s.lower, low);
+    } else {
+        // 门已关闭：暂存的前一个样本成为新的轴点，当前样本重新开门
+        emit(s, s.held, out);
+        const auto dt2 = static_cast<double>(p.raw.ts - s.archive.raw.ts);
+        if (dt2 <= 0) {
+            emit(s, p, out);
+            return;
+        }
+        s.upper = (p.value + dev - s.archive.value) / dt2;
+        s.lower = (p.value - dev - s.archive.value) / dt2;
+    }
+    s.held = p;
+    s.hasHeld = true;
+}
+
+bool TagCompressor::filter(const TagHandle h, const uint8_t kind, const uint64_t bits, const uint8_t quality,
+                           const int64_t ts, Output& out) {
+    State* s = find(h);
+    if (!s || !s->enabled) return false;
+    Sample p;
+    if (!TagRegistry::toDouble(kind, bits, p.value)) {
+        // 非数值按普通写入处理，下游改读值槽
+        publish(*findPublished(h), nullptr);
+        return false;
+    }
+    p.raw = {kind, bits, quality, ts};
+    samplesIn_.fetch_add(1, std::memory_order_relaxed);
+
+    if (s->params.exc_dev > 0) {
+        const bool within = s->hasException && std::abs(p.value - s->exception.value) <= s->params.exc_dev &&
+                            quality == s->exception.raw.quality &&
+                            (s->maxInterval <= 0 || static_cast<double>(ts - s->exception.raw.ts) < s->maxInterval);
+        if (within) {
+            s->skipped = p;
+            s->hasSkipped = true;
+            return true;
+        }
+        // 例外发生时补送其前一个样本，保留阶跃的起点
+        if (s->hasSkipped) {
+            door(*s, s->skipped, out);
+            s->hasSkipped = false;
+        }
+        s->exception = p;
+        s->hasException = true;
+    }
+    door(*s, p, out);
+    if (out.count > 0) publish(*findPublished(h), &out.points[out.count - 1]);
+    samplesOut_.fetch_add(out.count, std::memory_order_relaxed);
+    return true;
+}
+
+TagCompressor::Stats TagCompressor::getStats() const {
+    return {tags_.load(std::memory_order_relaxed), samplesIn_.load(std::memory_order_relaxed),
+            samplesOut_.load(std::memory_order_relaxed)};
+}
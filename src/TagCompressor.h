@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "Variable.h"
+
+// 压缩参数（工程单位）：exc_dev 为例外偏差，comp_dev 为旋转门压缩偏差，
+// max_interval_ms 为两次输出之间的最长间隔（0 表示不限）；exc_dev 与 comp_dev 都为 0 时不压缩
+struct CompressionParams {
+    double exc_dev = 0.0;
+    double comp_dev = 0.0;
+    int max_interval_ms = 0;
+
+    [[nodiscard]] bool enabled() const { return exc_dev > 0 || comp_dev > 0; }
+    bool operator==(const CompressionParams& o) const {
+        return exc_dev == o.exc_dev && comp_dev == o.comp_dev && max_interval_ms == o.max_interval_ms;
+    }
+};
+
+// 流式数据压缩：先做例外过滤（与上次通过值相差不超过 exc_dev 的样本丢弃，
+// 出现例外时连同其前一个被丢弃的样本一起送入下一级），再做旋转门压缩
+// （以最近输出点为轴，样本落在 ±comp_dev 构成的门内时只暂存，门关闭时输出暂存的前一个样本）。
+// 只用旋转门时，相邻输出点之间的线性插值与任一原始样本相差不超过 comp_dev；
+// 叠加例外过滤时，被过滤样本另有不超过 exc_dev 的偏差（相对其前一个通过值）。
+// 每个标签状态 O(1)。TagRegistry 在持有标签写锁时调用，值槽始终保存最新值，
+// 只有输出的点才分配变化序号、进入变化日志与内存历史；最近一个输出点另存于发布槽，
+// 按变化取值的下游（长轮询、WebSocket、计算标签）经 TagRegistry::loadPublished 读取它，
+// 因此看到的都是压缩后的序列。品质变化时立即输出暂存点与当前点
+class TagCompressor {
+public:
+    struct Point {
+        uint8_t kind = 0;
+        uint64_t bits = 0;
+        uint8_t quality = 0;
+        int64_t ts = 0;                    // system_clock 计数
+    };
+    // 一次输入最多产生 4 个输出点：例外补发的前一个样本及其触发的暂存点，当前样本及其触发的暂存点
+    struct Output {
+        Point points[4];
+        uint32_t count = 0;
+    };
+    struct Stats {
+        size_t tags = 0;
+        uint64_t samplesIn = 0;
+        uint64_t samplesOut = 0;
+    };
+
+    static TagCompressor& instance();
+    ~TagCompressor();
+    TagCompressor(const TagCompressor&) = delete;
+    TagCompressor& operator=(const TagCompressor&) = delete;
+
+    // 以下均由 TagRegistry 在持有该标签写锁时调用
+    // 参数变化时重置状态，参数未启用时移除
+    void configure(TagHandle h, const CompressionParams& params);
+    // 标签值被清空时调用：丢弃暂存点与发布点，压缩参数保持不变
+    void restart(TagHandle h);
+    [[nodiscard]] bool active(TagHandle h) const;
+    // 返回 false 表示该值不参与压缩（字符串等），调用方按普通写入处理
+    bool filter(TagHandle h, uint8_t kind, uint64_t bits, uint8_t quality, int64_t ts, Output& out);
+    // 最近一个输出点；未启用压缩或尚无输出时返回 false。无锁读取，由 TagRegistry 在值槽 seqlock 内调用
+    bool published(TagHandle h, Point& out) const;
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    TagCompressor() = default;
+
+    struct Sample {
+        double value = 0;
+        Point raw;
+    };
+    struct State {
+        CompressionParams params;
+        double maxInterval = 0;            // system_clock 计数，0 表示不限
+        bool enabled = false;
+        // 例外过滤
+        bool hasException = false;
+        bool hasSkipped = false;
+        Sample exception;
+        Sample skipped;
+        // 旋转门
+        bool hasArchive = false;
+        bool hasHeld = false;
+        Sample archive;
+        Sample held;
+        double upper = 0;                  // 门的上下斜率（值 / 时间计数）
+        double lower = 0;
+    };
+    // 发布槽：写锁内写入，读取方无锁读取
+    struct Published {
+        std::atomic<uint8_t> kind{kNone};
+        std::atomic<uint8_t> quality{0};
+        std::atomic<uint64_t> bits{0};
+        std::atomic<int64_t> ts{0};
+    };
+    static constexpr uint8_t kNone = 0xFF;
+    static constexpr uint32_t kBlockBits = 12;
+    static constexpr uint32_t kBlockSize = 1u << kBlockBits;
+    static constexpr uint32_t kMaxBlocks = 4096;
+    struct Block {
+        State states[kBlockSize];
+        Published published[kBlockSize];
+    };
+
+    [[nodiscard]] State* find(TagHandle h) const;
+    [[nodiscard]] Published* findPublished(TagHandle h) const;
+    static void publish(Published& slot, const Point* p);
+    void door(State& s, const Sample& p, Output& out);
+    static void emit(State& s, const Sample& p, Output& out);
+
+    std::array<std::atomic<Block*>, kMaxBlocks> blocks_{};
+    std::mutex blockMtx_;
+    std::atomic<size_t> tags_{0};
+    std::atomic<uint64_t> samplesIn_{0};
+    std::atomic<uint64_t> samplesOut_{0};
+};
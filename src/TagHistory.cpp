@@ -0,0 +1,328 @@
+#include "TagHistory.h"
+#include <cstring>
+#include <thread>
+#include "Logger.h"
+#include "TagRegistry.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// 单个样本最多占用的位数：时间 4+64，值 2+5+6+64，品质 3
+constexpr uint32_t kMaxSampleBits = 148;
+
+int leadingZeros(const uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return 63 - static_cast<int>(i);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+int trailingZeros(const uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return static_cast<int>(i);
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+uint64_t lowMask(const int n) { return n >= 64 ? ~0ULL : (1ULL << n) - 1; }
+
+// 位流按高位在前写入；块在复用时已清零，这里只做按位或
+void putBits(std::atomic<uint64_t>* words, uint32_t& pos, const uint64_t v, int n) {
+    while (n > 0) {
+        const uint32_t w = pos >> 6;
+        const int room = 64 - static_cast<int>(pos & 63);
+        const int take = n < room ? n : room;
+        const uint64_t part = (v >> (n - take)) & lowMask(take);
+        words[w].store(words[w].load(std::memory_order_relaxed) | (part << (room - take)), std::memory_order_relaxed);
+        pos += take;
+        n -= take;
+    }
+}
+
+uint64_t getBits(const std::atomic<uint64_t>* words, uint32_t& pos, int n) {
+    uint64_t v = 0;
+    while (n > 0) {
+        const uint32_t w = pos >> 6;
+        const int room = 64 - static_cast<int>(pos & 63);
+        const int take = n < room ? n : room;
+        const uint64_t part = (words[w].load(std::memory_order_relaxed) >> (room - take)) & lowMask(take);
+        v = take >= 64 ? part : (v << take) | part;
+        pos += take;
+        n -= take;
+    }
+    return v;
+}
+
+} // namespace
+
+TagHistory& TagHistory::instance() {
+    static TagHistory history;
+    return history;
+}
+
+TagHistory::~TagHistory() {
+    for (auto& b : blocks_) {
+        Block* block = b.load();
+        if (!block) continue;
+        for (auto& s : block->series) {
+            for (auto& c : s.ring) delete c.load();
+        }
+        delete block;
+    }
+}
+
+void TagHistory::configure(const Config& cfg) {
+    if (configured_) return;
+    configured_ = true;
+    retentionMs_ = static_cast<int64_t>(cfg.retentionSec) * 1000;
+    maxBytes_ = cfg.maxBytes;
+    enabled_.store(cfg.retentionSec > 0, std::memory_order_release);
+}
+
+TagHistory::Series* TagHistory::find(const TagHandle h) const {
+    const uint32_t b = h >> kBlockBits;
+    if (b >= kMaxBlocks) return nullptr;
+    Block* block = blocks_[b].load(std::memory_order_acquire);
+    return block ? &block->series[h & (kBlockSize - 1)] : nullptr;
+}
+
+TagHistory::Series& TagHistory::series(const TagHandle h) {
+    if (Series* s = find(h)) return *s;
+    std::lock_guard<std::mutex> lock(blockMtx_);
+    auto& slot = blocks_[h >> kBlockBits];
+    if (!slot.load(std::memory_order_relaxed)) {
+        slot.store(new Block(), std::memory_order_release);
+        bytes_.fetch_add(sizeof(Block), std::memory_order_relaxed);
+    }
+    return slot.load(std::memory_order_relaxed)->series[h & (kBlockSize - 1)];
+}
+
+void TagHistory::resetChunk(Chunk& c, const int64_t tsMs) {
+    c.epoch.fetch_add(1, std::memory_order_acq_rel);
+    for (auto& w : c.words) w.store(0, std::memory_order_relaxed);
+    c.bitLen.store(0, std::memory_order_relaxed);
+    c.count.store(0, std::memory_order_relaxed);
+    c.firstTs.store(tsMs, std::memory_order_relaxed);
+    c.lastTs.store(tsMs, std::memory_order_relaxed);
+    c.epoch.fetch_add(1, std::memory_order_release);
+}
+
+TagHistory::Chunk* TagHistory::nextChunk(Series& s, const int64_t tsMs) {
+    const uint32_t layout = s.layout.load(std::memory_order_relaxed);
+    uint32_t n = layout >> 16;
+    uint32_t cur = layout & 0xFFFF;
+    const bool budget = bytes_.load(std::memory_order_relaxed) + sizeof(Chunk) <= maxBytes_;
+    if (!budget && !budgetWarned_.exchange(true, std::memory_order_relaxed)) {
+        GLOG_WARN("内存历史已达上限 " + std::to_string(maxBytes_ >> 20) + "MB（" +
+                  std::to_string(chunks_.load(std::memory_order_relaxed)) + " 块），此后各标签复用自身最旧块，" +
+                  "保留时长可能不足 " + std::to_string(retentionMs_ / 1000) + " 秒，请调大 history_max_mb");
+    }
+    bool grow = n == 0;
+    if (n > 0 && n < kMaxChunks && cur == n - 1 && budget) {
+        // 最旧块已超出保留时长时直接复用，单个标签的内存随其写入频率自适应
+        const Chunk* oldest = s.ring[(cur + 1) % n].load(std::memory_order_relaxed);
+        grow = oldest->lastTs.load(std::memory_order_relaxed) >= tsMs - retentionMs_;
+    }
+    Chunk* c;
+    if (grow) {
+        // 首块不受上限约束：上限耗尽后注册的标签也保留最近的数据
+        c = new Chunk();
+        c->firstTs.store(tsMs, std::memory_order_relaxed);
+        c->lastTs.store(tsMs, std::memory_order_relaxed);
+        bytes_.fetch_add(sizeof(Chunk), std::memory_order_relaxed);
+        chunks_.fetch_add(1, std::memory_order_relaxed);
+        if (n == 0) seriesCount_.fetch_add(1, std::memory_order_relaxed);
+        s.ring[n].store(c, std::memory_order_release);
+        cur = n++;
+    } else {
+        // 先标记复用再清空块：读取方读到清空后的数据时必然看到 layout 已变化
+        s.layout.store(layout | kLayoutBusy, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        cur = (cur + 1) % n;
+        c = s.ring[cur].load(std::memory_order_relaxed);
+        resetChunk(*c, tsMs);
+    }
+    s.layout.store(n << 16 | cur, std::memory_order_release);
+    return c;
+}
+
+void TagHistory::append(const TagHandle h, const uint8_t kind, const uint64_t bits, const VarQuality quality,
+                        const int64_t tsMs) {
+    double value;
+    if (!TagRegistry::toDouble(kind, bits, value)) return;
+    uint64_t vbits;
+    std::memcpy(&vbits, &value, sizeof(vbits));
+    const auto q = static_cast<uint8_t>(quality);
+
+    Series& s = series(h);
+    const uint32_t layout = s.layout.load(std::memory_order_relaxed);
+    Chunk* c = layout >> 16 ? s.ring[layout & 0xFFFF].load(std::memory_order_relaxed) : nullptr;
+    uint32_t pos = c ? c->bitLen.load(std::memory_order_relaxed) : 0;
+    if (c && pos > 0 && pos + kMaxSampleBits > kChunkWords * 64) c = nullptr;
+    if (!c) {
+        c = nextChunk(s, tsMs);
+        if (!c) return;
+        pos = 0;
+    } else if (pos == 0) {
+        resetChunk(*c, tsMs);
+    }
+
+    if (pos == 0) {
+        // 块内首个样本：时间在块头，值与品质原样写入
+        putBits(c->words, pos, vbits, 64);
+        putBits(c->words, pos, q, 2);
+        s.prevDelta = 0;
+        s.prevLeading = 0xFF;
+    } else {
+        const int64_t delta = tsMs - s.prevTs;
+        const int64_t dod = delta - s.prevDelta;
+        if (dod == 0) {
+            putBits(c->words, pos, 0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            putBits(c->words, pos, 0b10, 2);
+            putBits(c->words, pos, static_cast<uint64_t>(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            putBits(c->words, pos, 0b110, 3);
+            putBits(c->words, pos, static_cast<uint64_t>(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            putBits(c->words, pos, 0b1110, 4);
+            putBits(c->words, pos, static_cast<uint64_t>(dod + 2047), 12);
+        } else {
+            putBits(c->words, pos, 0b1111, 4);
+            putBits(c->words, pos, static_cast<uint64_t>(dod), 64);
+        }
+        s.prevDelta = delta;
+
+        const uint64_t x = vbits ^ s.prevBits;
+        if (x == 0) {
+            putBits(c->words, pos, 0, 1);
+        } else {
+            const int leading = std::min(leadingZeros(x), 31);
+            const int trailing = trailingZeros(x);
+            if (s.prevLeading != 0xFF && leading >= s.prevLeading && trailing >= s.prevTrailing) {
+                // 有效位落在上一个窗口内，沿用窗口
+                putBits(c->words, pos, 0b10, 2);
+                putBits(c->words, pos, x >> s.prevTrailing, 64 - s.prevLeading - s.prevTrailing);
+            } else {
+                const int len = 64 - leading - trailing;
+                putBits(c->words, pos, 0b11, 2);
+                putBits(c->words, pos, static_cast<uint64_t>(leading), 5);
+                putBits(c->words, pos, static_cast<uint64_t>(len - 1), 6);
+                putBits(c->words, pos, x >> trailing, len);
+                s.prevLeading = static_cast<uint8_t>(leading);
+                s.prevTrailing = static_cast<uint8_t>(trailing);
+            }
+        }
+
+        if (q == s.prevQuality) {
+            putBits(c->words, pos, 0, 1);
+        } else {
+            putBits(c->words, pos, 1, 1);
+            putBits(c->words, pos, q, 2);
+        }
+    }
+    s.prevTs = tsMs;
+    s.prevBits = vbits;
+    s.prevQuality = q;
+    c->lastTs.store(tsMs, std::memory_order_relaxed);
+    c->count.store(c->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    c->bitLen.store(pos, std::memory_order_release);
+    samples_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TagHistory::reset(const TagHandle h) {
+    Series* s = find(h);
+    if (!s) return;
+    const uint32_t n = s->layout.load(std::memory_order_relaxed) >> 16;
+    for (uint32_t i = 0; i < n; ++i) resetChunk(*s->ring[i].load(std::memory_order_relaxed), 0);
+    s->prevLeading = 0xFF;
+}
+
+void TagHistory::decode(const Chunk& c, const uint32_t bitLen, const int64_t fromMs, const int64_t toMs,
+                        std::vector<Point>& out) {
+    uint32_t pos = 0;
+    int64_t ts = c.firstTs.load(std::memory_order_relaxed);
+    int64_t delta = 0;
+    uint64_t vbits = getBits(c.words, pos, 64);
+    auto q = static_cast<uint8_t>(getBits(c.words, pos, 2));
+    int leading = 0, trailing = 0;
+    for (;;) {
+        if (ts > toMs) return;
+        if (ts >= fromMs) {
+            double v;
+            std::memcpy(&v, &vbits, sizeof(v));
+            out.push_back({ts, v, static_cast<VarQuality>(q)});
+        }
+        if (pos >= bitLen) return;
+
+        int64_t dod;
+        if (getBits(c.words, pos, 1) == 0) dod = 0;
+        else if (getBits(c.words, pos, 1) == 0) dod = static_cast<int64_t>(getBits(c.words, pos, 7)) - 63;
+        else if (getBits(c.words, pos, 1) == 0) dod = static_cast<int64_t>(getBits(c.words, pos, 9)) - 255;
+        else if (getBits(c.words, pos, 1) == 0) dod = static_cast<int64_t>(getBits(c.words, pos, 12)) - 2047;
+        else dod = static_cast<int64_t>(getBits(c.words, pos, 64));
+        delta += dod;
+        ts += delta;
+
+        if (getBits(c.words, pos, 1) != 0) {
+            if (getBits(c.words, pos, 1) != 0) {
+                leading = static_cast<int>(getBits(c.words, pos, 5));
+                const int len = static_cast<int>(getBits(c.words, pos, 6)) + 1;
+                trailing = 64 - leading - len;
+            }
+            vbits ^= getBits(c.words, pos, 64 - leading - trailing) << trailing;
+        }
+        if (getBits(c.words, pos, 1) != 0) q = static_cast<uint8_t>(getBits(c.words, pos, 2));
+    }
+}
+
+bool TagHistory::query(const TagHandle h, const int64_t fromMs, const int64_t toMs, const size_t maxPoints,
+                       std::vector<Point>& out) const {
+    const Series* s = find(h);
+    if (!s) return false;
+    const size_t base = out.size();
+    for (;;) {
+        const uint32_t layout = s->layout.load(std::memory_order_acquire);
+        if (layout & kLayoutBusy) {
+            std::this_thread::yield();
+            continue;
+        }
+        const uint32_t n = layout >> 16;
+        const uint32_t cur = layout & 0xFFFF;
+        // 从最旧块（cur 之后）依次读到当前块
+        for (uint32_t k = 1; k <= n && out.size() - base <= maxPoints; ++k) {
+            const Chunk* c = s->ring[(cur + k) % n].load(std::memory_order_acquire);
+            const uint32_t e1 = c->epoch.load(std::memory_order_acquire);
+            if (e1 & 1) continue;
+            const uint32_t bitLen = c->bitLen.load(std::memory_order_acquire);
+            if (bitLen == 0 || c->lastTs.load(std::memory_order_relaxed) < fromMs ||
+                c->firstTs.load(std::memory_order_relaxed) > toMs) continue;
+            const size_t mark = out.size();
+            decode(*c, bitLen, fromMs, toMs, out);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (c->epoch.load(std::memory_order_relaxed) != e1) out.resize(mark);
+        }
+        // 读取期间有块被复用：按快照顺序输出会把复用块中的新数据排在最前，重读
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->layout.load(std::memory_order_relaxed) == layout) break;
+        out.resize(base);
+    }
+    if (out.size() - base > maxPoints) {
+        out.resize(base + maxPoints);
+        return true;
+    }
+    return false;
+}
+
+TagHistory::Stats TagHistory::getStats() const {
+    return {seriesCount_.load(std::memory_order_relaxed), chunks_.load(std::memory_order_relaxed),
+            bytes_.load(std::memory_order_relaxed), samples_.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "Variable.h"
+
+// 内存历史：每个数值标签的每次写入按 Gorilla 方式压缩（时间戳二阶差分 + 值的 XOR 编码，
+// 品质变化时另记 2 位）到定长块中，每个标签最多 kMaxChunks 块循环使用。
+// 最旧块的最后时间早于保留时长、或总内存达到上限时复用最旧块，否则分配新块；
+// 每个标签的首块不受内存上限约束，上限耗尽后新标签仍保留最近一块，首次耗尽时输出告警。
+// 写入在 TagRegistry 值槽的写锁内进行，每个标签同一时刻只有一个写入方，无需另加锁；
+// 读取方无锁：块带 epoch，复用时先置奇数，读取前后 epoch 不一致的块丢弃（其数据已过期）。
+// 字符串值不记录；值统一按 double 保存
+class TagHistory {
+public:
+    struct Config {
+        uint32_t retentionSec = 0;          // 0 表示不记录
+        uint64_t maxBytes = 1024ull << 20;
+    };
+    struct Point {
+        int64_t tsMs = 0;
+        double value = 0;
+        VarQuality quality = VarQuality::GOOD;
+    };
+    struct Stats {
+        size_t series = 0;
+        size_t chunks = 0;
+        uint64_t bytes = 0;
+        uint64_t samples = 0;
+    };
+
+    static constexpr uint32_t kChunkWords = 60;     // 每块 480 字节位流，加块头约 512 字节
+    static constexpr uint32_t kMaxChunks = 32;
+
+    static TagHistory& instance();
+    ~TagHistory();
+    TagHistory(const TagHistory&) = delete;
+    TagHistory& operator=(const TagHistory&) = delete;
+
+    // 须在首次写入前调用（启动时加载设备之前），之后调用会被忽略
+    void configure(const Config& cfg);
+    [[nodiscard]] bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 由 TagRegistry 在持有该标签写锁时调用；kind 为 Variable::ValueType 下标
+    void append(TagHandle h, uint8_t kind, uint64_t bits, VarQuality quality, int64_t tsMs);
+    // 标签被清空（删除变量、句柄即将复用）时丢弃其历史，同样在写锁内调用
+    void reset(TagHandle h);
+
+    // 取 [fromMs, toMs] 内的点，按时间升序，最多 maxPoints 个；超过时返回 true（截断）
+    bool query(TagHandle h, int64_t fromMs, int64_t toMs, size_t maxPoints, std::vector<Point>& out) const;
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    TagHistory() = default;
+
+    struct Chunk {
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> bitLen{0};
+        std::atomic<uint32_t> count{0};
+        std::atomic<int64_t> firstTs{0};
+        std::atomic<int64_t> lastTs{0};
+        std::atomic<uint64_t> words[kChunkWords];
+    };
+    struct Series {
+        // 低 16 位为当前块下标，高 16 位为已分配块数；块按下标环形排列，cur 之后即最旧块。
+        // 复用块期间置 kLayoutBusy，读取方据 layout 前后是否一致判断读取期间有无块被复用
+        std::atomic<uint32_t> layout{0};
+        std::atomic<Chunk*> ring[kMaxChunks];
+        // 以下仅写入方使用
+        int64_t prevTs = 0;
+        int64_t prevDelta = 0;
+        uint64_t prevBits = 0;
+        uint8_t prevQuality = 0;
+        uint8_t prevLeading = 0xFF;         // 0xFF 表示尚无可复用的有效位窗口
+        uint8_t prevTrailing = 0;
+    };
+    static constexpr uint32_t kLayoutBusy = 0x8000;
+    static constexpr uint32_t kBlockBits = 12;
+    static constexpr uint32_t kBlockSize = 1u << kBlockBits;
+    static constexpr uint32_t kMaxBlocks = 4096;
+    struct Block {
+        Series series[kBlockSize];
+    };
+
+    Series* find(TagHandle h) const;
+    Series& series(TagHandle h);
+    Chunk* nextChunk(Series& s, int64_t tsMs);
+    static void resetChunk(Chunk& c, int64_t tsMs);
+    static void decode(const Chunk& c, uint32_t bitLen, int64_t fromMs, int64_t toMs, std::vector<Point>& out);
+
+    std::atomic<bool> enabled_{false};
+    bool configured_ = false;
+    int64_t retentionMs_ = 0;
+    uint64_t maxBytes_ = 0;
+    std::array<std::atomic<Block*>, kMaxBlocks> blocks_{};
+    std::mutex blockMtx_;
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<size_t> chunks_{0};
+    std::atomic<size_t> seriesCount_{0};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<bool> budgetWarned_{false};
+};
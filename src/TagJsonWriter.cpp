@@ -0,0 +1,104 @@
+#include "TagJsonWriter.h"
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+constexpr char kHex[] = "0123456789abcdef";
+}
+
+const char* TagJsonWriter::qualityName(const VarQuality q) {
+    switch (q) {
+        case VarQuality::GOOD: return "GOOD";
+        case VarQuality::BAD:  return "BAD";
+        default:               return "UNCERTAIN";
+    }
+}
+
+void TagJsonWriter::string(const std::string_view s) {
+    out_.push_back('"');
+    size_t plain = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const auto c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out_.append(s.data() + plain, i - plain);
+        plain = i + 1;
+        switch (c) {
+            case '"':  out_.append("\\\""); break;
+            case '\\': out_.append("\\\\"); break;
+            case '\n': out_.append("\\n"); break;
+            case '\r': out_.append("\\r"); break;
+            case '\t': out_.append("\\t"); break;
+            default: {
+                const char esc[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                out_.append(esc, sizeof(esc));
+            }
+        }
+    }
+    out_.append(s.data() + plain, s.size() - plain);
+    out_.push_back('"');
+}
+
+void TagJsonWriter::number(const int64_t v) {
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out_.append(buf, res.ptr);
+}
+
+void TagJsonWriter::number(const uint64_t v) {
+    char buf[24];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out_.append(buf, res.ptr);
+}
+
+void TagJsonWriter::number(const double v) {
+    // JSON 不能表示 NaN/Inf
+    if (!std::isfinite(v)) {
+        out_.append("null");
+        return;
+    }
+    char buf[32];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out_.append(buf, res.ptr);
+}
+
+void TagJsonWriter::value(const Variable::ValueType& value) {
+    std::visit([this](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::string>) string(v);
+        else if constexpr (std::is_same_v<T, bool>) out_.append(v ? "true" : "false");
+        else if constexpr (std::is_same_v<T, float>) {
+            if (!std::isfinite(v)) { out_.append("null"); return; }
+            char buf[24];
+            const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+            out_.append(buf, res.ptr);
+        }
+        else if constexpr (std::is_same_v<T, double>) number(v);
+        else if constexpr (std::is_signed_v<T>) number(static_cast<int64_t>(v));
+        else number(static_cast<uint64_t>(v));
+    }, value);
+}
+
+void TagJsonWriter::tag(const TagHandle h) {
+    tag(h, TagRegistry::instance().load(h));
+}
+
+void TagJsonWriter::publishedTag(const TagHandle h) {
+    tag(h, TagRegistry::instance().loadPublished(h));
+}
+
+void TagJsonWriter::tag(const TagHandle h, const TagRegistry::Sample& sample) {
+    out_.append("{\"id\":");
+    string(TagRegistry::instance().id(h));
+    out_.append(",\"value\":");
+    if (sample.hasValue) value(sample.value);
+    else out_.append("null");
+    out_.append(",\"quality\":\"");
+    out_.append(qualityName(sample.quality));
+    out_.append("\",\"timestamp\":");
+    number(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        sample.timestamp.time_since_epoch()).count()));
+    out_.append(",\"seq\":");
+    number(sample.changeSeq);
+    out_.push_back('}');
+}
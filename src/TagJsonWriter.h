@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "TagRegistry.h"
+
+// 标签值的 JSON 序列化：直接追加到调用方复用的缓冲区，数值用 std::to_chars，不构建 DOM。
+// 单个标签输出为 {"id":..,"value":..,"quality":..,"timestamp":毫秒,"seq":变化序号}
+class TagJsonWriter {
+public:
+    explicit TagJsonWriter(std::string& out) : out_(out) {}
+
+    void tag(TagHandle h);
+    // 输出发布值（压缩后的序列），用于按变化推送的场景
+    void publishedTag(TagHandle h);
+    void tag(TagHandle h, const TagRegistry::Sample& sample);
+    void value(const Variable::ValueType& value);
+    void string(std::string_view s);
+    void number(int64_t v);
+    void number(uint64_t v);
+    void number(double v);
+    void raw(const std::string_view s) { out_.append(s); }
+    void raw(const char c) { out_.push_back(c); }
+
+    static const char* qualityName(VarQuality q);
+
+private:
+    std::string& out_;
+};
@@ -0,0 +1,633 @@
+#include "TagRegistry.h"
+#include "ChangeLog.h"
+#include "ShmTagTable.h"
+#include "TagCompressor.h"
+#include "TagHistory.h"
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+template<class T>
+T fromBits(const uint64_t bits) {
+    T v;
+    std::memcpy(&v, &bits, sizeof(T));
+    return v;
+}
+
+// kind 与 Variable::ValueType 的下标一致
+Variable::ValueType decodeBits(const uint8_t kind, const uint64_t bits) {
+    switch (kind) {
+        case 1: return bits != 0;
+        case 2: return fromBits<int16_t>(bits);
+        case 3: return fromBits<uint16_t>(bits);
+        case 4: return fromBits<int32_t>(bits);
+        case 5: return fromBits<uint32_t>(bits);
+        case 6: return fromBits<int64_t>(bits);
+        case 7: return fromBits<uint64_t>(bits);
+        case 8: return fromBits<float>(bits);
+        case 9: return fromBits<double>(bits);
+        default: return {};
+    }
+}
+
+} // namespace
+
+Variable::ValueType TagRegistry::decode(const uint8_t kind, const uint64_t bits) {
+    return decodeBits(kind, bits);
+}
+
+bool TagRegistry::toDouble(const uint8_t kind, const uint64_t bits, double& out) {
+    switch (kind) {
+        case 1: out = bits != 0 ? 1.0 : 0.0; return true;
+        case 2: out = fromBits<int16_t>(bits); return true;
+        case 3: out = fromBits<uint16_t>(bits); return true;
+        case 4: out = fromBits<int32_t>(bits); return true;
+        case 5: out = fromBits<uint32_t>(bits); return true;
+        case 6: out = static_cast<double>(fromBits<int64_t>(bits)); return true;
+        case 7: out = static_cast<double>(fromBits<uint64_t>(bits)); return true;
+        case 8: out = fromBits<float>(bits); return true;
+        case 9: out = fromBits<double>(bits); return true;
+        default: return false;
+    }
+}
+
+TagRegistry& TagRegistry::instance() {
+    static TagRegistry reg;
+    return reg;
+}
+
+TagRegistry::TagRegistry() {
+    rehashIndex(1024);
+    rehashIntern(1024);
+}
+
+TagRegistry::~TagRegistry() {
+    for (auto& b : blocks_) delete b.load();
+    for (auto& m : metas_) delete m.load();
+    for (auto& c : chunks_) delete[] c.load();
+}
+
+uint64_t TagRegistry::hashBytes(const char* p, const size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= static_cast<unsigned char>(p[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint32_t TagRegistry::appendString(const char* data, const uint16_t header, const size_t bytes) {
+    if (bytes + sizeof(uint16_t) > kChunkSize) throw std::length_error("TagRegistry: string too long");
+    if (chunkUsed_ + sizeof(uint16_t) + bytes > kChunkSize) {
+        // 保留最后一块不用，保证引用值不会与空槽/墓碑标记冲突
+        if (chunkCount_ + 1 >= kMaxChunks) throw std::length_error("TagRegistry: string arena exhausted");
+        chunks_[chunkCount_].store(new char[kChunkSize], std::memory_order_release);
+        ++chunkCount_;
+        chunkUsed_ = 0;
+    }
+    char* chunk = chunks_[chunkCount_ - 1].load(std::memory_order_relaxed);
+    const uint32_t ref = ((chunkCount_ - 1) << kChunkBits) | chunkUsed_;
+    std::memcpy(chunk + chunkUsed_, &header, sizeof(uint16_t));
+    std::memcpy(chunk + chunkUsed_ + sizeof(uint16_t), data, bytes);
+    chunkUsed_ += static_cast<uint32_t>(sizeof(uint16_t) + bytes);
+    return ref;
+}
+
+std::string_view TagRegistry::rawString(const uint32_t ref, uint16_t* header) const {
+    const char* chunk = chunks_[ref >> kChunkBits].load(std::memory_order_acquire);
+    const char* p = chunk + (ref & (kChunkSize - 1));
+    uint16_t hdr;
+    std::memcpy(&hdr, p, sizeof(uint16_t));
+    if (header) *header = hdr;
+    const size_t units = hdr & ~kWideFlag;
+    const size_t bytes = (hdr & kWideFlag) ? units * sizeof(wchar_t) : units;
+    return {p + sizeof(uint16_t), bytes};
+}
+
+uint32_t TagRegistry::internNarrow(const std::string_view s) {
+    if (s.size() >= kWideFlag) throw std::length_error("TagRegistry: string too long");
+    const auto header = static_cast<uint16_t>(s.size());
+    if ((internUsed_ + 1) * 2 > intern_.size()) rehashIntern(intern_.size() * 2);
+    const size_t mask = intern_.size() - 1;
+    for (size_t i = hashBytes(s.data(), s.size()) & mask;; i = (i + 1) & mask) {
+        const uint32_t ref = intern_[i];
+        if (ref == kEmptySlot) {
+            const uint32_t newRef = appendString(s.data(), header, s.size());
+            intern_[i] = newRef;
+            ++internUsed_;
+            return newRef;
+        }
+        uint16_t hdr;
+        if (const auto existing = rawString(ref, &hdr); hdr == header && existing == s) return ref;
+    }
+}
+
+uint32_t TagRegistry::internWide(const std::wstring_view s) {
+    // 纯 ASCII 地址（Modbus 寄存器号、多数 OPC 路径）按单字节存放
+    bool ascii = true;
+    for (const wchar_t c : s) {
+        if (static_cast<uint32_t>(c) >= 0x80) { ascii = false; break; }
+    }
+    if (ascii) {
+        std::string narrow(s.begin(), s.end());
+        return internNarrow(narrow);
+    }
+    if (s.size() >= kWideFlag) throw std::length_error("TagRegistry: string too long");
+    const auto header = static_cast<uint16_t>(s.size() | kWideFlag);
+    const std::string_view bytes(reinterpret_cast<const char*>(s.data()), s.size() * sizeof(wchar_t));
+    if ((internUsed_ + 1) * 2 > intern_.size()) rehashIntern(intern_.size() * 2);
+    const size_t mask = intern_.size() - 1;
+    for (size_t i = hashBytes(bytes.data(), bytes.size()) & mask;; i = (i + 1) & mask) {
+        const uint32_t ref = intern_[i];
+        if (ref == kEmptySlot) {
+            const uint32_t newRef = appendString(bytes.data(), header, bytes.size());
+            intern_[i] = newRef;
+            ++internUsed_;
+            return newRef;
+        }
+        uint16_t hdr;
+        if (const auto existing = rawString(ref, &hdr); hdr == header && existing == bytes) return ref;
+    }
+}
+
+void TagRegistry::rehashIntern(const size_t capacity) {
+    std::vector<uint32_t> old(capacity, kEmptySlot);
+    old.swap(intern_);
+    const size_t mask = intern_.size() - 1;
+    for (const uint32_t ref : old) {
+        if (ref == kEmptySlot) continue;
+        const auto bytes = rawString(ref);
+        size_t i = hashBytes(bytes.data(), bytes.size()) & mask;
+        while (intern_[i] != kEmptySlot) i = (i + 1) & mask;
+        intern_[i] = ref;
+    }
+}
+
+void TagRegistry::rehashIndex(const size_t capacity) {
+    std::vector<uint32_t> old(capacity, kEmptySlot);
+    old.swap(idIndex_);
+    idIndexUsed_ = 0;
+    const size_t mask = idIndex_.size() - 1;
+    for (const uint32_t h : old) {
+        if (h == kEmptySlot || h == kTombstone) continue;
+        const auto key = id(h);
+        size_t i = hashBytes(key.data(), key.size()) & mask;
+        while (idIndex_[i] != kEmptySlot) i = (i + 1) & mask;
+        idIndex_[i] = h;
+        ++idIndexUsed_;
+    }
+}
+
+void TagRegistry::indexInsert(const TagHandle h) {
+    if ((idIndexUsed_ + 1) * 2 > idIndex_.size()) {
+        size_t cap = idIndex_.size();
+        while ((liveCount_ + 1) * 2 > cap) cap *= 2;
+        rehashIndex(cap);
+    }
+    const auto key = id(h);
+    const size_t mask = idIndex_.size() - 1;
+    size_t i = hashBytes(key.data(), key.size()) & mask;
+    while (idIndex_[i] != kEmptySlot && idIndex_[i] != kTombstone) i = (i + 1) & mask;
+    if (idIndex_[i] == kEmptySlot) ++idIndexUsed_;
+    idIndex_[i] = h;
+}
+
+void TagRegistry::indexErase(const TagHandle h) {
+    const auto key = id(h);
+    const size_t mask = idIndex_.size() - 1;
+    for (size_t i = hashBytes(key.data(), key.size()) & mask; idIndex_[i] != kEmptySlot; i = (i + 1) & mask) {
+        if (idIndex_[i] == h) {
+            idIndex_[i] = kTombstone;
+            return;
+        }
+    }
+}
+
+TagHandle TagRegistry::findLocked(const std::string_view id) const {
+    const size_t mask = idIndex_.size() - 1;
+    for (size_t i = hashBytes(id.data(), id.size()) & mask; idIndex_[i] != kEmptySlot; i = (i + 1) & mask) {
+        if (const uint32_t h = idIndex_[i]; h != kTombstone && this->id(h) == id) return h;
+    }
+    return kInvalidTag;
+}
+
+TagHandle TagRegistry::find(const std::string_view id) const {
+    std::shared_lock lock(mtx_);
+    return findLocked(id);
+}
+
+TagHandle TagRegistry::acquire(const std::string_view id, const std::string_view name,
+                               const std::wstring_view address, const VarType type, const VarAccess access) {
+    std::unique_lock lock(mtx_);
+    if (const TagHandle existing = findLocked(id); existing != kInvalidTag) {
+        MetaBlock& m = meta(existing);
+        const uint32_t i = slot(existing);
+        ++m.refs[i];
+        setMeta(m, i, name, address, type, access);
+        return existing;
+    }
+    TagHandle h;
+    if (!freeList_.empty()) {
+        h = freeList_.back();
+        freeList_.pop_back();
+    } else {
+        h = nextHandle_++;
+        if ((h >> kBlockBits) >= blockCount_) {
+            if (blockCount_ >= kMaxBlocks) throw std::length_error("TagRegistry: too many tags");
+            auto* b = new Block();
+            for (auto& k : b->kind) k.store(kNoValue, std::memory_order_relaxed);
+            metas_[blockCount_].store(new MetaBlock(), std::memory_order_release);
+            blocks_[blockCount_].store(b, std::memory_order_release);
+            ++blockCount_;
+        }
+    }
+    if (id.size() >= kWideFlag) throw std::length_error("TagRegistry: id too long");
+    Block& b = block(h);
+    MetaBlock& m = meta(h);
+    const uint32_t i = slot(h);
+    m.idRef[i] = appendString(id.data(), static_cast<uint16_t>(id.size()), id.size());
+    setMeta(m, i, name, address, type, access);
+    m.refs[i] = 1;
+    b.kind[i].store(kNoValue, std::memory_order_relaxed);
+    b.quality[i].store(static_cast<uint8_t>(VarQuality::UNCERTAIN), std::memory_order_relaxed);
+    b.ts[i].store(0, std::memory_order_relaxed);
+    b.bits[i].store(0, std::memory_order_relaxed);
+    indexInsert(h);
+    if (auto& shm = ShmTagTable::instance(); shm.enabled()) shm.bind(h, id);
+    ++liveCount_;
+    return h;
+}
+
+void TagRegistry::release(const TagHandle h) {
+    if (h == kInvalidTag) return;
+    {
+        std::unique_lock lock(mtx_);
+        MetaBlock& m = meta(h);
+        if (m.refs[slot(h)] == 0 || --m.refs[slot(h)] > 0) return;
+        indexErase(h);
+        if (auto& shm = ShmTagTable::instance(); shm.enabled()) shm.unbind(h);
+        --liveCount_;
+    }
+    // 先清空值槽、关闭压缩，最后才放回空闲表：句柄一旦可被 acquire 复用，
+    // 旧标签的清理不能再覆盖新标签的值、历史与压缩设置
+    clear(h);
+    setCompression(h, {});
+    std::unique_lock lock(mtx_);
+    freeList_.push_back(h);
+}
+
+void TagRegistry::setMeta(MetaBlock& m, const uint32_t i, const std::string_view name,
+                          const std::wstring_view address, const VarType type, const VarAccess access) {
+    const uint32_t idRef = m.idRef[i];
+    // 名称与 id 相同（未单独配置名称）时直接引用 id，不再驻留一份
+    const uint32_t nameRef = name == rawString(idRef) ? idRef : internNarrow(name);
+    if (m.nameRef[i].load(std::memory_order_relaxed) != nameRef) m.nameRef[i].store(nameRef, std::memory_order_relaxed);
+    if (const uint32_t ref = internWide(address); m.addrRef[i].load(std::memory_order_relaxed) != ref)
+        m.addrRef[i].store(ref, std::memory_order_relaxed);
+    m.type[i].store(static_cast<uint8_t>(type), std::memory_order_relaxed);
+    m.access[i].store(static_cast<uint8_t>(access), std::memory_order_relaxed);
+}
+
+size_t TagRegistry::size() const {
+    std::shared_lock lock(mtx_);
+    return liveCount_;
+}
+
+size_t TagRegistry::memoryBytes() const {
+    std::shared_lock lock(mtx_);
+    return static_cast<size_t>(blockCount_) * (sizeof(Block) + sizeof(MetaBlock)) +
+           static_cast<size_t>(chunkCount_) * kChunkSize +
+           (idIndex_.capacity() + intern_.capacity() + freeList_.capacity()) * sizeof(uint32_t);
+}
+
+std::string_view TagRegistry::id(const TagHandle h) const {
+    return rawString(meta(h).idRef[slot(h)]);
+}
+
+std::string_view TagRegistry::name(const TagHandle h) const {
+    return rawString(meta(h).nameRef[slot(h)].load(std::memory_order_relaxed));
+}
+
+std::wstring TagRegistry::address(const TagHandle h) const {
+    uint16_t hdr;
+    const auto bytes = rawString(meta(h).addrRef[slot(h)].load(std::memory_order_relaxed), &hdr);
+    if (hdr & kWideFlag) {
+        std::wstring w(bytes.size() / sizeof(wchar_t), L'\0');
+        std::memcpy(w.data(), bytes.data(), bytes.size());
+        return w;
+    }
+    return {bytes.begin(), bytes.end()};
+}
+
+VarType TagRegistry::type(const TagHandle h) const {
+    return static_cast<VarType>(meta(h).type[slot(h)].load(std::memory_order_relaxed));
+}
+
+VarAccess TagRegistry::access(const TagHandle h) const {
+    return static_cast<VarAccess>(meta(h).access[slot(h)].load(std::memory_order_relaxed));
+}
+
+void TagRegistry::beginWrite(Block& b, const uint32_t i) const {
+    uint32_t s = b.seq[i].load(std::memory_order_relaxed);
+    for (;;) {
+        if (s & 1) {
+            std::this_thread::yield();
+            s = b.seq[i].load(std::memory_order_relaxed);
+            continue;
+        }
+        if (b.seq[i].compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed)) break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void TagRegistry::store(const TagHandle h, const Variable::ValueType& value, const VarQuality quality,
+                        const std::chrono::system_clock::time_point ts) {
+    uint64_t bits = 0;
+    bool stringChanged = false;
+    std::visit([&](auto&& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+            std::lock_guard<std::mutex> lock(stringValueMtx_);
+            auto& stored = stringValues_[h];
+            stringChanged = stored != v;
+            if (stringChanged) stored = v;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            bits = v ? 1 : 0;
+        } else {
+            std::memcpy(&bits, &v, sizeof(T));
+        }
+    }, value);
+    Block& b = block(h);
+    const uint32_t i = slot(h);
+    beginWrite(b, i);
+    const auto kind = static_cast<uint8_t>(value.index());
+    const int64_t tsCount = ts.time_since_epoch().count();
+    if (auto& shm = ShmTagTable::instance(); shm.enabled()) {
+        shm.publish(h, kind, bits, static_cast<uint8_t>(quality),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count());
+    }
+    auto& compressor = TagCompressor::instance();
+    TagCompressor::Output points;
+    if (compressor.active(h) && compressor.filter(h, kind, bits, static_cast<uint8_t>(quality), tsCount, points)) {
+        uint64_t seqs[4];
+        b.bits[i].store(bits, std::memory_order_relaxed);
+        b.kind[i].store(kind, std::memory_order_relaxed);
+        b.quality[i].store(static_cast<uint8_t>(quality), std::memory_order_relaxed);
+        b.ts[i].store(tsCount, std::memory_order_relaxed);
+        stampPoints(b, i, h, points, seqs);
+        b.seq[i].fetch_add(1, std::memory_order_release);
+        logPoints(h, points, seqs);
+        return;
+    }
+    uint64_t changed = 0;
+    if (stringChanged || b.bits[i].load(std::memory_order_relaxed) != bits ||
+        b.kind[i].load(std::memory_order_relaxed) != kind ||
+        b.quality[i].load(std::memory_order_relaxed) != static_cast<uint8_t>(quality)) {
+        changed = changeSeq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        b.changed[i].store(changed, std::memory_order_relaxed);
+    }
+    b.bits[i].store(bits, std::memory_order_relaxed);
+    b.kind[i].store(kind, std::memory_order_relaxed);
+    b.quality[i].store(static_cast<uint8_t>(quality), std::memory_order_relaxed);
+    b.ts[i].store(ts.time_since_epoch().count(), std::memory_order_relaxed);
+    // 历史在写锁内追加，保证每个标签只有一个写入方
+    if (auto& history = TagHistory::instance(); history.enabled()) {
+        history.append(h, kind, bits, quality,
+                       std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count());
+    }
+    b.seq[i].fetch_add(1, std::memory_order_release);
+    if (changed) {
+        commitSeq(changed);
+        ChangeLog::instance().append(changed, h, kind, static_cast<uint8_t>(quality), bits,
+                                     ts.time_since_epoch().count());
+    }
+}
+
+void TagRegistry::storeQuality(const TagHandle h, const VarQuality quality,
+                               const std::chrono::system_clock::time_point ts) {
+    Block& b = block(h);
+    const uint32_t i = slot(h);
+    beginWrite(b, i);
+    const int64_t tsCount = ts.time_since_epoch().count();
+    if (auto& shm = ShmTagTable::instance(); shm.enabled()) {
+        // 尚无值时与下面的普通写入一致，按空字符串发布
+        const uint8_t cur = b.kind[i].load(std::memory_order_relaxed);
+        shm.publish(h, cur == kNoValue ? 0 : cur, b.bits[i].load(std::memory_order_relaxed),
+                    static_cast<uint8_t>(quality),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count());
+    }
+    auto& compressor = TagCompressor::instance();
+    TagCompressor::Output points;
+    if (compressor.active(h) &&
+        compressor.filter(h, b.kind[i].load(std::memory_order_relaxed), b.bits[i].load(std::memory_order_relaxed),
+                          static_cast<uint8_t>(quality), tsCount, points)) {
+        uint64_t seqs[4];
+        b.quality[i].store(static_cast<uint8_t>(quality), std::memory_order_relaxed);
+        b.ts[i].store(tsCount, std::memory_order_relaxed);
+        stampPoints(b, i, h, points, seqs);
+        b.seq[i].fetch_add(1, std::memory_order_release);
+        logPoints(h, points, seqs);
+        return;
+    }
+    uint64_t changed = 0;
+    if (b.kind[i].load(std::memory_order_relaxed) == kNoValue ||
+        b.quality[i].load(std::memory_order_relaxed) != static_cast<uint8_t>(quality)) {
+        changed = changeSeq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        b.changed[i].store(changed, std::memory_order_relaxed);
+    }
+    // 尚无值时按默认构造的 ValueType（空字符串）记录，与只写品质的旧行为一致
+    if (b.kind[i].load(std::memory_order_relaxed) == kNoValue) b.kind[i].store(0, std::memory_order_relaxed);
+    b.quality[i].store(static_cast<uint8_t>(quality), std::memory_order_relaxed);
+    b.ts[i].store(ts.time_since_epoch().count(), std::memory_order_relaxed);
+    const uint8_t kind = b.kind[i].load(std::memory_order_relaxed);
+    const uint64_t bits = b.bits[i].load(std::memory_order_relaxed);
+    if (auto& history = TagHistory::instance(); history.enabled()) {
+        history.append(h, kind, bits, quality,
+                       std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count());
+    }
+    b.seq[i].fetch_add(1, std::memory_order_release);
+    if (changed) {
+        commitSeq(changed);
+        ChangeLog::instance().append(changed, h, kind, static_cast<uint8_t>(quality), bits,
+                                     ts.time_since_epoch().count());
+    }
+}
+
+void TagRegistry::clear(const TagHandle h) {
+    Block& b = block(h);
+    const uint32_t i = slot(h);
+    beginWrite(b, i);
+    const uint64_t changed = changeSeq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    b.changed[i].store(changed, std::memory_order_relaxed);
+    b.kind[i].store(kNoValue, std::memory_order_relaxed);
+    b.quality[i].store(static_cast<uint8_t>(VarQuality::UNCERTAIN), std::memory_order_relaxed);
+    b.ts[i].store(0, std::memory_order_relaxed);
+    if (auto& history = TagHistory::instance(); history.enabled()) history.reset(h);
+    // 只丢弃压缩的暂存点：热加载重建设备时保留的标签先设置压缩再清空旧值，参数须保留；
+    // 句柄真正释放时由 release 关闭压缩
+    TagCompressor::instance().restart(h);
+    if (auto& shm = ShmTagTable::instance(); shm.enabled())
+        shm.publish(h, kNoValue, 0, static_cast<uint8_t>(VarQuality::UNCERTAIN), 0);
+    b.seq[i].fetch_add(1, std::memory_order_release);
+    commitSeq(changed);
+    ChangeLog::instance().append(changed, h, kNoValue, static_cast<uint8_t>(VarQuality::UNCERTAIN), 0, 0);
+    std::lock_guard<std::mutex> lock(stringValueMtx_);
+    stringValues_.erase(h);
+}
+
+void TagRegistry::commitSeq(const uint64_t seq) {
+    auto& flag = commitRing_[seq & (kCommitRing - 1)];
+    // 环上该位置的上一个序号尚未推进过水位（极少见：上一轮的写入方仍在临界区内）
+    while (committedSeq_.load(std::memory_order_acquire) + kCommitRing < seq) std::this_thread::yield();
+    // 标记与水位均用 seq_cst：两个写入方各自标记后再检查对方的标记，至少一方能看到另一方，水位不会停在中途
+    flag.store(seq, std::memory_order_seq_cst);
+    uint64_t w = committedSeq_.load(std::memory_order_seq_cst);
+    while (commitRing_[(w + 1) & (kCommitRing - 1)].load(std::memory_order_seq_cst) == w + 1) {
+        if (committedSeq_.compare_exchange_weak(w, w + 1, std::memory_order_seq_cst)) ++w;
+    }
+}
+
+void TagRegistry::setCompression(const TagHandle h, const CompressionParams& params) {
+    Block& b = block(h);
+    const uint32_t i = slot(h);
+    beginWrite(b, i);
+    TagCompressor::instance().configure(h, params);
+    b.seq[i].fetch_add(1, std::memory_order_release);
+}
+
+void TagRegistry::stampPoints(Block& b, const uint32_t i, const TagHandle h, const TagCompressor::Output& out,
+                              uint64_t* seqs) {
+    auto& history = TagHistory::instance();
+    for (uint32_t k = 0; k < out.count; ++k) {
+        const auto& p = out.points[k];
+        seqs[k] = changeSeq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        b.changed[i].store(seqs[k], std::memory_order_relaxed);
+        if (history.enabled()) {
+            history.append(h, p.kind, p.bits, static_cast<VarQuality>(p.quality),
+                           std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::duration(p.ts)).count());
+        }
+    }
+}
+
+void TagRegistry::logPoints(const TagHandle h, const TagCompressor::Output& out, const uint64_t* seqs) {
+    for (uint32_t k = 0; k < out.count; ++k) {
+        const auto& p = out.points[k];
+        commitSeq(seqs[k]);
+        ChangeLog::instance().append(seqs[k], h, p.kind, p.quality, p.bits, p.ts);
+    }
+}
+
+TagRegistry::Sample TagRegistry::load(const TagHandle h) const {
+    return loadSample(h, false);
+}
+
+TagRegistry::Sample TagRegistry::loadPublished(const TagHandle h) const {
+    return loadSample(h, true);
+}
+
+TagRegistry::Sample TagRegistry::loadSample(const TagHandle h, const bool published) const {
+    const auto& compressor = TagCompressor::instance();
+    const Block& b = block(h);
+    const uint32_t i = slot(h);
+    uint64_t bits, changed;
+    uint8_t kind, quality;
+    int64_t ts;
+    for (;;) {
+        const uint32_t s1 = b.seq[i].load(std::memory_order_acquire);
+        if (s1 & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        bits = b.bits[i].load(std::memory_order_relaxed);
+        kind = b.kind[i].load(std::memory_order_relaxed);
+        quality = b.quality[i].load(std::memory_order_relaxed);
+        ts = b.ts[i].load(std::memory_order_relaxed);
+        changed = b.changed[i].load(std::memory_order_relaxed);
+        // 发布槽与值槽在同一写窗口内更新，一并由 seqlock 校验
+        if (TagCompressor::Point p; published && compressor.published(h, p)) {
+            bits = p.bits;
+            kind = p.kind;
+            quality = p.quality;
+            ts = p.ts;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (b.seq[i].load(std::memory_order_relaxed) == s1) break;
+    }
+    Sample out;
+    out.hasValue = kind != kNoValue;
+    out.changeSeq = changed;
+    out.quality = static_cast<VarQuality>(quality);
+    out.timestamp = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ts));
+    if (kind == 0) {
+        std::lock_guard<std::mutex> lock(stringValueMtx_);
+        if (const auto it = stringValues_.find(h); it != stringValues_.end()) out.value = it->second;
+    } else {
+        out.value = decodeBits(kind, bits);
+    }
+    return out;
+}
+
+bool TagRegistry::loadNumeric(const TagHandle h, double& value, VarQuality& quality,
+                              std::chrono::system_clock::time_point* timestamp) const {
+    const Block& b = block(h);
+    const uint32_t i = slot(h);
+    uint64_t bits;
+    uint8_t kind, q;
+    int64_t ts;
+    for (;;) {
+        const uint32_t s1 = b.seq[i].load(std::memory_order_acquire);
+        if (s1 & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        bits = b.bits[i].load(std::memory_order_relaxed);
+        kind = b.kind[i].load(std::memory_order_relaxed);
+        q = b.quality[i].load(std::memory_order_relaxed);
+        ts = b.ts[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (b.seq[i].load(std::memory_order_relaxed) == s1) break;
+    }
+    quality = static_cast<VarQuality>(q);
+    if (timestamp) *timestamp = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ts));
+    return toDouble(kind, bits, value);
+}
+
+VarQuality TagRegistry::quality(const TagHandle h) const {
+    return static_cast<VarQuality>(block(h).quality[slot(h)].load(std::memory_order_relaxed));
+}
+
+uint64_t TagRegistry::changedAt(const TagHandle h) const {
+    return block(h).changed[slot(h)].load(std::memory_order_acquire);
+}
+
+bool TagRegistry::hasValue(const TagHandle h) const {
+    return block(h).kind[slot(h)].load(std::memory_order_relaxed) != kNoValue;
+}
+
+uint64_t TagRegistry::fingerprint(const TagHandle h) const {
+    const Block& b = block(h);
+    const uint32_t i = slot(h);
+    uint64_t bits;
+    uint8_t kind, quality;
+    for (;;) {
+        const uint32_t s1 = b.seq[i].load(std::memory_order_acquire);
+        if (s1 & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        bits = b.bits[i].load(std::memory_order_relaxed);
+        kind = b.kind[i].load(std::memory_order_relaxed);
+        quality = b.quality[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (b.seq[i].load(std::memory_order_relaxed) == s1) break;
+    }
+    if (kind == 0) {
+        std::lock_guard<std::mutex> lock(stringValueMtx_);
+        if (const auto it = stringValues_.find(h); it != stringValues_.end())
+            bits = hashBytes(it->second.data(), it->second.size());
+    }
+    return (bits * 0x9E3779B97F4A7C15ULL) ^ (static_cast<uint64_t>(kind) << 8 | quality);
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "TagCompressor.h"
+#include "Variable.h"
+
+// 全局标签表：元数据存放在驻留字符串表中，实时值按句柄存放在分块的紧凑数组里。
+// 每个标签的值槽由 seqlock 保护：写入方 CAS 占用，读取方无锁重试。
+// 分块一经分配永不移动，读路径不加锁；注册/释放走互斥锁。
+// 内存：采集与推送路径只触及值块（每标签 30 B），类型、权限、引用计数与字符串引用放在单独的元数据块（16 B）；
+// 连同 id 索引（约 8~16 B）固定开销不超过 64 B/标签。字符串另计：id 按实际长度加 2 B 保存，
+// 名称与 id 相同时共用 id，名称与地址去重（Modbus 寄存器号等在设备间大量重复）。
+// 100 万标签、19 字节 id、名称同 id 时 memoryBytes() 约 76 B/标签
+class TagRegistry {
+public:
+    struct Sample {
+        Variable::ValueType value;
+        VarQuality quality = VarQuality::UNCERTAIN;
+        std::chrono::system_clock::time_point timestamp;
+        bool hasValue = false;
+        uint64_t changeSeq = 0;     // 最近一次值或品质变化时的全局变化序号
+    };
+
+    static constexpr uint32_t kBlockBits = 12;
+    static constexpr uint32_t kBlockSize = 1u << kBlockBits;       // 每块 4096 个标签
+    static constexpr uint32_t kMaxBlocks = 4096;                    // 上限约 1600 万标签
+    // 值的存储形态：variant 下标 + 64 位原始位；字符串值极少，单独放旁路表
+    static constexpr uint8_t kNoValue = 0xFF;
+
+    static TagRegistry& instance();
+    ~TagRegistry();
+    TagRegistry(const TagRegistry&) = delete;
+    TagRegistry& operator=(const TagRegistry&) = delete;
+
+    // 注册标签；同 id 已存在时复用原句柄并增加引用计数（热加载重建分组时值得以保留），
+    // 名称、地址、类型、权限以本次为准（热加载修改了 OPC UA 节点等配置时生效）
+    TagHandle acquire(std::string_view id, std::string_view name, std::wstring_view address,
+                      VarType type, VarAccess access);
+    // 引用计数归零时回收句柄；驻留字符串不回收
+    void release(TagHandle h);
+    [[nodiscard]] TagHandle find(std::string_view id) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t memoryBytes() const;
+
+    [[nodiscard]] std::string_view id(TagHandle h) const;
+    [[nodiscard]] std::string_view name(TagHandle h) const;
+    [[nodiscard]] std::wstring address(TagHandle h) const;
+    [[nodiscard]] VarType type(TagHandle h) const;
+    [[nodiscard]] VarAccess access(TagHandle h) const;
+
+    void store(TagHandle h, const Variable::ValueType& value, VarQuality quality,
+               std::chrono::system_clock::time_point ts);
+    void storeQuality(TagHandle h, VarQuality quality, std::chrono::system_clock::time_point ts);
+    // 清空值（删除变量时），之后 hasValue 返回 false
+    void clear(TagHandle h);
+    // 设置标签的例外/旋转门压缩参数（未启用时关闭）；启用后只有压缩输出的点才分配变化序号、
+    // 进入变化日志与内存历史，值槽仍保存最新值
+    void setCompression(TagHandle h, const CompressionParams& params);
+    [[nodiscard]] Sample load(TagHandle h) const;
+    // 发布值：启用压缩的标签返回最近一个压缩输出点（与 changedAt 对应），否则同 load。
+    // 按变化取值的下游（长轮询、WebSocket、计算标签）用它，避免跳过压缩输出的转折点
+    [[nodiscard]] Sample loadPublished(TagHandle h) const;
+    // 数值快速读取：不构造 variant，无值或字符串值返回 false
+    bool loadNumeric(TagHandle h, double& value, VarQuality& quality,
+                     std::chrono::system_clock::time_point* timestamp = nullptr) const;
+    [[nodiscard]] VarQuality quality(TagHandle h) const;
+    [[nodiscard]] bool hasValue(TagHandle h) const;
+    // 值与品质的摘要（不含时间戳），用于低成本判断一轮采集前后是否有变化
+    [[nodiscard]] uint64_t fingerprint(TagHandle h) const;
+    // 全局变化序号：值或品质实际发生变化（含清空）时递增，并记入该标签；重复写入相同值不递增。
+    // 返回已提交水位：不大于它的每个序号都已写入对应标签的 changedAt 与值槽，
+    // 读取方先取水位、再扫 changedAt(h) > since，之后以水位作为下次的 since 即不会漏掉变化
+    [[nodiscard]] uint64_t changeSeq() const { return committedSeq_.load(std::memory_order_acquire); }
+    [[nodiscard]] uint64_t changedAt(TagHandle h) const;
+
+    // 由存储形态还原值，供变化日志等按原始位保存值的模块使用；字符串下标返回空值
+    static Variable::ValueType decode(uint8_t kind, uint64_t bits);
+    // 由存储形态取数值；字符串或无值返回 false
+    static bool toDouble(uint8_t kind, uint64_t bits, double& out);
+
+private:
+    TagRegistry();
+
+    // 值块：读写热路径
+    struct Block {
+        std::atomic<uint32_t> seq[kBlockSize];
+        std::atomic<uint64_t> bits[kBlockSize];
+        std::atomic<int64_t>  ts[kBlockSize];
+        std::atomic<uint64_t> changed[kBlockSize];
+        std::atomic<uint8_t>  kind[kBlockSize];
+        std::atomic<uint8_t>  quality[kBlockSize];
+    };
+    // 元数据块：注册、释放与按句柄查元数据时访问；名称/地址引用与类型在注册互斥锁内更新，
+    // 以原子变量保存，热加载更新时无锁读取方读到的是新值或旧值之一
+    struct MetaBlock {
+        std::atomic<uint8_t>  type[kBlockSize];
+        std::atomic<uint8_t>  access[kBlockSize];
+        uint16_t refs[kBlockSize];
+        uint32_t idRef[kBlockSize];
+        std::atomic<uint32_t> nameRef[kBlockSize];
+        std::atomic<uint32_t> addrRef[kBlockSize];
+    };
+
+    // 驻留字符串：1MB 分块，引用 = 块号 << 20 | 偏移，内容前置 16 位长度（最高位表示宽字符）
+    static constexpr uint32_t kChunkBits = 20;
+    static constexpr uint32_t kChunkSize = 1u << kChunkBits;
+    static constexpr uint32_t kMaxChunks = 4096;
+    static constexpr uint16_t kWideFlag = 0x8000;
+    static constexpr uint32_t kEmptySlot = 0xFFFFFFFF;
+    static constexpr uint32_t kTombstone = 0xFFFFFFFE;
+
+    [[nodiscard]] Sample loadSample(TagHandle h, bool published) const;
+    [[nodiscard]] Block& block(const TagHandle h) const { return *blocks_[h >> kBlockBits].load(std::memory_order_acquire); }
+    [[nodiscard]] MetaBlock& meta(const TagHandle h) const { return *metas_[h >> kBlockBits].load(std::memory_order_acquire); }
+    static uint32_t slot(const TagHandle h) { return h & (kBlockSize - 1); }
+
+    uint32_t appendString(const char* data, uint16_t header, size_t bytes);
+    [[nodiscard]] std::string_view rawString(uint32_t ref, uint16_t* header = nullptr) const;
+    uint32_t internNarrow(std::string_view s);
+    uint32_t internWide(std::wstring_view s);
+    static uint64_t hashBytes(const char* p, size_t n);
+    [[nodiscard]] TagHandle findLocked(std::string_view id) const;
+    void setMeta(MetaBlock& m, uint32_t i, std::string_view name, std::wstring_view address, VarType type,
+                 VarAccess access);
+    void indexInsert(TagHandle h);
+    void indexErase(TagHandle h);
+    void rehashIndex(size_t capacity);
+    void rehashIntern(size_t capacity);
+
+    void beginWrite(Block& b, uint32_t i) const;
+    void commitSeq(uint64_t seq);
+    // 压缩输出的点：写锁内逐个分配变化序号并记入历史，释放写锁后再记入变化日志
+    void stampPoints(Block& b, uint32_t i, TagHandle h, const TagCompressor::Output& out, uint64_t* seqs);
+    void logPoints(TagHandle h, const TagCompressor::Output& out, const uint64_t* seqs);
+
+    std::array<std::atomic<Block*>, kMaxBlocks> blocks_{};
+    std::array<std::atomic<MetaBlock*>, kMaxBlocks> metas_{};
+    std::array<std::atomic<char*>, kMaxChunks> chunks_{};
+    uint32_t chunkCount_ = 0;
+    uint32_t chunkUsed_ = kChunkSize;   // 当前块已用字节
+    uint32_t blockCount_ = 0;
+    uint32_t nextHandle_ = 0;
+    size_t liveCount_ = 0;
+    std::vector<TagHandle> freeList_;
+
+    // 开放寻址：id -> 句柄；name/address 去重 -> 字符串引用
+    std::vector<uint32_t> idIndex_;
+    size_t idIndexUsed_ = 0;
+    std::vector<uint32_t> intern_;
+    size_t internUsed_ = 0;
+
+    std::atomic<uint64_t> changeSeq_{0};         // 已分配的最大序号
+    // 已提交水位：写入方释放值槽写锁后标记自己的序号，水位沿连续已标记的序号推进
+    static constexpr uint32_t kCommitRing = 4096;
+    std::array<std::atomic<uint64_t>, kCommitRing> commitRing_{};
+    std::atomic<uint64_t> committedSeq_{0};
+
+    mutable std::shared_mutex mtx_;
+    mutable std::mutex stringValueMtx_;
+    std::unordered_map<TagHandle, std::string> stringValues_;
+};
@@ -1,4 +1,11 @@
 #include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+// 各优先级权重（SYSTEM/HIGH/NORMAL/LOW），积压时按此比例分配工作线程
+constexpr std::array<uint64_t, kTaskPriorityCount> kWeights = {16, 8, 4, 1};
+constexpr uint64_t kStride = 1u << 16;
+}
 
 ThreadPool::ThreadPool(size_t numThreads) : stop_(false) {
     for (size_t i = 0; i < numThreads; ++i)
@@ -18,16 +25,68 @@ void ThreadPool::shutdown() {
     workers_.clear();
 }
 
+size_t ThreadPool::pendingTasks() const {
+    std::lock_guard<std::mutex> lock(queueMtx_);
+    return pending_;
+}
+
+void ThreadPool::push(const TaskPriority priority, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMtx_);
+        if (stop_)
+            throw std::runtime_error("ThreadPool is stopped");
+        const auto p = static_cast<size_t>(priority);
+        // 队列由空变为非空时从当前虚拟时间起算，空闲期间不积累额度
+        if (tasks_[p].empty()) pass_[p] = std::max(pass_[p], virtualTime_);
+        tasks_[p].push(std::move(task));
+        ++pending_;
+    }
+    cv_.notify_one();
+}
+
+std::function<void()> ThreadPool::pop() {
+    size_t best = kTaskPriorityCount;
+    for (size_t p = 0; p < kTaskPriorityCount; ++p) {
+        if (tasks_[p].empty()) continue;
+        if (best == kTaskPriorityCount || pass_[p] < pass_[best]) best = p;
+    }
+    virtualTime_ = pass_[best];
+    pass_[best] += kStride / kWeights[best];
+    auto task = std::move(tasks_[best].front());
+    tasks_[best].pop();
+    --pending_;
+    return task;
+}
+
 void ThreadPool::workerLoop() {
     while (!stop_) {
         std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(queueMtx_);
-            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
-            if (stop_ && tasks_.empty()) return;
-            task = std::move(tasks_.front());
-            tasks_.pop();
+            cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if (stop_ && pending_ == 0) return;
+            task = pop();
         }
         task();
     }
 }
+
+TaskPriority ThreadPool::parsePriority(const std::string& s) {
+    std::string str = s;
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    if (str == "system") return TaskPriority::SYSTEM;
+    if (str == "high")   return TaskPriority::HIGH;
+    if (str == "normal") return TaskPriority::NORMAL;
+    if (str == "low")    return TaskPriority::LOW;
+    throw std::invalid_argument("Unknown priority: " + s);
+}
+
+std::string ThreadPool::priorityToString(const TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::SYSTEM: return "system";
+        case TaskPriority::HIGH:   return "high";
+        case TaskPriority::NORMAL: return "normal";
+        case TaskPriority::LOW:    return "low";
+        default: return "?";
+    }
+}
@@ -1,6 +1,8 @@
 #pragma once
+#include <array>
 #include <vector>
 #include <queue>
+#include <string>
 #include <thread>
 #include <future>
 #include <mutex>
@@ -8,6 +10,11 @@
 #include <functional>
 #include <atomic>
 
+// 任务优先级：SYSTEM 用于网关自身的系统任务（如负载调控），其余对应分组配置的 priority。
+// 写入在设备写线程中执行、重连在采集任务内完成，均不经线程池排队
+enum class TaskPriority : uint8_t { SYSTEM = 0, HIGH, NORMAL, LOW };
+constexpr size_t kTaskPriorityCount = 4;
+
 class ThreadPool {
 public:
     explicit ThreadPool(size_t numThreads);
@@ -16,17 +23,31 @@ public:
     // 通用任务投递
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
+    // 按优先级投递；各优先级按权重做加权公平调度，低优先级不会被饿死
+    template<class F, class... Args>
+    auto enqueueWithPriority(TaskPriority priority, F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
 
     void shutdown();
+    [[nodiscard]] size_t pendingTasks() const;
+    [[nodiscard]] size_t threadCount() const { return workers_.size(); }
+
+    static TaskPriority parsePriority(const std::string& s);
+    static std::string priorityToString(TaskPriority priority);
 
 private:
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    // 每个优先级一条队列；pass_ 为步幅调度的虚拟时间，每取出一个任务前进 kStride/权重
+    std::array<std::queue<std::function<void()>>, kTaskPriorityCount> tasks_;
+    std::array<uint64_t, kTaskPriorityCount> pass_{};
+    uint64_t virtualTime_ = 0;
+    size_t pending_ = 0;
 
-    std::mutex queueMtx_;
+    mutable std::mutex queueMtx_;
     std::condition_variable cv_;
     std::atomic<bool> stop_;
 
+    void push(TaskPriority priority, std::function<void()> task);
+    std::function<void()> pop();
     void workerLoop();
 };
 
@@ -1,45 +1,217 @@
 #include "TimerScheduler.h"
-#include "ThreadPool.h"
+#include <algorithm>
+#include <vector>
+#include "Logger.h"
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+void JitterHistogram::record(const uint64_t us) {
+    counts_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    samples_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t prev = maxUs_.load(std::memory_order_relaxed);
+    while (us > prev && !maxUs_.compare_exchange_weak(prev, us)) {}
+}
+
+size_t JitterHistogram::bucketOf(const uint64_t us) {
+    if (us < (1u << kSubBits)) return static_cast<size_t>(us);
+    size_t msb = 63;
+    while (!(us >> msb)) --msb;
+    const size_t sub = static_cast<size_t>(us >> (msb - kSubBits)) & ((1u << kSubBits) - 1);
+    return std::min(kBuckets - 1, ((msb - kSubBits + 1) << kSubBits) + sub);
+}
+
+uint64_t JitterHistogram::upperBound(const size_t bucket) {
+    if (bucket < (1u << kSubBits)) return bucket;
+    const size_t msb = (bucket >> kSubBits) + kSubBits - 1;
+    const uint64_t sub = bucket & ((1u << kSubBits) - 1);
+    return (((uint64_t{1} << kSubBits | sub) + 1) << (msb - kSubBits)) - 1;
+}
+
+JitterStats JitterHistogram::snapshot() const {
+    JitterStats st;
+    std::array<uint64_t, kBuckets> counts{};
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        st.samples += counts[i];
+    }
+    st.maxUs = static_cast<uint32_t>(std::min<uint64_t>(maxUs_.load(), UINT32_MAX));
+    if (st.samples == 0) return st;
+    const auto percentile = [&](const double q) {
+        const auto target = static_cast<uint64_t>(q * static_cast<double>(st.samples - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= target) return static_cast<uint32_t>(std::min<uint64_t>(upperBound(i), st.maxUs));
+        }
+        return st.maxUs;
+    };
+    st.p50Us = percentile(0.50);
+    st.p95Us = percentile(0.95);
+    st.p99Us = percentile(0.99);
+    return st;
+}
 
 TimerScheduler::TimerScheduler(std::shared_ptr<ThreadPool> pool)
     : running_(false), pool_(std::move(pool)) {}
 
 TimerScheduler::~TimerScheduler() {
     stop();
+#ifdef __linux__
+    if (timerFd_ >= 0) ::close(timerFd_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+#endif
+}
+
+void TimerScheduler::configure(const TimerConfig& cfg) {
+    cfg_ = cfg;
+    if (cfg_.backend != "timerfd") return;
+#ifdef __linux__
+    if (timerFd_ < 0) timerFd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wakeFd_ < 0) wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (timerFd_ >= 0 && wakeFd_ >= 0) {
+        GLOG_INFO("定时器使用 timerfd 后端，到期前忙等 " + std::to_string(cfg_.spinUs) + "us");
+        return;
+    }
+    GLOG_WARN("timerfd 创建失败，退回条件变量定时");
+    if (timerFd_ >= 0) ::close(timerFd_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+    timerFd_ = wakeFd_ = -1;
+#else
+    GLOG_WARN("timerfd 仅支持 Linux，使用条件变量定时");
+#endif
 }
 
 TimerScheduler::TimerHandle TimerScheduler::scheduleEvery(uint32_t intervalMs, std::function<void()> task) {
+    return scheduleEvery(intervalMs, std::move(task), intervalMs);
+}
+
+TimerScheduler::TimerHandle TimerScheduler::scheduleEvery(uint32_t intervalMs, std::function<void()> task,
+                                                          const uint32_t firstDelayMs) {
+    return scheduleEvery(intervalMs, std::move(task), firstDelayMs, TaskPriority::NORMAL);
+}
+
+TimerScheduler::TimerHandle TimerScheduler::scheduleEvery(uint32_t intervalMs, std::function<void()> task,
+                                                          const uint32_t firstDelayMs, const TaskPriority priority) {
     std::lock_guard<std::mutex> lock(mtx_);
     const TimerHandle id = nextId_++;
     ScheduledTask st;
     st.id = id;
     st.intervalMs = intervalMs;
     st.task = std::move(task);
-    st.nextRunTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs);
+    st.priority = priority;
+    st.nextRunTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(firstDelayMs);
     tasks_[id] = st;
-    cv_.notify_one();
+    wake();
     return id;
 }
 
 void TimerScheduler::cancel(const TimerHandle handle) {
     std::lock_guard<std::mutex> lock(mtx_);
     tasks_.erase(handle);
-    cv_.notify_one();
+    wake();
+}
+
+void TimerScheduler::setInterval(const TimerHandle handle, const uint32_t intervalMs) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (const auto it = tasks_.find(handle); it != tasks_.end()) it->second.intervalMs = intervalMs;
+}
+
+DispatchLag TimerScheduler::takeDispatchLag() {
+    DispatchLag out;
+    const uint64_t maxUs = lag_->maxUs.exchange(0);
+    const uint64_t sumUs = lag_->sumUs.exchange(0);
+    out.tasks = lag_->count.exchange(0);
+    out.maxMs = static_cast<uint32_t>(maxUs / 1000);
+    out.avgMs = out.tasks ? static_cast<uint32_t>(sumUs / out.tasks / 1000) : 0;
+    return out;
+}
+
+JitterStats TimerScheduler::getJitter(const TimerHandle handle) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const auto it = tasks_.find(handle);
+    return it != tasks_.end() ? it->second.jitter->snapshot() : JitterStats{};
 }
 
 void TimerScheduler::start() {
     if (running_) return;
     running_ = true;
     timerThread_ = std::thread(&TimerScheduler::run, this);
+    applyAffinity();
 }
 
 void TimerScheduler::stop() {
     running_ = false;
-    cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        wake();
+    }
     if (timerThread_.joinable())
         timerThread_.join();
 }
 
+void TimerScheduler::wake() {
+    ++wakeGen_;
+    cv_.notify_all();
+#ifdef __linux__
+    if (wakeFd_ >= 0) {
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto n = ::write(wakeFd_, &one, sizeof(one));
+    }
+#endif
+}
+
+void TimerScheduler::applyAffinity() {
+    if (cfg_.cpu < 0) return;
+    bool ok = false;
+#ifdef _WIN32
+    ok = SetThreadAffinityMask(static_cast<HANDLE>(timerThread_.native_handle()), DWORD_PTR{1} << cfg_.cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cfg_.cpu, &set);
+    ok = pthread_setaffinity_np(timerThread_.native_handle(), sizeof(set), &set) == 0;
+#endif
+    if (ok) GLOG_INFO("定时线程绑定 CPU " + std::to_string(cfg_.cpu));
+    else GLOG_WARN("定时线程绑定 CPU " + std::to_string(cfg_.cpu) + " 失败");
+}
+
+void TimerScheduler::waitUntil(std::unique_lock<std::mutex>& lock, const std::chrono::steady_clock::time_point deadline) {
+    const uint64_t gen = wakeGen_;
+    const auto coarse = deadline - std::chrono::microseconds(cfg_.spinUs);
+#ifdef __linux__
+    if (timerFd_ >= 0) {
+        lock.unlock();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(coarse.time_since_epoch()).count();
+        itimerspec spec{};
+        spec.it_value.tv_sec = ns > 0 ? ns / 1000000000 : 0;
+        spec.it_value.tv_nsec = ns > 0 ? ns % 1000000000 : 1;
+        ::timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        pollfd fds[2] = {{timerFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        if (wakeGen_ == gen) ::poll(fds, 2, -1);
+        uint64_t drain;
+        [[maybe_unused]] auto n = ::read(timerFd_, &drain, sizeof(drain));
+        n = ::read(wakeFd_, &drain, sizeof(drain));
+        lock.lock();
+    } else
+#endif
+    {
+        cv_.wait_until(lock, coarse, [&] { return wakeGen_ != gen; });
+    }
+    if (cfg_.spinUs == 0 || wakeGen_ != gen) return;
+    // 最后一段忙等，不持锁，任务表变化时提前返回重新计算
+    lock.unlock();
+    while (std::chrono::steady_clock::now() < deadline && wakeGen_ == gen) std::this_thread::yield();
+    lock.lock();
+}
+
 void TimerScheduler::run() {
     while (running_) {
         std::unique_lock<std::mutex> lock(mtx_);
@@ -47,23 +219,43 @@ void TimerScheduler::run() {
             cv_.wait_for(lock, std::chrono::milliseconds(50));
             continue;
         }
-        // 找到最早到期任务
-        const auto nextIt = std::min_element(
-            tasks_.begin(), tasks_.end(),
-            [](const auto& a, const auto& b) { return a.second.nextRunTime < b.second.nextRunTime; }
-        );
-        if (auto now = std::chrono::steady_clock::now(); now >= nextIt->second.nextRunTime) {
-            ScheduledTask task = nextIt->second;
-            lock.unlock();
-            pool_->enqueue(task.task);
-            lock.lock();
-            if (tasks_.find(task.id) != tasks_.end()) {
-                tasks_[task.id].nextRunTime = now + std::chrono::milliseconds(task.intervalMs);
-            }
-            lock.unlock();
-        } else {
-            cv_.wait_until(lock, nextIt->second.nextRunTime);
+        // 收集全部到期任务，按优先级、到期时间排序后投递
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<ScheduledTask*> due;
+        auto earliest = std::chrono::steady_clock::time_point::max();
+        for (auto& [id, t] : tasks_) {
+            if (t.nextRunTime <= now) due.push_back(&t);
+            else earliest = std::min(earliest, t.nextRunTime);
+        }
+        if (due.empty()) {
+            waitUntil(lock, earliest);
+            continue;
+        }
+        std::sort(due.begin(), due.end(), [](const ScheduledTask* a, const ScheduledTask* b) {
+            if (a->priority != b->priority) return a->priority < b->priority;
+            return a->nextRunTime < b->nextRunTime;
+        });
+        std::vector<std::pair<TaskPriority, std::function<void()>>> batch;
+        batch.reserve(due.size());
+        for (auto* t : due) {
+            batch.emplace_back(t->priority, [lag = lag_, jitter = t->jitter, dueAt = t->nextRunTime, fn = t->task]() {
+                const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - dueAt).count());
+                lag->sumUs += us;
+                ++lag->count;
+                uint64_t prev = lag->maxUs.load(std::memory_order_relaxed);
+                while (us > prev && !lag->maxUs.compare_exchange_weak(prev, us)) {}
+                jitter->record(us);
+                fn();
+            });
+            // 按固定相位推进，采样时刻不随派发延迟累积漂移；落后超过一个周期时从当前时刻重新起算
+            const auto interval = std::chrono::milliseconds(t->intervalMs);
+            t->nextRunTime += interval;
+            if (t->nextRunTime <= now) t->nextRunTime = now + interval;
+        }
+        lock.unlock();
+        for (auto& [priority, fn] : batch) {
+            pool_->enqueueWithPriority(priority, std::move(fn));
         }
     }
 }
-
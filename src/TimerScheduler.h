@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <functional>
 #include <queue>
 #include <mutex>
@@ -6,14 +7,58 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include "ThreadPool.h"
 
-class ThreadPool;
+// 派发延迟：任务到期时刻到在线程池中开始执行的时间差
+struct DispatchLag {
+    uint32_t maxMs = 0;
+    uint32_t avgMs = 0;
+    uint64_t tasks = 0;
+};
+
+// 单个周期任务的抖动分位数（实际开始执行相对理想时刻的偏差）
+struct JitterStats {
+    uint64_t samples = 0;
+    uint32_t p50Us = 0;
+    uint32_t p95Us = 0;
+    uint32_t p99Us = 0;
+    uint32_t maxUs = 0;
+};
+
+// 对数分桶直方图：每个 2 的幂区间再分 4 档，误差不超过 25%，记录无锁
+class JitterHistogram {
+public:
+    void record(uint64_t us);
+    [[nodiscard]] JitterStats snapshot() const;
+
+private:
+    static constexpr size_t kSubBits = 2;
+    static constexpr size_t kBuckets = 40 << kSubBits;
+    static size_t bucketOf(uint64_t us);
+    static uint64_t upperBound(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> maxUs_{0};
+};
+
+// 定时精度配置：backend 为 "timerfd" 时在 Linux 上用 CLOCK_MONOTONIC 的 timerfd 等待，
+// 其他平台或创建失败时退回条件变量；spinUs > 0 时在到期前最后一段忙等以消除唤醒抖动
+struct TimerConfig {
+    std::string backend = "default";
+    uint32_t spinUs = 0;
+    int cpu = -1;       // 定时线程绑定的 CPU，-1 表示不绑定
+};
 
 struct ScheduledTask {
     size_t id;
     std::chrono::steady_clock::time_point nextRunTime;
     uint32_t intervalMs;
     std::function<void()> task;
+    TaskPriority priority = TaskPriority::NORMAL;
+    std::shared_ptr<JitterHistogram> jitter = std::make_shared<JitterHistogram>();
 };
 
 class TimerScheduler {
@@ -22,8 +67,20 @@ public:
 
     explicit TimerScheduler(std::shared_ptr<ThreadPool> pool);
     ~TimerScheduler();
+    // 需在 start 之前调用
+    void configure(const TimerConfig& cfg);
     TimerHandle scheduleEvery(uint32_t intervalMs, std::function<void()> task);
+    // firstDelayMs 指定首次执行的延迟，之后按 intervalMs 周期执行
+    TimerHandle scheduleEvery(uint32_t intervalMs, std::function<void()> task, uint32_t firstDelayMs);
+    // 同一时刻到期的任务按优先级先后投递，并以该优先级进入线程池
+    TimerHandle scheduleEvery(uint32_t intervalMs, std::function<void()> task, uint32_t firstDelayMs,
+                              TaskPriority priority);
     void cancel(TimerHandle handle);
+    // 修改周期，从下一次执行起生效
+    void setInterval(TimerHandle handle, uint32_t intervalMs);
+    // 取出自上次调用以来的派发延迟统计并清零
+    DispatchLag takeDispatchLag();
+    [[nodiscard]] JitterStats getJitter(TimerHandle handle);
     void start();
     void stop();
 
@@ -35,6 +92,23 @@ private:
     std::shared_ptr<ThreadPool> pool_;
     std::atomic<size_t> nextId_{1};
     std::unordered_map<TimerHandle, ScheduledTask> tasks_;
+
+    struct LagWindow {
+        std::atomic<uint64_t> maxUs{0};
+        std::atomic<uint64_t> sumUs{0};
+        std::atomic<uint64_t> count{0};
+    };
+    // 任务可能在调度器销毁后才执行，统计窗口由包装后的任务共同持有
+    std::shared_ptr<LagWindow> lag_ = std::make_shared<LagWindow>();
+
+    TimerConfig cfg_;
+    // 任务表变化计数：等待期间增加说明需要重新计算最早到期时间
+    std::atomic<uint64_t> wakeGen_{0};
+    int timerFd_ = -1;
+    int wakeFd_ = -1;
+
     void run();
+    void wake();
+    void waitUntil(std::unique_lock<std::mutex>& lock, std::chrono::steady_clock::time_point deadline);
+    void applyAffinity();
 };
-
@@ -2,19 +2,68 @@
 #include <stdexcept>
 #include <algorithm>
 #include <utility>
+#include "DataBuffer.h"
+#include "FastClock.h"
+#include "TagRegistry.h"
 
 Variable::Variable(std::string  id,
                    std::string  name,
                    std::wstring  address,
                    const VarType type,
                    const VarAccess access)
-    : id_(std::move(id)), name_(std::move(name)), address_(std::move(address)),
-      type_(type), access_(access), quality_(VarQuality::UNCERTAIN) {}
+    : handle_(TagRegistry::instance().acquire(id, name, address, type, access)) {}
+
+Variable::~Variable() {
+    TagRegistry::instance().release(handle_);
+}
 
 void Variable::setValue(const ValueType& value, const VarQuality quality) {
-    value_ = value;
-    quality_ = quality;
-    timestamp_ = std::chrono::system_clock::now();
+    setValue(value, quality, FastClock::now());
+}
+
+void Variable::setValue(const ValueType& value, const VarQuality quality,
+                        const std::chrono::system_clock::time_point timestamp) {
+    DataBuffer::instance().set(handle_, value, timestamp, quality);
+}
+
+Variable::ValueType Variable::getValue() const {
+    return TagRegistry::instance().load(handle_).value;
+}
+
+void Variable::setQuality(const VarQuality quality) {
+    setQuality(quality, FastClock::now());
+}
+
+void Variable::setQuality(const VarQuality quality, const std::chrono::system_clock::time_point timestamp) {
+    DataBuffer::instance().setQuality(handle_, quality, timestamp);
+}
+
+VarQuality Variable::getQuality() const {
+    return TagRegistry::instance().quality(handle_);
+}
+
+std::chrono::system_clock::time_point Variable::getTimestamp() const {
+    return TagRegistry::instance().load(handle_).timestamp;
+}
+
+std::string Variable::getId() const {
+    return std::string(TagRegistry::instance().id(handle_));
+}
+
+std::string Variable::getName() const {
+    return std::string(TagRegistry::instance().name(handle_));
+}
+
+std::wstring Variable::getAddress() const {
+    return TagRegistry::instance().address(handle_);
+}
+
+VarType Variable::getType() const {
+    return TagRegistry::instance().type(handle_);
+}
+
+VarAccess Variable::getAccess() const {
+    return TagRegistry::instance().access(handle_);
 }
 
 VarAccess Variable::parseAccess(const std::string& s) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <variant>
 #include <chrono>
@@ -7,6 +8,10 @@ enum class VarType { BOOL, INT16, UINT16, INT32, UINT32, INT64, UINT64, FLOAT, D
 enum class VarQuality { GOOD, BAD, UNCERTAIN };
 enum class VarAccess { RO, RW, WO };
 
+// 标签句柄：TagRegistry 中的紧凑下标
+using TagHandle = uint32_t;
+constexpr TagHandle kInvalidTag = 0xFFFFFFFF;
+
 class Variable {
 public:
     using ValueType = std::variant<std::string,bool, int16_t, uint16_t, int32_t, uint32_t, int64_t, uint64_t, float, double>;
@@ -16,30 +21,30 @@ public:
              std::wstring  address,
              VarType type,
              VarAccess access);
-    virtual ~Variable() = default;
+    virtual ~Variable();
+    Variable(const Variable&) = delete;
+    Variable& operator=(const Variable&) = delete;
+    // 值与元数据都存放在 TagRegistry 中，Variable 对象本身只持有句柄
     void setValue(const ValueType& value, VarQuality quality);
-    [[nodiscard]] ValueType getValue() const { return value_; }
-    void setQuality(const VarQuality quality) { quality_ = quality; }
-    [[nodiscard]] VarQuality getQuality() const { return quality_; }
-    [[nodiscard]] std::chrono::system_clock::time_point getTimestamp() const { return timestamp_; }
-    [[nodiscard]] std::string getId() const { return id_; }
-    [[nodiscard]] std::string getName() const { return name_; }
-    [[nodiscard]] std::wstring getAddress() const { return address_; }
-    [[nodiscard]] VarType getType() const { return type_; }
-    [[nodiscard]] VarAccess getAccess() const { return access_; }
-    [[nodiscard]] std::string getVarid() const { return id_; }
+    // 同一次响应的变量共用 timestamp，避免逐变量取时间
+    void setValue(const ValueType& value, VarQuality quality, std::chrono::system_clock::time_point timestamp);
+    [[nodiscard]] ValueType getValue() const;
+    void setQuality(VarQuality quality);
+    void setQuality(VarQuality quality, std::chrono::system_clock::time_point timestamp);
+    [[nodiscard]] VarQuality getQuality() const;
+    [[nodiscard]] std::chrono::system_clock::time_point getTimestamp() const;
+    [[nodiscard]] std::string getId() const;
+    [[nodiscard]] std::string getName() const;
+    [[nodiscard]] std::wstring getAddress() const;
+    [[nodiscard]] VarType getType() const;
+    [[nodiscard]] VarAccess getAccess() const;
+    [[nodiscard]] std::string getVarid() const { return getId(); }
+    [[nodiscard]] TagHandle getHandle() const { return handle_; }
     static VarType parseType(const std::string& s);
     static VarAccess parseAccess(const std::string& s);
     static std::string typeToString(VarType type);
     static std::string accessToString(VarAccess access);
 
 protected:
-    std::string id_;
-    std::string name_;
-    std::wstring address_;
-    VarType type_;
-    VarAccess access_;
-    ValueType value_;
-    VarQuality quality_;
-    std::chrono::system_clock::time_point timestamp_;
+    TagHandle handle_;
 };
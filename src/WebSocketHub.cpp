@@ -0,0 +1,373 @@
+#include "WebSocketHub.h"
+#include <algorithm>
+#include <boost/json.hpp>
+#include "DeviceManager.h"
+#include "Logger.h"
+#include "SocketUtil.h"
+#include "TagJsonWriter.h"
+
+namespace {
+constexpr char kWsGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr size_t kMaxClientFrame = 64 * 1024;      // 客户端只发订阅等控制消息
+constexpr size_t kMaxPendingReply = 256 * 1024;    // 客户端触发、尚未发完的应答帧字节上限
+constexpr uint32_t kMinIntervalMs = 20;
+constexpr auto kPollCap = std::chrono::milliseconds(50);
+constexpr auto kResolveEvery = std::chrono::seconds(5);   // 热加载后重新解析订阅范围
+
+enum Opcode : uint8_t { kText = 0x1, kClose = 0x8, kPing = 0x9, kPong = 0xA };
+
+uint32_t rotl(const uint32_t v, const int n) { return v << n | v >> (32 - n); }
+
+void sha1(const std::string_view data, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string msg(data);
+    const uint64_t bitLen = static_cast<uint64_t>(data.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) msg.push_back('\0');
+    for (int i = 7; i >= 0; --i) msg.push_back(static_cast<char>(bitLen >> (i * 8)));
+    for (size_t off = 0; off < msg.size(); off += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const uint8_t*>(msg.data() + off + i * 4);
+            w[i] = uint32_t{p[0]} << 24 | uint32_t{p[1]} << 16 | uint32_t{p[2]} << 8 | p[3];
+        }
+        for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            const uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotl(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 4; ++j) digest[i * 4 + j] = static_cast<uint8_t>(h[i] >> (24 - j * 8));
+    }
+}
+
+std::string base64(const uint8_t* data, const size_t n) {
+    static constexpr char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < n; i += 3) {
+        const uint32_t v = uint32_t{data[i]} << 16 | (i + 1 < n ? uint32_t{data[i + 1]} << 8 : 0) |
+                           (i + 2 < n ? data[i + 2] : 0);
+        out.push_back(kTable[v >> 18 & 63]);
+        out.push_back(kTable[v >> 12 & 63]);
+        out.push_back(i + 1 < n ? kTable[v >> 6 & 63] : '=');
+        out.push_back(i + 2 < n ? kTable[v & 63] : '=');
+    }
+    return out;
+}
+
+std::vector<std::string> stringArray(const boost::json::object& obj, const char* key) {
+    std::vector<std::string> out;
+    if (const auto* v = obj.if_contains(key); v && v->is_array()) {
+        for (const auto& item : v->get_array()) {
+            if (item.is_string()) out.emplace_back(item.get_string());
+        }
+    }
+    return out;
+}
+}
+
+WebSocketHub::WebSocketHub(std::shared_ptr<DeviceManager> manager, Config cfg)
+    : manager_(std::move(manager)), cfg_(cfg) {}
+
+WebSocketHub::~WebSocketHub() {
+    stop();
+}
+
+void WebSocketHub::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread(&WebSocketHub::run, this);
+}
+
+void WebSocketHub::stop() {
+    if (!running_.exchange(false)) return;
+    if (thread_.joinable()) thread_.join();
+    for (const auto& c : clients_) net::closeSocket(c->fd);
+    clients_.clear();
+    std::lock_guard<std::mutex> lock(incomingMtx_);
+    for (const auto& c : incoming_) net::closeSocket(c->fd);
+    incoming_.clear();
+    clientCount_ = 0;
+}
+
+std::string WebSocketHub::acceptKey(const std::string_view clientKey) {
+    uint8_t digest[20];
+    sha1(std::string(clientKey) + kWsGuid, digest);
+    return base64(digest, sizeof(digest));
+}
+
+bool WebSocketHub::adopt(const uintptr_t fd, std::string pendingInput) {
+    if (!running_ || clientCount_.load() >= static_cast<size_t>(std::max(1, cfg_.maxClients))) return false;
+    net::setNonBlocking(fd);
+    auto client = std::make_unique<Client>();
+    client->fd = fd;
+    client->in = std::move(pendingInput);
+    client->intervalMs = std::max(kMinIntervalMs, cfg_.intervalMs);
+    ++clientCount_;
+    std::lock_guard<std::mutex> lock(incomingMtx_);
+    incoming_.push_back(std::move(client));
+    return true;
+}
+
+WebSocketHub::Stats WebSocketHub::getStats() const {
+    Stats st;
+    st.clients = clientCount_;
+    st.framesSent = framesSent_;
+    st.skippedFlushes = skippedFlushes_;
+    return st;
+}
+
+void WebSocketHub::run() {
+    std::vector<pollfd> fds;
+    auto nextResolve = std::chrono::steady_clock::now() + kResolveEvery;
+    while (running_) {
+        {
+            std::lock_guard<std::mutex> lock(incomingMtx_);
+            for (auto& c : incoming_) {
+                GLOG_INFO("WebSocket 客户端接入，当前 " + std::to_string(clientCount_.load()) + " 个");
+                clients_.push_back(std::move(c));
+            }
+            incoming_.clear();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto wake = now + kPollCap;
+        fds.clear();
+        for (const auto& c : clients_) {
+            short events = POLLIN;
+            if (c->outOffset < c->out.size()) events |= POLLOUT;
+            fds.push_back({net::native(c->fd), events, 0});
+            if (c->subscribed) wake = std::min(wake, c->nextFlush);
+        }
+        const auto timeout = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+        if (fds.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        else net::pollSockets(fds.data(), fds.size(), static_cast<int>(timeout));
+
+        now = std::chrono::steady_clock::now();
+        const bool reresolve = now >= nextResolve;
+        if (reresolve) nextResolve = now + kResolveEvery;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            auto& c = *clients_[i];
+            const short revents = i < fds.size() ? fds[i].revents : 0;
+            if ((revents & (POLLIN | POLLERR | POLLHUP)) && !readFrames(c)) c.closing = true;
+            if (c.closing) continue;
+            if (reresolve && c.subscribed) resolve(c);
+            if (c.subscribed && now >= c.nextFlush) {
+                flush(c);
+                c.nextFlush = std::max(c.nextFlush + std::chrono::milliseconds(c.intervalMs), now);
+            }
+            if (!drain(c)) c.closing = true;
+        }
+        const auto removed = std::remove_if(clients_.begin(), clients_.end(), [this](const std::unique_ptr<Client>& c) {
+            if (!c->closing) return false;
+            drain(*c);
+            net::closeSocket(c->fd);
+            --clientCount_;
+            GLOG_INFO("WebSocket 客户端断开，当前 " + std::to_string(clientCount_.load()) + " 个");
+            return true;
+        });
+        clients_.erase(removed, clients_.end());
+    }
+}
+
+bool WebSocketHub::readFrames(Client& c) {
+    char buf[4096];
+    for (;;) {
+        const int n = net::recvSome(c.fd, buf, sizeof(buf));
+        if (n == -1) break;
+        if (n <= 0) return false;
+        c.in.append(buf, static_cast<size_t>(n));
+        if (c.in.size() > kMaxClientFrame + 14) break;
+    }
+    while (c.in.size() >= 2) {
+        const auto b0 = static_cast<uint8_t>(c.in[0]);
+        const auto b1 = static_cast<uint8_t>(c.in[1]);
+        const bool fin = b0 & 0x80;
+        const uint8_t opcode = b0 & 0x0F;
+        // 客户端帧必须带掩码
+        if (!(b1 & 0x80)) return false;
+        uint64_t len = b1 & 0x7F;
+        size_t hdr = 2;
+        if (len == 126) {
+            if (c.in.size() < 4) return true;
+            len = uint64_t{static_cast<uint8_t>(c.in[2])} << 8 | static_cast<uint8_t>(c.in[3]);
+            hdr = 4;
+        } else if (len == 127) {
+            if (c.in.size() < 10) return true;
+            len = 0;
+            for (int i = 0; i < 8; ++i) len = len << 8 | static_cast<uint8_t>(c.in[2 + i]);
+            hdr = 10;
+        }
+        if (len > kMaxClientFrame || (opcode >= kClose && len > 125)) return false;
+        if (c.in.size() < hdr + 4 + len) return true;
+        const char* mask = c.in.data() + hdr;
+        std::string payload(c.in.data() + hdr + 4, static_cast<size_t>(len));
+        for (size_t i = 0; i < payload.size(); ++i) payload[i] ^= mask[i & 3];
+        c.in.erase(0, hdr + 4 + static_cast<size_t>(len));
+
+        switch (opcode) {
+            case kText:
+                if (fin) handleMessage(c, payload);
+                else queueError(c, "fragmented messages are not supported");
+                break;
+            case kPing:
+                queueReply(c, kPong, payload);
+                break;
+            case kClose:
+                queueReply(c, kClose, std::string_view(payload).substr(0, 2));
+                return false;
+            default:
+                break;
+        }
+        if (c.closing) return false;
+    }
+    return true;
+}
+
+void WebSocketHub::handleMessage(Client& c, const std::string_view text) {
+    boost::json::error_code ec;
+    const auto doc = boost::json::parse(text, ec);
+    if (ec || !doc.is_object()) {
+        queueError(c, "invalid json");
+        return;
+    }
+    const auto& obj = doc.get_object();
+    if (const auto* iv = obj.if_contains("interval_ms"); iv && iv->is_int64())
+        c.intervalMs = std::max<uint32_t>(kMinIntervalMs, static_cast<uint32_t>(std::min<int64_t>(iv->get_int64(), 3600000)));
+    const auto* sub = obj.if_contains("subscribe");
+    if (!sub || !sub->is_object()) {
+        queueError(c, "missing subscribe");
+        return;
+    }
+    const auto& s = sub->get_object();
+    c.tags = stringArray(s, "tags");
+    c.patterns.clear();
+    for (auto& dev : stringArray(s, "devices")) c.patterns.emplace_back(std::move(dev), "*");
+    for (const auto& grp : stringArray(s, "groups")) {
+        const auto slash = grp.find('/');
+        if (slash == std::string::npos) c.patterns.emplace_back("*", grp);
+        else c.patterns.emplace_back(grp.substr(0, slash), grp.substr(slash + 1));
+    }
+    // 新订阅从全量开始
+    c.handles.clear();
+    c.fresh.clear();
+    c.lastSeq = TagRegistry::instance().changeSeq();
+    resolve(c);
+    c.subscribed = true;
+    c.nextFlush = std::chrono::steady_clock::now();
+}
+
+void WebSocketHub::resolve(Client& c) {
+    std::vector<TagHandle> handles;
+    auto& reg = TagRegistry::instance();
+    for (const auto& id : c.tags) {
+        if (const TagHandle h = reg.find(id); h != kInvalidTag) handles.push_back(h);
+    }
+    for (const auto& [dev, grp] : c.patterns) manager_->collectTagHandlesMatching(dev, grp, handles);
+    std::sort(handles.begin(), handles.end());
+    handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+    std::set_difference(handles.begin(), handles.end(), c.handles.begin(), c.handles.end(),
+                        std::back_inserter(c.fresh));
+    c.handles = std::move(handles);
+}
+
+void WebSocketHub::flush(Client& c) {
+    // 上一帧尚未发完：本周期不组帧，变化留到下一帧按最新值发送
+    if (c.outOffset < c.out.size()) {
+        ++skippedFlushes_;
+        return;
+    }
+    auto& reg = TagRegistry::instance();
+    // 先取已提交水位再扫描：不大于水位的变化都已写入 changedAt，下次从水位继续不会漏掉
+    const uint64_t seq = reg.changeSeq();
+    changed_.clear();
+    if (seq > c.lastSeq) {
+        for (const TagHandle h : c.handles) {
+            if (reg.changedAt(h) > c.lastSeq) changed_.push_back(h);
+        }
+    }
+    if (!c.fresh.empty()) {
+        changed_.insert(changed_.end(), c.fresh.begin(), c.fresh.end());
+        std::sort(changed_.begin(), changed_.end());
+        changed_.erase(std::unique(changed_.begin(), changed_.end()), changed_.end());
+        c.fresh.clear();
+    }
+    c.lastSeq = seq;
+    if (changed_.empty()) return;
+
+    frame_.clear();
+    frame_.reserve(64 + changed_.size() * 112);
+    TagJsonWriter w(frame_);
+    w.raw("{\"seq\":");
+    w.number(seq);
+    w.raw(",\"count\":");
+    w.number(static_cast<uint64_t>(changed_.size()));
+    w.raw(",\"tags\":[");
+    for (size_t i = 0; i < changed_.size(); ++i) {
+        if (i) w.raw(',');
+        w.publishedTag(changed_[i]);
+    }
+    w.raw("]}");
+    queueFrame(c, kText, frame_);
+    ++framesSent_;
+}
+
+bool WebSocketHub::drain(Client& c) {
+    if (c.outOffset >= c.out.size()) return true;
+    const auto sent = net::sendSome(c.fd, std::string_view(c.out).substr(c.outOffset));
+    if (sent < 0) return false;
+    c.outOffset += static_cast<size_t>(sent);
+    if (c.outOffset == c.out.size()) {
+        c.out.clear();
+        c.outOffset = 0;
+        c.replyBytes = 0;
+    }
+    return true;
+}
+
+void WebSocketHub::queueFrame(Client& c, const uint8_t opcode, const std::string_view payload) {
+    // 已发送部分先丢弃，保证缓冲区只含未发送字节
+    if (c.outOffset > 0) {
+        c.out.erase(0, c.outOffset);
+        c.outOffset = 0;
+    }
+    c.out.push_back(static_cast<char>(0x80 | opcode));
+    const uint64_t len = payload.size();
+    if (len < 126) {
+        c.out.push_back(static_cast<char>(len));
+    } else if (len <= 0xFFFF) {
+        c.out.push_back(static_cast<char>(126));
+        c.out.push_back(static_cast<char>(len >> 8));
+        c.out.push_back(static_cast<char>(len));
+    } else {
+        c.out.push_back(static_cast<char>(127));
+        for (int i = 7; i >= 0; --i) c.out.push_back(static_cast<char>(len >> (i * 8)));
+    }
+    c.out.append(payload);
+}
+
+void WebSocketHub::queueReply(Client& c, const uint8_t opcode, const std::string_view payload) {
+    // 客户端只发不收时应答会一直积压，超过上限直接断开
+    c.replyBytes += payload.size() + 14;
+    if (c.replyBytes > kMaxPendingReply) {
+        c.closing = true;
+        return;
+    }
+    queueFrame(c, opcode, payload);
+}
+
+void WebSocketHub::queueError(Client& c, const std::string_view message) {
+    std::string body;
+    TagJsonWriter w(body);
+    w.raw("{\"error\":");
+    w.string(message);
+    w.raw('}');
+    queueReply(c, kText, body);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TagRegistry.h"
+
+class DeviceManager;
+
+// WebSocket 变化推送：HttpServer 完成握手后把连接交给这里，由单个线程服务全部客户端。
+// 客户端发送文本帧订阅：
+//   {"subscribe":{"tags":["id",..],"devices":["dev*",..],"groups":["dev1/grp?",..]},"interval_ms":200}
+// 服务端按客户端周期推送 {"seq":N,"count":k,"tags":[..]}，首帧为订阅范围内的全量值。
+// 每个客户端最多只有一帧待发送；上一帧未发完时跳过本周期，发完后从上次序号起取当前值，
+// 因此慢客户端只收到每个标签的最新值，内存不随积压增长；只发 ping 不收数据的客户端在应答积压超限后断开
+class WebSocketHub {
+public:
+    struct Config {
+        uint32_t intervalMs = 200;      // 默认推送周期，客户端可在订阅时覆盖
+        int maxClients = 64;
+    };
+    struct Stats {
+        size_t clients = 0;
+        uint64_t framesSent = 0;
+        uint64_t skippedFlushes = 0;    // 因客户端未收完上一帧而合并到下一帧的推送次数
+    };
+
+    WebSocketHub(std::shared_ptr<DeviceManager> manager, Config cfg);
+    ~WebSocketHub();
+    WebSocketHub(const WebSocketHub&) = delete;
+    WebSocketHub& operator=(const WebSocketHub&) = delete;
+
+    void start();
+    void stop();
+    // 接管已完成握手的连接；pendingInput 为握手请求之后已读到的字节。客户端已满时返回 false
+    bool adopt(uintptr_t fd, std::string pendingInput);
+    [[nodiscard]] Stats getStats() const;
+
+    // Sec-WebSocket-Accept = base64(sha1(key + GUID))
+    static std::string acceptKey(std::string_view clientKey);
+
+private:
+    struct Client {
+        uintptr_t fd;
+        std::string in;
+        std::string out;                 // 待发送字节，最多一帧数据加少量应答帧
+        size_t outOffset = 0;
+        size_t replyBytes = 0;           // out 中客户端触发的应答帧（pong、close、错误）字节，发完清零
+        std::vector<std::string> tags;
+        std::vector<std::pair<std::string, std::string>> patterns;   // (设备, 分组) 通配符
+        std::vector<TagHandle> handles;  // 有序，便于重新解析时找出新增标签
+        std::vector<TagHandle> fresh;    // 新加入订阅、下一帧需全量发送的标签
+        uint64_t lastSeq = 0;
+        uint32_t intervalMs = 0;
+        std::chrono::steady_clock::time_point nextFlush;
+        bool subscribed = false;
+        bool closing = false;
+    };
+
+    void run();
+    bool readFrames(Client& c);
+    void handleMessage(Client& c, std::string_view text);
+    void resolve(Client& c);
+    void flush(Client& c);
+    bool drain(Client& c);
+    static void queueFrame(Client& c, uint8_t opcode, std::string_view payload);
+    // 应答累计超过上限时不再入队并标记断开
+    static void queueReply(Client& c, uint8_t opcode, std::string_view payload);
+    static void queueError(Client& c, std::string_view message);
+
+    std::shared_ptr<DeviceManager> manager_;
+    Config cfg_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    std::vector<std::unique_ptr<Client>> clients_;     // 仅服务线程访问
+    mutable std::mutex incomingMtx_;
+    std::vector<std::unique_ptr<Client>> incoming_;
+    std::atomic<size_t> clientCount_{0};
+    std::atomic<uint64_t> framesSent_{0};
+    std::atomic<uint64_t> skippedFlushes_{0};
+
+    std::string frame_;                  // 组帧复用缓冲区
+    std::vector<TagHandle> changed_;
+};
@@ -0,0 +1,317 @@
+#include "iot_shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* 读取方重试上限：写入方的临界区只有几次存储，超过上限视为写入方异常 */
+#define IOT_SHM_MAX_RETRIES 100000
+
+/*
+ * 共享内存中的字段由网关以 C++ 原子变量写入。这里按各编译器的方式做相应宽度的读取：
+ * GCC/Clang 用 __atomic 内建函数，MSVC 用 volatile 读取（x86/x64 的 /volatile:ms 语义下即为获取语义），
+ * 另在 ARM 上补内存屏障。
+ */
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define IOT_LOAD32(p) (*(const volatile uint32_t*)(p))
+#define IOT_LOAD64(p) (*(const volatile uint64_t*)(p))
+#define IOT_LOAD8(p) (*(const volatile uint8_t*)(p))
+static __forceinline void iot_fence_acquire(void) {
+#if defined(_M_ARM64) || defined(_M_ARM)
+    __dmb(_ARM64_BARRIER_ISH);
+#else
+    _ReadWriteBarrier();
+#endif
+}
+static __forceinline void iot_cpu_relax(void) {
+#if defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#endif
+}
+#else
+#define IOT_LOAD32(p) __atomic_load_n((const uint32_t*)(p), __ATOMIC_RELAXED)
+#define IOT_LOAD64(p) __atomic_load_n((const uint64_t*)(p), __ATOMIC_RELAXED)
+#define IOT_LOAD8(p) __atomic_load_n((const uint8_t*)(p), __ATOMIC_RELAXED)
+static inline void iot_fence_acquire(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+static inline void iot_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+#endif
+
+struct iot_shm {
+    const uint8_t* base;
+    size_t size;
+    const iot_shm_header* hdr;
+    const iot_shm_slot* slots;
+    const char* names;
+    const uint32_t* index;
+    uint32_t capacity;
+    uint32_t indexMask;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+static void iot_shm_unmap(iot_shm* shm) {
+#ifdef _WIN32
+    if (shm->base) UnmapViewOfFile(shm->base);
+    if (shm->mapping) CloseHandle(shm->mapping);
+#else
+    if (shm->base) munmap((void*)shm->base, shm->size);
+#endif
+}
+
+static int iot_shm_validate(iot_shm* shm) {
+    const iot_shm_header* h = (const iot_shm_header*)shm->base;
+    uint64_t slotsEnd, namesEnd, indexEnd;
+    if (shm->size < sizeof(iot_shm_header)) return IOT_SHM_BAD_FORMAT;
+    if (h->magic != IOT_SHM_MAGIC || h->version != IOT_SHM_VERSION) return IOT_SHM_BAD_FORMAT;
+    if (h->total_size > shm->size || ((uint64_t)h->index_mask + 1) & h->index_mask) return IOT_SHM_BAD_FORMAT;
+    slotsEnd = h->slots_offset + (uint64_t)h->capacity * sizeof(iot_shm_slot);
+    namesEnd = h->names_offset + (uint64_t)h->capacity * IOT_SHM_NAME_BYTES;
+    indexEnd = h->index_offset + ((uint64_t)h->index_mask + 1) * sizeof(uint32_t);
+    if (slotsEnd > h->total_size || namesEnd > h->total_size || indexEnd > h->total_size) return IOT_SHM_BAD_FORMAT;
+    shm->hdr = h;
+    shm->slots = (const iot_shm_slot*)(shm->base + h->slots_offset);
+    shm->names = (const char*)(shm->base + h->names_offset);
+    shm->index = (const uint32_t*)(shm->base + h->index_offset);
+    shm->capacity = h->capacity;
+    shm->indexMask = h->index_mask;
+    return IOT_SHM_OK;
+}
+
+int iot_shm_open(const char* name, iot_shm** out) {
+    iot_shm* shm;
+    int rc;
+    char path[256];
+    if (!name || !*name || !out) return IOT_SHM_ERROR;
+    shm = (iot_shm*)calloc(1, sizeof(iot_shm));
+    if (!shm) return IOT_SHM_ERROR;
+#ifdef _WIN32
+    {
+        MEMORY_BASIC_INFORMATION info;
+        if (snprintf(path, sizeof(path), "Local\\%s", name) >= (int)sizeof(path)) goto fail;
+        shm->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+        if (!shm->mapping) goto fail;
+        shm->base = (const uint8_t*)MapViewOfFile(shm->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!shm->base || !VirtualQuery(shm->base, &info, sizeof(info))) goto fail;
+        shm->size = info.RegionSize;
+    }
+#else
+    {
+        struct stat st;
+        int fd;
+        if (snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name) >= (int)sizeof(path)) goto fail;
+        fd = shm_open(path, O_RDONLY, 0);
+        if (fd < 0) goto fail;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            goto fail;
+        }
+        shm->size = (size_t)st.st_size;
+        shm->base = (const uint8_t*)mmap(NULL, shm->size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (shm->base == MAP_FAILED) {
+            shm->base = NULL;
+            goto fail;
+        }
+    }
+#endif
+    rc = iot_shm_validate(shm);
+    if (rc != IOT_SHM_OK) {
+        iot_shm_close(shm);
+        return rc;
+    }
+    *out = shm;
+    return IOT_SHM_OK;
+fail:
+    iot_shm_close(shm);
+    return IOT_SHM_ERROR;
+}
+
+void iot_shm_close(iot_shm* shm) {
+    if (!shm) return;
+    iot_shm_unmap(shm);
+    free(shm);
+}
+
+uint32_t iot_shm_capacity(const iot_shm* shm) { return shm->capacity; }
+
+static int64_t iot_shm_now_ms(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER t;
+    GetSystemTimeAsFileTime(&ft);
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    /* 1601-01-01 起的 100ns 计数换算为 Unix 毫秒 */
+    return (int64_t)(t.QuadPart / 10000) - 11644473600000LL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+int iot_shm_alive(const iot_shm* shm) {
+    const uint64_t pid = IOT_LOAD64(&shm->hdr->publisher_pid);
+    if (!IOT_LOAD32(&shm->hdr->state)) return 0;
+    /* 只判断心跳落后；系统时间被回拨时差值为负，不误判 */
+    if (iot_shm_now_ms() - (int64_t)IOT_LOAD64(&shm->hdr->heartbeat_ms) > IOT_SHM_STALE_MS) return 0;
+#ifdef _WIN32
+    {
+        DWORD code = 0;
+        HANDLE proc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+        int running = 1;
+        if (proc) {
+            running = GetExitCodeProcess(proc, &code) && code == STILL_ACTIVE;
+            CloseHandle(proc);
+        }
+        return running;
+    }
+#else
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+static double iot_shm_to_double(uint8_t kind, uint64_t bits) {
+    switch (kind) {
+        case IOT_SHM_KIND_BOOL: return bits != 0 ? 1.0 : 0.0;
+        case IOT_SHM_KIND_INT16: return (double)(int16_t)bits;
+        case IOT_SHM_KIND_UINT16: return (double)(uint16_t)bits;
+        case IOT_SHM_KIND_INT32: return (double)(int32_t)bits;
+        case IOT_SHM_KIND_UINT32: return (double)(uint32_t)bits;
+        case IOT_SHM_KIND_INT64: return (double)(int64_t)bits;
+        case IOT_SHM_KIND_UINT64: return (double)bits;
+        case IOT_SHM_KIND_FLOAT: {
+            float f;
+            uint32_t b = (uint32_t)bits;
+            memcpy(&f, &b, sizeof(f));
+            return (double)f;
+        }
+        case IOT_SHM_KIND_DOUBLE: {
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+        default: return 0.0;
+    }
+}
+
+int iot_shm_read(const iot_shm* shm, const iot_shm_tag tag, iot_shm_value* out) {
+    const iot_shm_slot* s;
+    int n;
+    if (tag.index >= shm->capacity) return IOT_SHM_NOT_FOUND;
+    if (!IOT_LOAD32(&shm->hdr->state)) return IOT_SHM_CLOSED;
+    s = &shm->slots[tag.index];
+    for (n = 0; n < IOT_SHM_MAX_RETRIES; ++n) {
+        uint32_t seq = IOT_LOAD32(&s->seq), gen;
+        uint8_t kind, quality;
+        uint64_t bits;
+        int64_t ts;
+        if (seq & 1) {
+            iot_cpu_relax();
+            continue;
+        }
+        iot_fence_acquire();
+        gen = IOT_LOAD32(&s->gen);
+        kind = IOT_LOAD8(&s->kind);
+        quality = IOT_LOAD8(&s->quality);
+        bits = IOT_LOAD64(&s->bits);
+        ts = (int64_t)IOT_LOAD64(&s->ts_ms);
+        iot_fence_acquire();
+        if (IOT_LOAD32(&s->seq) != seq) continue;
+        if (gen != tag.gen) return IOT_SHM_GONE;
+        if (kind == IOT_SHM_KIND_NONE) return IOT_SHM_NO_VALUE;
+        out->kind = kind;
+        out->quality = quality;
+        out->bits = bits;
+        out->ts_ms = ts;
+        out->value = iot_shm_to_double(kind, bits);
+        return IOT_SHM_OK;
+    }
+    return IOT_SHM_BUSY;
+}
+
+/* 比较共享内存中的名称与 id（含结尾 0），逐字节读取 */
+static int iot_shm_name_equals(const char* stored, const char* id, size_t n) {
+    const volatile char* p = stored;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        if (p[i] != id[i]) return 0;
+    }
+    return p[n] == 0;
+}
+
+int iot_shm_find(const iot_shm* shm, const char* id, iot_shm_tag* tag) {
+    const size_t n = id ? strlen(id) : 0;
+    uint64_t h;
+    int retry;
+    if (n == 0 || n >= IOT_SHM_NAME_BYTES) return IOT_SHM_NOT_FOUND;
+    h = iot_shm_hash(id, n);
+    for (retry = 0; retry < IOT_SHM_MAX_RETRIES; ++retry) {
+        const uint32_t seq = IOT_LOAD32(&shm->hdr->index_seq);
+        uint32_t b = (uint32_t)h & shm->indexMask, probe;
+        int rc = IOT_SHM_NOT_FOUND;
+        if (seq & 1) {
+            iot_cpu_relax();
+            continue;
+        }
+        iot_fence_acquire();
+        for (probe = 0; probe <= shm->indexMask; ++probe, b = (b + 1) & shm->indexMask) {
+            const uint32_t e = IOT_LOAD32(&shm->index[b]);
+            if (e == IOT_SHM_INDEX_EMPTY) break;
+            if (e == IOT_SHM_INDEX_DELETED || e - 1 >= shm->capacity) continue;
+            if (iot_shm_name_equals(shm->names + (size_t)(e - 1) * IOT_SHM_NAME_BYTES, id, n)) {
+                tag->index = e - 1;
+                tag->gen = IOT_LOAD32(&shm->slots[e - 1].gen);
+                rc = IOT_SHM_OK;
+                break;
+            }
+        }
+        iot_fence_acquire();
+        if (IOT_LOAD32(&shm->hdr->index_seq) != seq) continue;
+        return rc;
+    }
+    return IOT_SHM_BUSY;
+}
+
+int iot_shm_tag_at(const iot_shm* shm, const uint32_t index, iot_shm_tag* tag, char* buf, const size_t len) {
+    int retry;
+    if (index >= shm->capacity || !buf || len == 0) return IOT_SHM_NOT_FOUND;
+    for (retry = 0; retry < IOT_SHM_MAX_RETRIES; ++retry) {
+        const uint32_t seq = IOT_LOAD32(&shm->hdr->index_seq);
+        const volatile char* name = shm->names + (size_t)index * IOT_SHM_NAME_BYTES;
+        uint32_t gen;
+        size_t i;
+        if (seq & 1) {
+            iot_cpu_relax();
+            continue;
+        }
+        iot_fence_acquire();
+        gen = IOT_LOAD32(&shm->slots[index].gen);
+        for (i = 0; i + 1 < len && i < IOT_SHM_NAME_BYTES - 1 && name[i]; ++i) buf[i] = name[i];
+        buf[i] = 0;
+        iot_fence_acquire();
+        if (IOT_LOAD32(&shm->hdr->index_seq) != seq) continue;
+        if (!(gen & 1)) return IOT_SHM_NOT_FOUND;
+        tag->index = index;
+        tag->gen = gen;
+        return IOT_SHM_OK;
+    }
+    return IOT_SHM_BUSY;
+}
@@ -0,0 +1,138 @@
+#ifndef IOT_SHM_H
+#define IOT_SHM_H
+/*
+ * 网关共享内存标签表的布局与 C 读取库。
+ *
+ * 网关（ShmTagTable）把标签表发布到一个命名共享内存段（POSIX 为 shm_open 的 "/<name>"，
+ * Windows 为 "Local\<name>" 文件映射）。段内依次是：
+ *   头部 iot_shm_header
+ *   值槽 iot_shm_slot[capacity]，下标即网关的标签句柄
+ *   名称 char[capacity][IOT_SHM_NAME_BYTES]，以 0 结尾的标签 id
+ *   名称索引 uint32_t[index_mask + 1]，开放寻址，内容为 下标 + 1（0 空，0xFFFFFFFF 已删除）
+ * 值槽与名称索引各由 seqlock 保护：序号为奇数表示正在写，读取前后序号一致才有效。
+ * 值槽的 gen 在标签绑定/解绑时各加一，奇数表示已绑定；句柄被回收复用后 gen 不同，
+ * 读取方据此发现缓存的下标已失效。
+ *
+ * 读取不加锁、不进内核：iot_shm_find 一次取得 (下标, gen)，之后每次 iot_shm_read
+ * 只是几次内存读取。字符串值不发布，读到 IOT_SHM_KIND_STRING 时无内容。
+ *
+ * 网关每 IOT_SHM_HEARTBEAT_MS 写一次 heartbeat_ms。网关崩溃时来不及把 state 置 0，
+ * iot_shm_read 仍会返回最后的值；读取方应定期调用 iot_shm_alive，它同时检查心跳与发布进程。
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IOT_SHM_MAGIC 0x53544F49u        /* "IOTS" */
+#define IOT_SHM_VERSION 2u
+#define IOT_SHM_NAME_BYTES 64u
+#define IOT_SHM_INDEX_EMPTY 0u
+#define IOT_SHM_INDEX_DELETED 0xFFFFFFFFu
+#define IOT_SHM_HEARTBEAT_MS 1000
+#define IOT_SHM_STALE_MS 5000           /* 心跳超过该时长未更新视为网关已退出 */
+
+/* kind 与网关 Variable::ValueType 的下标一致 */
+enum {
+    IOT_SHM_KIND_STRING = 0,
+    IOT_SHM_KIND_BOOL = 1,
+    IOT_SHM_KIND_INT16 = 2,
+    IOT_SHM_KIND_UINT16 = 3,
+    IOT_SHM_KIND_INT32 = 4,
+    IOT_SHM_KIND_UINT32 = 5,
+    IOT_SHM_KIND_INT64 = 6,
+    IOT_SHM_KIND_UINT64 = 7,
+    IOT_SHM_KIND_FLOAT = 8,
+    IOT_SHM_KIND_DOUBLE = 9,
+    IOT_SHM_KIND_NONE = 0xFF
+};
+
+/* 品质与网关 VarQuality 一致 */
+enum { IOT_SHM_QUALITY_GOOD = 0, IOT_SHM_QUALITY_BAD = 1, IOT_SHM_QUALITY_UNCERTAIN = 2 };
+
+enum {
+    IOT_SHM_OK = 0,
+    IOT_SHM_NOT_FOUND = 1,      /* 名称不存在或下标未绑定 */
+    IOT_SHM_GONE = 2,           /* 标签已删除（句柄可能已被复用），需重新 iot_shm_find */
+    IOT_SHM_NO_VALUE = 3,       /* 尚未采集到值 */
+    IOT_SHM_CLOSED = 4,         /* 网关已退出，需重新 iot_shm_open */
+    IOT_SHM_BUSY = 5,           /* 写入方长时间占用（如写到一半崩溃） */
+    IOT_SHM_ERROR = -1,         /* 打开失败 */
+    IOT_SHM_BAD_FORMAT = -2     /* 魔数或版本不符 */
+};
+
+typedef struct iot_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;           /* 值槽数 */
+    uint32_t index_mask;         /* 名称索引桶数 - 1 */
+    uint32_t index_seq;          /* 名称索引 seqlock */
+    uint32_t state;              /* 1 运行中，0 网关已退出 */
+    uint32_t tag_count;          /* 已绑定的标签数 */
+    uint32_t reserved;
+    uint64_t slots_offset;
+    uint64_t names_offset;
+    uint64_t index_offset;
+    uint64_t total_size;
+    uint64_t publisher_pid;
+    int64_t started_ms;
+    int64_t heartbeat_ms;        /* 网关最近一次心跳，Unix 毫秒 */
+} iot_shm_header;
+
+typedef struct iot_shm_slot {
+    uint32_t seq;
+    uint32_t gen;
+    uint8_t kind;
+    uint8_t quality;
+    uint8_t reserved[6];
+    uint64_t bits;               /* 值的原始位：整数按位宽放低位，float/double 为 IEEE 位 */
+    int64_t ts_ms;               /* 采集时间，Unix 毫秒 */
+} iot_shm_slot;
+
+/* 名称索引哈希（FNV-1a 64），网关与读取方共用 */
+static inline uint64_t iot_shm_hash(const char* s, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        h ^= (uint8_t)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/* ---- 读取库 ---- */
+
+typedef struct iot_shm iot_shm;
+
+typedef struct iot_shm_tag {
+    uint32_t index;
+    uint32_t gen;
+} iot_shm_tag;
+
+typedef struct iot_shm_value {
+    uint8_t kind;
+    uint8_t quality;
+    uint64_t bits;
+    int64_t ts_ms;
+    double value;                /* 数值换算为 double；字符串为 0 */
+} iot_shm_value;
+
+/* name 为网关配置的 system.shm_name；成功返回 IOT_SHM_OK 并填 *out */
+int iot_shm_open(const char* name, iot_shm** out);
+void iot_shm_close(iot_shm* shm);
+uint32_t iot_shm_capacity(const iot_shm* shm);
+/* 网关是否仍在发布：state 为 1、心跳未超时且发布进程仍存在；返回 0 时应关闭后重新打开 */
+int iot_shm_alive(const iot_shm* shm);
+
+int iot_shm_find(const iot_shm* shm, const char* id, iot_shm_tag* tag);
+int iot_shm_read(const iot_shm* shm, iot_shm_tag tag, iot_shm_value* out);
+/* 按下标枚举：下标已绑定时返回 IOT_SHM_OK，填 tag 与以 0 结尾的 id（buf 至少 IOT_SHM_NAME_BYTES） */
+int iot_shm_tag_at(const iot_shm* shm, uint32_t index, iot_shm_tag* tag, char* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOT_SHM_H */